@@ -0,0 +1,59 @@
+#version 330 core
+
+layout (location = 0) in vec3 aPosition;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoord;
+
+layout (std140) uniform FrameData
+{
+    mat4 uMvpMatrix;
+    vec4 uViewPosition;
+    vec4 uLightPosition;
+    uvec4 uPickHighlight;
+};
+
+// Instance-major node world matrices of the drawn (unculled) instances, 4 RGBA32F texels (columns) per matrix.
+uniform samplerBuffer uInstanceTransforms;
+
+// Crowd index of each drawn instance.
+uniform usamplerBuffer uInstanceIds;
+uniform int uSlotCount;
+uniform int uNodeSlot;
+uniform uint uNodePickId;
+
+// First drawn instance of the LOD level being drawn; the buffers are grouped by level.
+uniform int uInstanceBase;
+
+out vec3 vWorldPos;
+out vec3 vNormal;
+out vec2 vUv;
+flat out uint vPickId;
+
+void main()
+{
+    int drawnInstance = uInstanceBase + gl_InstanceID;
+    int base = (drawnInstance * uSlotCount + uNodeSlot) * 4;
+
+    mat4 model = mat4(texelFetch(uInstanceTransforms, base + 0),
+                      texelFetch(uInstanceTransforms, base + 1),
+                      texelFetch(uInstanceTransforms, base + 2),
+                      texelFetch(uInstanceTransforms, base + 3));
+
+    vec4 worldPos = model * vec4(aPosition, 1.0);
+    vWorldPos = worldPos.xyz;
+
+    // glTF nodes may scale non-uniformly, so normals use the inverse transpose of the upper 3x3. Its
+    // cofactor matrix is that times det, which normalize() removes up to the sign a mirror flips.
+    mat3 m = mat3(model);
+    mat3 cofactor = mat3(cross(m[1], m[2]), cross(m[2], m[0]), cross(m[0], m[1]));
+    float handedness = dot(m[0], cofactor[0]) < 0.0 ? -1.0 : 1.0;
+
+    vNormal = normalize(handedness * (cofactor * aNormal));
+
+    vUv = aTexCoord;
+
+    // Same packing as sceneGraph::encodePickId: instance in the high 16 bits, node + 1 in the low.
+    vPickId = (texelFetch(uInstanceIds, drawnInstance).r << 16u) | uNodePickId;
+
+    gl_Position = uMvpMatrix * worldPos;
+}
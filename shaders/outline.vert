@@ -1,11 +1,32 @@
 #version 330 core
 
 layout (location = 0) in vec3 aPosition;
+layout (location = 1) in vec3 aNormal;
+
+layout (std140) uniform FrameData
+{
+    mat4 uMvpMatrix;
+    vec4 uViewPosition;
+    vec4 uLightPosition;
+    uvec4 uPickHighlight;
+};
 
-uniform mat4 uMvpMatrix;
 uniform mat4 model;
+uniform mat3 normalMatrix;
+
+// Outline width in NDC units per axis (pixels * 2 / viewport size); 0 leaves the mesh unextruded.
+uniform vec2 uOutlineExtent;
 
 void main()
 {
-    gl_Position = uMvpMatrix * (model * vec4(aPosition, 1.0));
+    vec4 clipPos = uMvpMatrix * (model * vec4(aPosition, 1.0));
+    vec2 clipNormal = (mat3(uMvpMatrix) * (normalMatrix * aNormal)).xy;
+
+    // Push each vertex out along its screen-space normal, scaled by w so the width is constant in pixels.
+    if (dot(clipNormal, clipNormal) > 0.0)
+    {
+        clipPos.xy += normalize(clipNormal) * uOutlineExtent * clipPos.w;
+    }
+
+    gl_Position = clipPos;
 }
\ No newline at end of file
@@ -1,9 +0,0 @@
-#version 330 core
-
-uniform vec3 uPickColor;
-out vec4 fragColor;
-
-void main()
-{
-    fragColor = vec4(uPickColor, 1.0);
-}
\ No newline at end of file
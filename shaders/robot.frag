@@ -3,20 +3,28 @@
 in vec3 vWorldPos;
 in vec3 vNormal;
 in vec2 vUv;
+flat in uint vPickId;
+
+layout (std140) uniform FrameData
+{
+    mat4 uMvpMatrix;
+    vec4 uViewPosition;
+    vec4 uLightPosition;
+    uvec4 uPickHighlight;
+};
 
-uniform vec3 uLightPosition;
-uniform vec3 uViewPosition;
 uniform sampler2D uSampler;
 
-out vec4 fragColor;
+layout (location = 0) out vec4 fragColor;
+layout (location = 1) out uint fragPickId;
 
 void main()
 {
     vec3 albedo = texture(uSampler, vUv).rgb;
 
     vec3 N = normalize(vNormal);
-    vec3 L = normalize(uLightPosition - vWorldPos);
-    vec3 V = normalize(uViewPosition - vWorldPos);
+    vec3 L = normalize(uLightPosition.xyz - vWorldPos);
+    vec3 V = normalize(uViewPosition.xyz - vWorldPos);
     vec3 R = reflect(-L, N);
 
     float diff = max(dot(N, L), 0.0);
@@ -26,5 +34,14 @@ void main()
     vec3 diffuse = diff * albedo;
     vec3 specular = vec3(0.35) * spec;
 
-    fragColor = vec4(ambient + diffuse + specular, 1.0);
+    vec3 color = ambient + diffuse + specular;
+
+    // Hover highlight: uPickHighlight.x is the pick ID read back under the cursor (0 = none).
+    if (uPickHighlight.x != 0u && vPickId == uPickHighlight.x)
+    {
+        color = mix(color, vec3(1.0, 0.85, 0.35), 0.35);
+    }
+
+    fragColor = vec4(color, 1.0);
+    fragPickId = vPickId;
 }
\ No newline at end of file
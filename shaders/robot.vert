@@ -4,22 +4,32 @@ layout (location = 0) in vec3 aPosition;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoord;
 
-uniform mat4 uMvpMatrix;
+layout (std140) uniform FrameData
+{
+    mat4 uMvpMatrix;
+    vec4 uViewPosition;
+    vec4 uLightPosition;
+    uvec4 uPickHighlight;
+};
+
 uniform mat4 model;
+uniform mat3 normalMatrix;
+uniform uint uPickId;
 
 out vec3 vWorldPos;
 out vec3 vNormal;
 out vec2 vUv;
+flat out uint vPickId;
 
 void main()
 {
     vec4 worldPos = model * vec4(aPosition, 1.0);
     vWorldPos = worldPos.xyz;
 
-    mat3 nmat = mat3(transpose(inverse(model)));
-    vNormal = normalize(nmat * aNormal);
+    vNormal = normalize(normalMatrix * aNormal);
 
     vUv = aTexCoord;
+    vPickId = uPickId;
 
     gl_Position = uMvpMatrix * worldPos;
 }
\ No newline at end of file
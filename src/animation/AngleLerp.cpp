@@ -0,0 +1,209 @@
+#include "AngleLerp.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define HM_ANGLE_LERP_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define HM_TARGET_AVX2
+#else
+#include <cpuid.h>
+#define HM_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+static void lerpScalar(const float* from, const float* to, const float* t, float* out, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        float a1 = from[i];
+        float diff = to[i] - a1;
+
+        if (diff > 180.0f) diff -= 360.0f;
+        if (diff < -180.0f) diff += 360.0f;
+
+        out[i] = a1 + diff * t[i];
+    }
+}
+
+#ifdef HM_ANGLE_LERP_X86
+
+static void lerpSse2(const float* from, const float* to, const float* t, float* out, size_t count)
+{
+    const __m128 hi = _mm_set1_ps(180.0f);
+    const __m128 lo = _mm_set1_ps(-180.0f);
+    const __m128 full = _mm_set1_ps(360.0f);
+
+    size_t i = 0;
+
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 a1 = _mm_loadu_ps(from + i);
+        __m128 diff = _mm_sub_ps(_mm_loadu_ps(to + i), a1);
+
+        // Select rather than add a masked 360 so untouched lanes keep their exact bits (incl. -0).
+        __m128 over = _mm_cmpgt_ps(diff, hi);
+        diff = _mm_or_ps(_mm_and_ps(over, _mm_sub_ps(diff, full)), _mm_andnot_ps(over, diff));
+
+        __m128 under = _mm_cmplt_ps(diff, lo);
+        diff = _mm_or_ps(_mm_and_ps(under, _mm_add_ps(diff, full)), _mm_andnot_ps(under, diff));
+
+        _mm_storeu_ps(out + i, _mm_add_ps(a1, _mm_mul_ps(diff, _mm_loadu_ps(t + i))));
+    }
+
+    lerpScalar(from + i, to + i, t + i, out + i, count - i);
+}
+
+HM_TARGET_AVX2 static void lerpAvx2(const float* from, const float* to, const float* t, float* out, size_t count)
+{
+    const __m256 hi = _mm256_set1_ps(180.0f);
+    const __m256 lo = _mm256_set1_ps(-180.0f);
+    const __m256 full = _mm256_set1_ps(360.0f);
+
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256 a1 = _mm256_loadu_ps(from + i);
+        __m256 diff = _mm256_sub_ps(_mm256_loadu_ps(to + i), a1);
+
+        diff = _mm256_blendv_ps(diff, _mm256_sub_ps(diff, full), _mm256_cmp_ps(diff, hi, _CMP_GT_OQ));
+        diff = _mm256_blendv_ps(diff, _mm256_add_ps(diff, full), _mm256_cmp_ps(diff, lo, _CMP_LT_OQ));
+
+        _mm256_storeu_ps(out + i, _mm256_add_ps(a1, _mm256_mul_ps(diff, _mm256_loadu_ps(t + i))));
+    }
+
+    lerpSse2(from + i, to + i, t + i, out + i, count - i);
+}
+
+static bool detectAvx2()
+{
+#if defined(_MSC_VER)
+    int regs[4] = { 0 };
+    __cpuid(regs, 0);
+
+    if (regs[0] < 7)
+    {
+        return false;
+    }
+
+    __cpuid(regs, 1);
+    bool osxsave = (regs[2] & (1 << 27)) != 0;
+    bool avx = (regs[2] & (1 << 28)) != 0;
+
+    if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6)
+    {
+        return false;
+    }
+
+    __cpuidex(regs, 7, 0);
+
+    return (regs[1] & (1 << 5)) != 0;
+#else
+    unsigned int eax = 0;
+    unsigned int ebx = 0;
+    unsigned int ecx = 0;
+    unsigned int edx = 0;
+
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+    {
+        return false;
+    }
+
+    bool osxsave = (ecx & (1u << 27)) != 0;
+    bool avx = (ecx & (1u << 28)) != 0;
+
+    if (!osxsave || !avx)
+    {
+        return false;
+    }
+
+    // The OS must save YMM state (XCR0 bits 1 and 2).
+    unsigned int xcr0Lo = 0;
+    unsigned int xcr0Hi = 0;
+    __asm__("xgetbv" : "=a"(xcr0Lo), "=d"(xcr0Hi) : "c"(0));
+
+    if ((xcr0Lo & 0x6) != 0x6)
+    {
+        return false;
+    }
+
+    if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx))
+    {
+        return false;
+    }
+
+    return (ebx & (1u << 5)) != 0;
+#endif
+}
+
+#endif
+
+bool angleLerp::isSupported(Kernel kernel)
+{
+    switch (kernel)
+    {
+    case Kernel::Scalar:
+        return true;
+
+#ifdef HM_ANGLE_LERP_X86
+    case Kernel::Sse2:
+        // Baseline on x86-64; 32-bit builds are assumed to target SSE2 as well.
+        return true;
+
+    case Kernel::Avx2:
+    {
+        static const bool hasAvx2 = detectAvx2();
+
+        return hasAvx2;
+    }
+#endif
+
+    default:
+        return false;
+    }
+}
+
+angleLerp::Kernel angleLerp::getActiveKernel()
+{
+    static const Kernel active = isSupported(Kernel::Avx2) ? Kernel::Avx2 : (isSupported(Kernel::Sse2) ? Kernel::Sse2 : Kernel::Scalar);
+
+    return active;
+}
+
+const char* angleLerp::getKernelName(Kernel kernel)
+{
+    switch (kernel)
+    {
+    case Kernel::Scalar: return "scalar";
+    case Kernel::Sse2:   return "sse2";
+    case Kernel::Avx2:   return "avx2";
+    default:             return "unknown";
+    }
+}
+
+void angleLerp::lerpWrapped(Kernel kernel, const float* from, const float* to, const float* t, float* out, size_t count)
+{
+#ifdef HM_ANGLE_LERP_X86
+    if (kernel == Kernel::Avx2 && isSupported(Kernel::Avx2))
+    {
+        lerpAvx2(from, to, t, out, count);
+
+        return;
+    }
+
+    if (kernel == Kernel::Sse2)
+    {
+        lerpSse2(from, to, t, out, count);
+
+        return;
+    }
+#endif
+
+    lerpScalar(from, to, t, out, count);
+}
+
+void angleLerp::lerpWrapped(const float* from, const float* to, const float* t, float* out, size_t count)
+{
+    lerpWrapped(getActiveKernel(), from, to, t, out, count);
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+
+// Shortest-arc lerp of angles in degrees: out = from + wrap(to - from) * t, where wrap maps the
+// difference into [-180, 180] with the same two compares as the original scalar code. SSE2 / AVX2
+// kernels handle the wrap with compare masks instead of branches and match the scalar path bit for
+// bit (no FMA, same operation order). The widest kernel the CPU supports is picked at first use.
+namespace angleLerp
+{
+    enum class Kernel
+    {
+        Scalar,
+        Sse2,
+        Avx2,
+        Count
+    };
+
+    bool isSupported(Kernel kernel);
+    Kernel getActiveKernel();
+    const char* getKernelName(Kernel kernel);
+
+    // Per-lane weights; out may alias from or to.
+    void lerpWrapped(Kernel kernel, const float* from, const float* to, const float* t, float* out, size_t count);
+    void lerpWrapped(const float* from, const float* to, const float* t, float* out, size_t count);
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+
+// Binary animation clip (".hmclip"), little-endian, read from a memory-mapped file.
+//
+// The mapping is validated in place and then decoded into the editable KeyframeTracks in one linear pass.
+// There is no text parsing, but the decode is still O(keys x angles) and allocates per key. Serving tracks
+// straight from the mapped arrays would need a read-only track type next to the editable one, and playback
+// reads the baked pose cache either way. runClipFormatBenchmark reports the map and decode times apart.
+//
+//   Header
+//   TrackEntry[trackCount]            at header.indexOffset
+//   per track, 4-byte aligned:
+//     frame deltas  keyCount x uint16 (or uint32 when frameDeltaBytes == 4); first delta is from frame 0
+//     angles        keyCount x angleCount int16, key-major; angle = angleMin + (q + 32768) * angleStep
+namespace animationClipFormat
+{
+    constexpr uint32_t kMagic = 0x50494C43; // "CLIP"
+    constexpr uint32_t kVersion = 1;
+    constexpr const char* kFileExtension = ".hmclip";
+    constexpr int kMaxTrackName = 32;
+
+    struct Header
+    {
+        uint32_t magic;
+        uint32_t version;
+        float frameRate;
+        int32_t maxFrame;
+        float duration;
+        int32_t numJoints;
+        uint32_t trackCount;
+        uint32_t indexOffset;
+    };
+
+    struct TrackEntry
+    {
+        char name[kMaxTrackName];
+        uint32_t keyCount;
+        uint32_t angleCount;
+        uint32_t frameDeltaBytes;
+        float angleMin;
+        float angleStep;
+        uint32_t framesOffset;
+        uint32_t anglesOffset;
+        uint32_t reserved;
+    };
+
+    static_assert(sizeof(Header) == 32, "Header layout is part of the file format");
+    static_assert(sizeof(TrackEntry) == 64, "TrackEntry layout is part of the file format");
+}
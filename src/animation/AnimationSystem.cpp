@@ -1,52 +1,81 @@
 #include "AnimationSystem.h"
 
 #include <algorithm>
+#include <charconv>
 #include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
 #include <nlohmann/json.hpp>
 
+#include "AngleLerp.h"
+#include "AnimationClipFormat.h"
+#include "../util/MappedFile.h"
+
 using json = nlohmann::json;
 
-AnimationSystem::AnimationSystem(int inNumJoints, const std::unordered_map<std::string, std::vector<int>>& inBodyPartMap)
+AnimationSystem::AnimationSystem(int inNumJoints, const std::vector<std::pair<std::string, std::vector<int>>>& inBodyParts)
 {
     numJoints = inNumJoints;
-    bodyPartMap = inBodyPartMap;
 
-    for (auto& it : bodyPartMap)
+    int count = std::min(static_cast<int>(inBodyParts.size()), kMaxBodyParts);
+
+    for (int i = 0; i < count; ++i)
     {
-        keyframes[it.first] = {};
+        bodyPartNames.push_back(inBodyParts[i].first);
+        bodyPartJoints.push_back(inBodyParts[i].second);
     }
+
+    tracks.resize(bodyPartNames.size());
+    bakeCursors.resize(bodyPartNames.size());
 }
 
-void AnimationSystem::setKeyframe(int frame, const std::vector<float>& allAngles, const std::vector<std::string>* bodyPartsOrNull)
+AnimationSystem::BodyPartMask AnimationSystem::resolveMask(BodyPartMask bodyParts) const
 {
-    frame = std::max(0, frame);
+    BodyPartMask all = (getBodyPartCount() >= kMaxBodyParts) ? ~BodyPartMask(0) : ((BodyPartMask(1) << getBodyPartCount()) - 1);
 
-    std::vector<std::string> targets;
+    return (bodyParts == 0) ? all : (bodyParts & all);
+}
+
+int AnimationSystem::getBodyPartCount() const
+{
+    return static_cast<int>(bodyPartNames.size());
+}
 
-    if (!bodyPartsOrNull || bodyPartsOrNull->empty())
+int AnimationSystem::findBodyPart(const std::string& name) const
+{
+    for (int i = 0; i < getBodyPartCount(); ++i)
     {
-        for (auto& it : bodyPartMap)
+        if (bodyPartNames[i] == name)
         {
-            targets.push_back(it.first);
+            return i;
         }
     }
-    else
-    {
-        targets = *bodyPartsOrNull;
-    }
 
-    for (size_t i = 0; i < targets.size(); ++i)
-    {
-        const std::string& bodyPart = targets[i];
+    return -1;
+}
 
-        auto itMap = bodyPartMap.find(bodyPart);
+const std::string& AnimationSystem::getBodyPartName(int bodyPart) const
+{
+    return bodyPartNames[bodyPart];
+}
 
-        if (itMap == bodyPartMap.end())
+void AnimationSystem::setKeyframe(int frame, const std::vector<float>& allAngles, BodyPartMask bodyParts)
+{
+    frame = std::max(0, frame);
+
+    BodyPartMask targets = resolveMask(bodyParts);
+
+    for (int bodyPart = 0; bodyPart < getBodyPartCount(); ++bodyPart)
+    {
+        if ((targets & (BodyPartMask(1) << bodyPart)) == 0)
         {
             continue;
         }
 
-        const std::vector<int>& jointIds = itMap->second;
+        const std::vector<int>& jointIds = bodyPartJoints[bodyPart];
 
         Keyframe kf;
         kf.frame = frame;
@@ -66,26 +95,7 @@ void AnimationSystem::setKeyframe(int frame, const std::vector<float>& allAngles
             }
         }
 
-        std::vector<Keyframe>& list = keyframes[bodyPart];
-
-        auto existing = std::find_if(list.begin(), list.end(), [&](const Keyframe& a)
-        {
-            return a.frame == frame;
-        });
-
-        if (existing != list.end())
-        {
-            *existing = kf;
-        }
-        else
-        {
-            list.push_back(kf);
-
-            std::sort(list.begin(), list.end(), [](const Keyframe& a, const Keyframe& b)
-            {
-                return a.frame < b.frame;
-            });
-        }
+        tracks[bodyPart].setKey(kf);
     }
 
     if (frame > maxFrame)
@@ -93,48 +103,40 @@ void AnimationSystem::setKeyframe(int frame, const std::vector<float>& allAngles
         maxFrame = frame;
         duration = static_cast<float>(maxFrame) / frameRate;
     }
-}
-
-void AnimationSystem::removeKeyframe(int frame, const std::vector<std::string>* bodyPartsOrNull)
-{
-    std::vector<std::string> targets;
 
-    if (!bodyPartsOrNull || bodyPartsOrNull->empty())
+    for (int bodyPart = 0; bodyPart < getBodyPartCount(); ++bodyPart)
     {
-        for (auto& it : bodyPartMap)
+        if ((targets & (BodyPartMask(1) << bodyPart)) != 0)
         {
-            targets.push_back(it.first);
+            invalidateAroundKey(bodyPart, frame);
         }
     }
-    else
-    {
-        targets = *bodyPartsOrNull;
-    }
+}
 
-    for (size_t i = 0; i < targets.size(); ++i)
-    {
-        const std::string& bodyPart = targets[i];
-        auto it = keyframes.find(bodyPart);
+void AnimationSystem::removeKeyframe(int frame, BodyPartMask bodyParts)
+{
+    BodyPartMask targets = resolveMask(bodyParts);
 
-        if (it == keyframes.end())
+    for (int bodyPart = 0; bodyPart < getBodyPartCount(); ++bodyPart)
+    {
+        if ((targets & (BodyPartMask(1) << bodyPart)) == 0)
         {
             continue;
         }
 
-        std::vector<Keyframe>& list = it->second;
-        list.erase(std::remove_if(list.begin(), list.end(), [&](const Keyframe& kf)
+        if (tracks[bodyPart].removeKey(frame))
         {
-            return kf.frame == frame;
-        }), list.end());
+            invalidateAroundKey(bodyPart, frame);
+        }
     }
 
     int newMax = 0;
 
-    for (auto& it : keyframes)
+    for (const KeyframeTrack& track : tracks)
     {
-        for (size_t i = 0; i < it.second.size(); ++i)
+        if (!track.empty())
         {
-            newMax = std::max(newMax, it.second[i].frame);
+            newMax = std::max(newMax, track.getKeys().back().frame);
         }
     }
 
@@ -150,29 +152,27 @@ void AnimationSystem::removeKeyframe(int frame, const std::vector<std::string>*
     }
 }
 
-std::vector<AnimationSystem::Keyframe> AnimationSystem::getKeyframesForBodyPart(const std::string& bodyPart) const
+std::vector<AnimationSystem::Keyframe> AnimationSystem::getKeyframesForBodyPart(int bodyPart) const
 {
-    auto it = keyframes.find(bodyPart);
-
-    if (it == keyframes.end())
+    if (bodyPart < 0 || bodyPart >= getBodyPartCount())
     {
         return {};
     }
 
-    return it->second;
+    return tracks[bodyPart].getKeys();
 }
 
 std::vector<std::pair<std::string, AnimationSystem::Keyframe>> AnimationSystem::getAllKeyframes() const
 {
     std::vector<std::pair<std::string, Keyframe>> out;
 
-    for (auto& it : keyframes)
+    for (int bodyPart = 0; bodyPart < getBodyPartCount(); ++bodyPart)
     {
-        const std::string& bodyPart = it.first;
+        const std::vector<Keyframe>& keys = tracks[bodyPart].getKeys();
 
-        for (size_t i = 0; i < it.second.size(); ++i)
+        for (size_t i = 0; i < keys.size(); ++i)
         {
-            out.push_back({ bodyPart, it.second[i] });
+            out.push_back({ bodyPartNames[bodyPart], keys[i] });
         }
     }
 
@@ -186,84 +186,111 @@ std::vector<std::pair<std::string, AnimationSystem::Keyframe>> AnimationSystem::
 
 void AnimationSystem::clearKeyframes()
 {
-    for (auto& it : keyframes)
+    for (KeyframeTrack& track : tracks)
     {
-        it.second.clear();
+        track.clear();
     }
 
     maxFrame = 150;
     duration = 5.0f;
+
+    invalidateBaked(0, maxFrame + 1);
 }
 
-std::vector<float> AnimationSystem::interpolateBodyPart(const std::string& bodyPart, int frame, const std::vector<float>& defaultAngles) const
+void AnimationSystem::interpolateInto(int frame, float* inOutAngles) const
 {
-    auto it = keyframes.find(bodyPart);
+    interpolateInto(frame, inOutAngles, nullptr);
+}
 
-    if (it == keyframes.end() || it->second.empty())
-    {
-        return defaultAngles;
-    }
+void AnimationSystem::interpolateInto(int frame, float* inOutAngles, KeyframeTrack::Cursor* cursors) const
+{
+    frame = std::max(0, std::min(frame, maxFrame));
 
-    const std::vector<Keyframe>& list = it->second;
+    // Held keys are copied straight away; interpolating joints of every body part are gathered into
+    // lanes and lerped in one kernel call, then scattered back.
+    constexpr int kMaxLanes = 64;
 
-    if (list.size() == 1)
+    float from[kMaxLanes];
+    float to[kMaxLanes];
+    float weights[kMaxLanes];
+    int laneJoint[kMaxLanes];
+    int lanes = 0;
+
+    auto flush = [&]()
     {
-        return list[0].angles;
-    }
+        angleLerp::lerpWrapped(from, to, weights, from, static_cast<size_t>(lanes));
 
-    frame = std::max(0, std::min(frame, maxFrame));
+        for (int k = 0; k < lanes; ++k)
+        {
+            inOutAngles[laneJoint[k]] = from[k];
+        }
 
-    const Keyframe* before = nullptr;
-    const Keyframe* after = nullptr;
+        lanes = 0;
+    };
 
-    for (size_t i = 0; i < list.size(); ++i)
+    for (int bodyPart = 0; bodyPart < getBodyPartCount(); ++bodyPart)
     {
-        if (list[i].frame <= frame)
+        const KeyframeTrack& track = tracks[bodyPart];
+
+        if (track.empty())
         {
-            before = &list[i];
+            continue;
         }
-        if (list[i].frame >= frame)
+
+        const std::vector<int>& jointIds = bodyPartJoints[bodyPart];
+        KeyframeTrack::Sample s = track.sample(frame, cursors ? &cursors[bodyPart] : nullptr);
+
+        if (s.hold)
         {
-            after = &list[i];
+            size_t n = std::min(jointIds.size(), s.hold->angles.size());
 
-            break;
+            for (size_t j = 0; j < n; ++j)
+            {
+                inOutAngles[jointIds[j]] = s.hold->angles[j];
+            }
+
+            continue;
         }
-    }
 
-    if (!before)
-    {
-        return list[0].angles;
+        size_t n = std::min(jointIds.size(), std::min(s.before->angles.size(), s.after->angles.size()));
+
+        for (size_t j = 0; j < n; ++j)
+        {
+            if (lanes == kMaxLanes)
+            {
+                flush();
+            }
+
+            from[lanes] = s.before->angles[j];
+            to[lanes] = s.after->angles[j];
+            weights[lanes] = s.t;
+            laneJoint[lanes] = jointIds[j];
+            ++lanes;
+        }
     }
 
-    if (!after)
+    if (lanes > 0)
     {
-        return list.back().angles;
+        flush();
     }
+}
 
-    if (before->frame == frame)
+void AnimationSystem::setBodyPartKeyframes(int bodyPart, std::vector<Keyframe> keys)
+{
+    if (bodyPart < 0 || bodyPart >= getBodyPartCount())
     {
-        return before->angles;
+        return;
     }
 
-    float t = static_cast<float>(frame - before->frame) / static_cast<float>(after->frame - before->frame);
-
-    std::vector<float> out;
-    out.resize(before->angles.size());
+    tracks[bodyPart].assign(std::move(keys));
 
-    for (size_t i = 0; i < before->angles.size(); ++i)
+    if (!tracks[bodyPart].empty() && tracks[bodyPart].getKeys().back().frame > maxFrame)
     {
-        float a1 = before->angles[i];
-        float a2 = after->angles[i];
-
-        float diff = a2 - a1;
-
-        if (diff > 180.0f) diff -= 360.0f;
-        if (diff < -180.0f) diff += 360.0f;
-
-        out[i] = a1 + diff * t;
+        maxFrame = tracks[bodyPart].getKeys().back().frame;
+        duration = static_cast<float>(maxFrame) / frameRate;
     }
 
-    return out;
+    invalidateBaked(0, maxFrame + 1);
 }
 
 std::vector<float> AnimationSystem::interpolate(int frame, const std::vector<float>& defaultAngles) const
@@ -275,30 +302,32 @@ std::vector<float> AnimationSystem::interpolate(int frame, const std::vector<flo
         result.assign(numJoints, 0.0f);
     }
 
-    for (auto& it : bodyPartMap)
-    {
-        const std::string& bodyPart = it.first;
-        const std::vector<int>& jointIds = it.second;
+    interpolateInto(frame, result.data());
 
-        std::vector<float> defaults;
-        defaults.resize(jointIds.size());
+    return result;
+}
 
-        for (size_t j = 0; j < jointIds.size(); ++j)
-        {
-            int id = jointIds[j];
-            defaults[j] = result[id];
-        }
+int AnimationSystem::getFrameAtTime(float seconds) const
+{
+    float t = seconds * playbackSpeed;
 
-        std::vector<float> interp = interpolateBodyPart(bodyPart, frame, defaults);
+    if (loop && duration > 0.0f)
+    {
+        t = std::fmod(t, duration);
 
-        for (size_t j = 0; j < jointIds.size() && j < interp.size(); ++j)
+        if (t < 0.0f)
         {
-            int id = jointIds[j];
-            result[id] = interp[j];
+            t += duration;
         }
     }
+    else
+    {
+        t = std::max(0.0f, std::min(t, duration));
+    }
 
-    return result;
+    int frame = static_cast<int>(std::floor(t * frameRate));
+
+    return std::min(frame, maxFrame);
 }
 
 void AnimationSystem::update(float deltaTime)
@@ -355,103 +384,919 @@ void AnimationSystem::setFrame(int frame)
     animationTime = static_cast<float>(frame) / frameRate;
 }
 
-std::vector<float> AnimationSystem::getCurrentAngles(const std::vector<float>& defaultAngles) const
+std::vector<float> AnimationSystem::getCurrentAngles(const std::vector<float>& defaultAngles)
 {
-    return interpolate(currentFrame, defaultAngles);
+    std::vector<float> result = defaultAngles;
+
+    if (static_cast<int>(result.size()) != numJoints)
+    {
+        result.assign(numJoints, 0.0f);
+    }
+
+    sampleBaked(currentFrame, result.data());
+
+    return result;
 }
 
-std::string AnimationSystem::exportToJsonString() const
+void AnimationSystem::invalidateAroundKey(int bodyPart, int frame)
 {
-    json j;
+    // Frames strictly between the neighbouring keys (or the clip ends) are the only ones that changed.
+    const std::vector<Keyframe>& list = tracks[bodyPart].getKeys();
 
-    json keyframesByBodyPart;
+    auto next = std::upper_bound(list.begin(), list.end(), frame, [](int f, const Keyframe& kf)
+    {
+        return f < kf.frame;
+    });
 
-    for (auto& it : keyframes)
+    auto prev = std::lower_bound(list.begin(), list.end(), frame, [](const Keyframe& kf, int f)
     {
-        if (it.second.empty())
+        return kf.frame < f;
+    });
+
+    int begin = (prev == list.begin()) ? 0 : std::prev(prev)->frame;
+    int end = (next == list.end()) ? maxFrame + 1 : next->frame + 1;
+
+    invalidateBaked(begin, end);
+}
+
+void AnimationSystem::resizeBaked()
+{
+    int frames = maxFrame + 1;
+
+    if (frames == bakedFrameCount && bakedJointKeyed.size() == static_cast<size_t>(numJoints))
+    {
+        return;
+    }
+
+    // Existing rows stay valid: a frame's pose depends on the keys only, not on the clip length.
+    int oldFrames = bakedFrameCount;
+
+    bakedAngles.resize(static_cast<size_t>(frames) * static_cast<size_t>(numJoints), 0.0f);
+    bakedJointKeyed.resize(static_cast<size_t>(numJoints), 0);
+    bakedFrameCount = frames;
+
+    bakedDirtyBegin = std::min(bakedDirtyBegin, frames);
+    bakedDirtyEnd = std::min(bakedDirtyEnd, frames);
+
+    if (frames > oldFrames)
+    {
+        if (bakedDirtyBegin >= bakedDirtyEnd)
+        {
+            bakedDirtyBegin = oldFrames;
+        }
+
+        bakedDirtyBegin = std::min(bakedDirtyBegin, oldFrames);
+        bakedDirtyEnd = frames;
+    }
+}
+
+void AnimationSystem::invalidateBaked(int begin, int end)
+{
+    // Storage is only resized by bake(), so editing or importing a long take stays cheap.
+    begin = std::max(0, begin);
+    end = std::min(end, maxFrame + 1);
+
+    if (begin >= end)
+    {
+        return;
+    }
+
+    if (bakedDirtyBegin >= bakedDirtyEnd)
+    {
+        bakedDirtyBegin = begin;
+        bakedDirtyEnd = end;
+    }
+    else
+    {
+        bakedDirtyBegin = std::min(bakedDirtyBegin, begin);
+        bakedDirtyEnd = std::max(bakedDirtyEnd, end);
+    }
+}
+
+void AnimationSystem::bake()
+{
+    resizeBaked();
+
+    // Joints of parts without keys keep the caller's defaults on lookup.
+    std::fill(bakedJointKeyed.begin(), bakedJointKeyed.end(), 0);
+
+    for (int bodyPart = 0; bodyPart < getBodyPartCount(); ++bodyPart)
+    {
+        if (tracks[bodyPart].empty())
         {
             continue;
         }
 
-        json arr = json::array();
+        for (int id : bodyPartJoints[bodyPart])
+        {
+            bakedJointKeyed[id] = 1;
+        }
+    }
+
+    // Frames are sampled in order, so the per-track cursors step through the keys without searching.
+    std::fill(bakeCursors.begin(), bakeCursors.end(), KeyframeTrack::Cursor());
+
+    for (int f = bakedDirtyBegin; f < bakedDirtyEnd; ++f)
+    {
+        interpolateInto(f, bakedAngles.data() + static_cast<size_t>(f) * static_cast<size_t>(numJoints), bakeCursors.data());
+    }
+
+    bakedDirtyBegin = 0;
+    bakedDirtyEnd = 0;
+}
+
+void AnimationSystem::sampleBaked(int frame, float* inOutAngles)
+{
+    if (!sampleBakedInto(frame, inOutAngles))
+    {
+        bake();
+        sampleBakedInto(frame, inOutAngles);
+    }
+}
+
+bool AnimationSystem::sampleBakedInto(int frame, float* inOutAngles) const
+{
+    if (bakedFrameCount != maxFrame + 1 || bakedJointKeyed.size() != static_cast<size_t>(numJoints))
+    {
+        return false;
+    }
+
+    frame = std::max(0, std::min(frame, maxFrame));
+
+    if (frame >= bakedDirtyBegin && frame < bakedDirtyEnd)
+    {
+        return false;
+    }
+
+    const float* row = bakedAngles.data() + static_cast<size_t>(frame) * static_cast<size_t>(numJoints);
+
+    for (int j = 0; j < numJoints; ++j)
+    {
+        if (bakedJointKeyed[j])
+        {
+            inOutAngles[j] = row[j];
+        }
+    }
+
+    return true;
+}
+
+// Buffered writer reproducing nlohmann's dump(2) layout and number formatting; integers go through
+// std::to_chars.
+class JsonStreamWriter
+{
+public:
+    explicit JsonStreamWriter(std::ostream& inOut)
+        : out(inOut)
+    {
+        buffer.resize(1 << 16);
+    }
+
+    ~JsonStreamWriter()
+    {
+        flush();
+    }
+
+    void write(const char* text, size_t length)
+    {
+        if (used + length > buffer.size())
+        {
+            flush();
+
+            if (length > buffer.size())
+            {
+                out.write(text, static_cast<std::streamsize>(length));
+
+                return;
+            }
+        }
+
+        std::memcpy(buffer.data() + used, text, length);
+        used += length;
+    }
+
+    void write(const char* text)
+    {
+        write(text, std::strlen(text));
+    }
+
+    void newline(int level)
+    {
+        static const char kSpaces[] = "                                ";
+
+        write("\n", 1);
+
+        for (int n = level * 2; n > 0; n -= 32)
+        {
+            write(kSpaces, static_cast<size_t>(std::min(n, 32)));
+        }
+    }
+
+    void integer(int value)
+    {
+        char text[16];
+        std::to_chars_result r = std::to_chars(text, text + sizeof(text), value);
+        write(text, static_cast<size_t>(r.ptr - text));
+    }
+
+    // nlohmann's own Grisu2 dtoa: it is not always the shortest/closest form that std::to_chars
+    // would print, so it is used directly to stay byte-identical with dump().
+    void number(double value)
+    {
+        if (!std::isfinite(value))
+        {
+            write("null", 4);
+
+            return;
+        }
+
+        char text[64];
+        char* end = nlohmann::detail::to_chars(text, text + sizeof(text), value);
+        write(text, static_cast<size_t>(end - text));
+    }
+
+    void string(const std::string& value)
+    {
+        static const char kHex[] = "0123456789abcdef";
+
+        write("\"", 1);
+
+        for (char c : value)
+        {
+            switch (c)
+            {
+            case '"':  write("\\\"", 2); break;
+            case '\\': write("\\\\", 2); break;
+            case '\b': write("\\b", 2); break;
+            case '\f': write("\\f", 2); break;
+            case '\n': write("\\n", 2); break;
+            case '\r': write("\\r", 2); break;
+            case '\t': write("\\t", 2); break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20)
+                {
+                    char escaped[6] = { '\\', 'u', '0', '0', kHex[(c >> 4) & 0xF], kHex[c & 0xF] };
+                    write(escaped, 6);
+                }
+                else
+                {
+                    write(&c, 1);
+                }
+            }
+        }
+
+        write("\"", 1);
+    }
+
+    void flush()
+    {
+        if (used > 0)
+        {
+            out.write(buffer.data(), static_cast<std::streamsize>(used));
+            used = 0;
+        }
+    }
+
+private:
+    std::ostream& out;
+    std::vector<char> buffer;
+    size_t used = 0;
+};
+
+// SAX handler for the "2.0" layout: keys go straight into per-part lists, nothing else is kept.
+class AnimationJsonReader : public nlohmann::json_sax<json>
+{
+public:
+    explicit AnimationJsonReader(const AnimationSystem& inAnimation)
+        : animation(inAnimation)
+    {
+        parts.resize(static_cast<size_t>(animation.getBodyPartCount()));
+        partSeen.assign(parts.size(), 0);
+    }
+
+    bool null() override
+    {
+        if (top() == Scope::Root && currentKey == "keyframesByBodyPart")
+        {
+            hasKeyframes = true;
+        }
+
+        return true;
+    }
+
+    bool boolean(bool) override
+    {
+        return true;
+    }
+
+    bool number_integer(number_integer_t value) override
+    {
+        return number(static_cast<double>(value));
+    }
+
+    bool number_unsigned(number_unsigned_t value) override
+    {
+        return number(static_cast<double>(value));
+    }
+
+    bool number_float(number_float_t value, const string_t&) override
+    {
+        return number(value);
+    }
+
+    bool string(string_t& value) override
+    {
+        if (top() == Scope::Root && currentKey == "version")
+        {
+            version = value;
+        }
+
+        return true;
+    }
+
+    bool binary(binary_t&) override
+    {
+        return true;
+    }
+
+    bool start_object(std::size_t) override
+    {
+        if (scopes.empty())
+        {
+            scopes.push_back(Scope::Root);
+        }
+        else if (top() == Scope::Root && currentKey == "keyframesByBodyPart")
+        {
+            hasKeyframes = true;
+            scopes.push_back(Scope::Parts);
+        }
+        else if (top() == Scope::PartKeys)
+        {
+            parts[currentPart].emplace_back();
+            scopes.push_back(Scope::Keyframe);
+        }
+        else
+        {
+            scopes.push_back(Scope::Skip);
+        }
+
+        currentKey.clear();
+
+        return true;
+    }
+
+    bool key(string_t& value) override
+    {
+        Scope s = top();
+
+        if (s == Scope::Root || s == Scope::Keyframe)
+        {
+            currentKey = value;
+        }
+        else if (s == Scope::Parts)
+        {
+            currentPart = animation.findBodyPart(value);
+        }
+
+        return true;
+    }
+
+    bool end_object() override
+    {
+        scopes.pop_back();
+
+        return true;
+    }
+
+    bool start_array(std::size_t) override
+    {
+        if (top() == Scope::Parts && currentPart >= 0)
+        {
+            // A repeated part name replaces the earlier list, as the DOM importer did.
+            parts[currentPart].clear();
+            partSeen[currentPart] = 1;
+            scopes.push_back(Scope::PartKeys);
+        }
+        else if (top() == Scope::Keyframe && currentKey == "angles")
+        {
+            parts[currentPart].back().angles.clear();
+            scopes.push_back(Scope::Angles);
+        }
+        else
+        {
+            scopes.push_back(Scope::Skip);
+        }
+
+        return true;
+    }
+
+    bool end_array() override
+    {
+        scopes.pop_back();
+
+        return true;
+    }
+
+    bool parse_error(std::size_t, const std::string&, const nlohmann::detail::exception&) override
+    {
+        return false;
+    }
+
+    bool isValid() const
+    {
+        return version == "2.0" && hasKeyframes;
+    }
+
+public:
+    std::vector<std::vector<AnimationSystem::Keyframe>> parts;
+    std::vector<unsigned char> partSeen;
+
+    bool hasFrameRate = false;
+    bool hasMaxFrame = false;
+    bool hasDuration = false;
+    float frameRate = 0.0f;
+    int maxFrame = 0;
+    float duration = 0.0f;
+
+private:
+    enum class Scope
+    {
+        Root,
+        Parts,
+        PartKeys,
+        Keyframe,
+        Angles,
+        Skip
+    };
+
+    Scope top() const
+    {
+        return scopes.empty() ? Scope::Skip : scopes.back();
+    }
+
+    bool number(double value)
+    {
+        Scope s = top();
+
+        if (s == Scope::Angles)
+        {
+            parts[currentPart].back().angles.push_back(static_cast<float>(value));
+        }
+        else if (s == Scope::Keyframe && currentKey == "frame")
+        {
+            parts[currentPart].back().frame = static_cast<int>(value);
+        }
+        else if (s == Scope::Root)
+        {
+            if (currentKey == "frameRate") { frameRate = static_cast<float>(value); hasFrameRate = true; }
+            else if (currentKey == "maxFrame") { maxFrame = static_cast<int>(value); hasMaxFrame = true; }
+            else if (currentKey == "duration") { duration = static_cast<float>(value); hasDuration = true; }
+        }
+
+        return true;
+    }
+
+private:
+    const AnimationSystem& animation;
 
-        for (size_t i = 0; i < it.second.size(); ++i)
+    std::vector<Scope> scopes;
+    std::string currentKey;
+    int currentPart = -1;
+
+    std::string version;
+    bool hasKeyframes = false;
+};
+
+std::string AnimationSystem::exportToJsonString() const
+{
+    std::ostringstream out;
+    exportToJson(out);
+
+    return out.str();
+}
+
+void AnimationSystem::exportToJson(std::ostream& out) const
+{
+    // Same bytes as building a DOM and calling dump(2): object keys in std::map (sorted) order.
+    std::vector<int> order;
+
+    for (int bodyPart = 0; bodyPart < getBodyPartCount(); ++bodyPart)
+    {
+        if (!tracks[bodyPart].empty())
         {
-            json kf;
-            kf["frame"] = it.second[i].frame;
-            kf["angles"] = it.second[i].angles;
-            arr.push_back(kf);
+            order.push_back(bodyPart);
         }
+    }
 
-        keyframesByBodyPart[it.first] = arr;
+    std::sort(order.begin(), order.end(), [this](int a, int b)
+    {
+        return bodyPartNames[a] < bodyPartNames[b];
+    });
+
+    JsonStreamWriter w(out);
+
+    w.write("{");
+    w.newline(1);
+    w.write("\"duration\": ");
+    w.number(duration);
+    w.write(",");
+    w.newline(1);
+    w.write("\"frameRate\": ");
+    w.number(frameRate);
+    w.write(",");
+    w.newline(1);
+    w.write("\"keyframesByBodyPart\": ");
+
+    if (order.empty())
+    {
+        w.write("null");
     }
+    else
+    {
+        w.write("{");
+
+        for (size_t p = 0; p < order.size(); ++p)
+        {
+            const std::vector<Keyframe>& list = tracks[order[p]].getKeys();
+
+            w.newline(2);
+            w.string(bodyPartNames[order[p]]);
+            w.write(": [");
+
+            for (size_t i = 0; i < list.size(); ++i)
+            {
+                w.newline(3);
+                w.write("{");
+                w.newline(4);
+                w.write("\"angles\": [");
+
+                for (size_t a = 0; a < list[i].angles.size(); ++a)
+                {
+                    w.newline(5);
+                    w.number(list[i].angles[a]);
+
+                    if (a + 1 < list[i].angles.size())
+                    {
+                        w.write(",");
+                    }
+                }
+
+                if (!list[i].angles.empty())
+                {
+                    w.newline(4);
+                }
+
+                w.write("],");
+                w.newline(4);
+                w.write("\"frame\": ");
+                w.integer(list[i].frame);
+                w.newline(3);
+                w.write(i + 1 < list.size() ? "}," : "}");
+            }
 
-    j["version"] = "2.0";
-    j["frameRate"] = frameRate;
-    j["maxFrame"] = maxFrame;
-    j["duration"] = duration;
-    j["numJoints"] = numJoints;
-    j["keyframesByBodyPart"] = keyframesByBodyPart;
+            w.newline(2);
+            w.write(p + 1 < order.size() ? "]," : "]");
+        }
+
+        w.newline(1);
+        w.write("}");
+    }
 
-    return j.dump(2);
+    w.write(",");
+    w.newline(1);
+    w.write("\"maxFrame\": ");
+    w.integer(maxFrame);
+    w.write(",");
+    w.newline(1);
+    w.write("\"numJoints\": ");
+    w.integer(numJoints);
+    w.write(",");
+    w.newline(1);
+    w.write("\"version\": \"2.0\"");
+    w.newline(0);
+    w.write("}");
 }
 
 void AnimationSystem::importFromJsonString(const std::string& jsonText)
 {
-    json j = json::parse(jsonText);
+    AnimationJsonReader reader(*this);
+
+    if (!json::sax_parse(jsonText, &reader))
+    {
+        throw std::runtime_error("Invalid animation JSON.");
+    }
 
+    applyJsonReader(reader);
+}
+
+void AnimationSystem::importFromJson(std::istream& in)
+{
+    AnimationJsonReader reader(*this);
+
+    if (!json::sax_parse(in, &reader))
+    {
+        throw std::runtime_error("Invalid animation JSON.");
+    }
+
+    applyJsonReader(reader);
+}
+
+void AnimationSystem::applyJsonReader(AnimationJsonReader& reader)
+{
     clearKeyframes();
 
-    if (j.contains("version") && j["version"].is_string() && j["version"].get<std::string>() == "2.0" && j.contains("keyframesByBodyPart"))
+    if (!reader.isValid())
     {
-        json kb = j["keyframesByBodyPart"];
+        throw std::runtime_error("Invalid animation JSON.");
+    }
 
-        for (auto& it : bodyPartMap)
+    for (int bodyPart = 0; bodyPart < getBodyPartCount(); ++bodyPart)
+    {
+        if (reader.partSeen[bodyPart])
         {
-            const std::string& bodyPart = it.first;
+            tracks[bodyPart].assign(std::move(reader.parts[bodyPart]));
+        }
+    }
 
-            if (!kb.contains(bodyPart))
+    if (reader.hasFrameRate) frameRate = reader.frameRate;
+    if (reader.hasMaxFrame) maxFrame = reader.maxFrame;
+    if (reader.hasDuration) duration = reader.duration;
+
+    invalidateBaked(0, maxFrame + 1);
+}
+
+static size_t alignClipOffset(size_t offset)
+{
+    return (offset + 3) & ~size_t(3);
+}
+
+bool AnimationSystem::exportToBinary(std::vector<unsigned char>& outBytes) const
+{
+    using namespace animationClipFormat;
+
+    outBytes.clear();
+
+    std::vector<int> written;
+
+    for (int bodyPart = 0; bodyPart < getBodyPartCount(); ++bodyPart)
+    {
+        if (!tracks[bodyPart].empty())
+        {
+            written.push_back(bodyPart);
+        }
+    }
+
+    // Lay out header, index, then each track's frame deltas and angles.
+    std::vector<TrackEntry> entries(written.size());
+    size_t offset = sizeof(Header) + entries.size() * sizeof(TrackEntry);
+
+    for (size_t t = 0; t < written.size(); ++t)
+    {
+        const std::vector<Keyframe>& keys = tracks[written[t]].getKeys();
+        TrackEntry& e = entries[t];
+
+        std::memset(&e, 0, sizeof(e));
+        std::strncpy(e.name, bodyPartNames[written[t]].c_str(), kMaxTrackName - 1);
+
+        e.keyCount = static_cast<uint32_t>(keys.size());
+        e.angleCount = static_cast<uint32_t>(keys[0].angles.size());
+        e.frameDeltaBytes = 2;
+
+        float minAngle = 0.0f;
+        float maxAngle = 0.0f;
+        int prevFrame = 0;
+
+        for (size_t k = 0; k < keys.size(); ++k)
+        {
+            e.angleCount = std::min(e.angleCount, static_cast<uint32_t>(keys[k].angles.size()));
+
+            // Deltas are unsigned and the first is from frame 0, so frames must be non-negative and ascending.
+            if (keys[k].frame < prevFrame)
             {
-                continue;
+                return false;
             }
 
-            json arr = kb[bodyPart];
+            if (keys[k].frame - prevFrame > 0xFFFF)
+            {
+                e.frameDeltaBytes = 4;
+            }
+
+            prevFrame = keys[k].frame;
+        }
 
-            if (!arr.is_array())
+        for (size_t k = 0; k < keys.size(); ++k)
+        {
+            for (uint32_t a = 0; a < e.angleCount; ++a)
             {
-                continue;
+                float v = keys[k].angles[a];
+                minAngle = (k == 0 && a == 0) ? v : std::min(minAngle, v);
+                maxAngle = (k == 0 && a == 0) ? v : std::max(maxAngle, v);
             }
+        }
+
+        e.angleMin = minAngle;
+        e.angleStep = (maxAngle - minAngle) / 65535.0f;
+
+        e.framesOffset = static_cast<uint32_t>(offset);
+        offset = alignClipOffset(offset + static_cast<size_t>(e.keyCount) * e.frameDeltaBytes);
 
-            std::vector<Keyframe> list;
+        e.anglesOffset = static_cast<uint32_t>(offset);
+        offset = alignClipOffset(offset + static_cast<size_t>(e.keyCount) * e.angleCount * sizeof(int16_t));
+    }
+
+    outBytes.assign(offset, 0);
+
+    Header header;
+    header.magic = kMagic;
+    header.version = kVersion;
+    header.frameRate = frameRate;
+    header.maxFrame = maxFrame;
+    header.duration = duration;
+    header.numJoints = numJoints;
+    header.trackCount = static_cast<uint32_t>(entries.size());
+    header.indexOffset = sizeof(Header);
+
+    std::memcpy(outBytes.data(), &header, sizeof(header));
+
+    if (!entries.empty())
+    {
+        std::memcpy(outBytes.data() + header.indexOffset, entries.data(), entries.size() * sizeof(TrackEntry));
+    }
+
+    for (size_t t = 0; t < written.size(); ++t)
+    {
+        const std::vector<Keyframe>& keys = tracks[written[t]].getKeys();
+        const TrackEntry& e = entries[t];
+
+        int prevFrame = 0;
+
+        for (uint32_t k = 0; k < e.keyCount; ++k)
+        {
+            uint32_t delta = static_cast<uint32_t>(keys[k].frame - prevFrame);
+            prevFrame = keys[k].frame;
 
-            for (auto& el : arr)
+            if (e.frameDeltaBytes == 2)
             {
-                Keyframe kf;
-                kf.frame = el.value("frame", 0);
-                kf.angles = el.value("angles", std::vector<float>());
-                list.push_back(kf);
+                uint16_t d = static_cast<uint16_t>(delta);
+                std::memcpy(outBytes.data() + e.framesOffset + k * 2, &d, 2);
+            }
+            else
+            {
+                std::memcpy(outBytes.data() + e.framesOffset + k * 4, &delta, 4);
             }
 
-            std::sort(list.begin(), list.end(), [](const Keyframe& a, const Keyframe& b)
+            for (uint32_t a = 0; a < e.angleCount; ++a)
             {
-                return a.frame < b.frame;
-            });
+                float normalized = (e.angleStep > 0.0f) ? (keys[k].angles[a] - e.angleMin) / e.angleStep : 0.0f;
+                long q = std::lround(normalized) - 32768;
+                int16_t v = static_cast<int16_t>(std::max(-32768L, std::min(32767L, q)));
 
-            keyframes[bodyPart] = list;
+                std::memcpy(outBytes.data() + e.anglesOffset + (static_cast<size_t>(k) * e.angleCount + a) * sizeof(int16_t), &v, sizeof(v));
+            }
         }
     }
-    else
+
+    return true;
+}
+
+void AnimationSystem::importFromBinary(const unsigned char* data, size_t size)
+{
+    using namespace animationClipFormat;
+
+    if (!data || size < sizeof(Header))
     {
-        throw std::runtime_error("Invalid animation JSON.");
+        throw std::runtime_error("Invalid animation clip.");
+    }
+
+    const Header& header = *reinterpret_cast<const Header*>(data);
+
+    if (header.magic != kMagic || header.version != kVersion || header.indexOffset % 4 != 0 || static_cast<size_t>(header.indexOffset) + static_cast<size_t>(header.trackCount) * sizeof(TrackEntry) > size)
+    {
+        throw std::runtime_error("Invalid animation clip.");
+    }
+
+    if (!(header.frameRate > 0.0f) || header.maxFrame < 0)
+    {
+        throw std::runtime_error("Invalid animation clip.");
+    }
+
+    const TrackEntry* entries = reinterpret_cast<const TrackEntry*>(data + header.indexOffset);
+
+    // Every track is checked before anything is replaced, so a damaged clip leaves the current one intact.
+    for (uint32_t t = 0; t < header.trackCount; ++t)
+    {
+        const TrackEntry& e = entries[t];
+
+        size_t framesEnd = static_cast<size_t>(e.framesOffset) + static_cast<size_t>(e.keyCount) * e.frameDeltaBytes;
+        size_t anglesEnd = static_cast<size_t>(e.anglesOffset) + static_cast<size_t>(e.keyCount) * e.angleCount * sizeof(int16_t);
+
+        if ((e.frameDeltaBytes != 2 && e.frameDeltaBytes != 4) || framesEnd > size || anglesEnd > size || e.framesOffset % 4 != 0 || e.anglesOffset % 4 != 0)
+        {
+            throw std::runtime_error("Invalid animation clip.");
+        }
+    }
+
+    clearKeyframes();
+
+    for (uint32_t t = 0; t < header.trackCount; ++t)
+    {
+        const TrackEntry& e = entries[t];
+
+        char name[kMaxTrackName + 1] = { 0 };
+        std::memcpy(name, e.name, kMaxTrackName);
+
+        int bodyPart = findBodyPart(name);
+
+        if (bodyPart < 0)
+        {
+            continue;
+        }
+
+        const int16_t* quantized = reinterpret_cast<const int16_t*>(data + e.anglesOffset);
+
+        std::vector<Keyframe> keys(e.keyCount);
+        int frame = 0;
+
+        for (uint32_t k = 0; k < e.keyCount; ++k)
+        {
+            if (e.frameDeltaBytes == 2)
+            {
+                frame += reinterpret_cast<const uint16_t*>(data + e.framesOffset)[k];
+            }
+            else
+            {
+                frame += static_cast<int>(reinterpret_cast<const uint32_t*>(data + e.framesOffset)[k]);
+            }
+
+            keys[k].frame = frame;
+            keys[k].angles.resize(e.angleCount);
+
+            for (uint32_t a = 0; a < e.angleCount; ++a)
+            {
+                keys[k].angles[a] = e.angleMin + static_cast<float>(quantized[k * e.angleCount + a] + 32768) * e.angleStep;
+            }
+        }
+
+        tracks[bodyPart].assign(std::move(keys));
+    }
+
+    frameRate = header.frameRate;
+    maxFrame = header.maxFrame;
+    duration = header.duration;
+
+    invalidateBaked(0, maxFrame + 1);
+}
+
+bool AnimationSystem::importFromBinaryFile(const std::string& path)
+{
+    MappedFile file;
+
+    if (!file.open(path))
+    {
+        return false;
+    }
+
+    try
+    {
+        importFromBinary(file.getData(), file.getSize());
+    }
+    catch (...)
+    {
+        return false;
+    }
+
+    return true;
+}
+
+bool AnimationSystem::importFromFile(const std::string& path)
+{
+    if (std::filesystem::path(path).extension() == animationClipFormat::kFileExtension)
+    {
+        return importFromBinaryFile(path);
+    }
+
+    std::ifstream in(path, std::ios::in | std::ios::binary);
+
+    if (!in)
+    {
+        return false;
+    }
+
+    try
+    {
+        importFromJson(in);
+    }
+    catch (...)
+    {
+        return false;
     }
 
-    if (j.contains("frameRate")) frameRate = j["frameRate"].get<float>();
-    if (j.contains("maxFrame")) maxFrame = j["maxFrame"].get<int>();
-    if (j.contains("duration")) duration = j["duration"].get<float>();
+    return true;
 }
 
 int AnimationSystem::getCurrentFrame() const { return currentFrame; }
 int AnimationSystem::getMaxFrame() const { return maxFrame; }
+int AnimationSystem::getJointCount() const { return numJoints; }
 float AnimationSystem::getFrameRate() const { return frameRate; }
 float AnimationSystem::getDuration() const { return duration; }
 float AnimationSystem::getAnimationTime() const { return animationTime; }
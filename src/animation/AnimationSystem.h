@@ -2,31 +2,53 @@
 
 #include <string>
 #include <vector>
-#include <unordered_map>
+#include <cstdint>
+#include <iosfwd>
+
+#include "KeyframeTrack.h"
+
+class AnimationJsonReader;
 
 class AnimationSystem
 {
 public:
-    struct Keyframe
-    {
-        int frame = 0;
-        std::vector<float> angles;
-    };
+    using Keyframe = KeyframeTrack::Keyframe;
+
+    // Body parts are addressed by their index in the constructor list; a mask bit per part, 0 = all parts.
+    using BodyPartMask = uint32_t;
+    static constexpr int kMaxBodyParts = 32;
 
     AnimationSystem() = default;
 
-    AnimationSystem(int numJoints, const std::unordered_map<std::string, std::vector<int>>& bodyPartMap);
+    AnimationSystem(int numJoints, const std::vector<std::pair<std::string, std::vector<int>>>& bodyParts);
 
-    void setKeyframe(int frame, const std::vector<float>& allAngles, const std::vector<std::string>* bodyPartsOrNull);
-    void removeKeyframe(int frame, const std::vector<std::string>* bodyPartsOrNull);
+    void setKeyframe(int frame, const std::vector<float>& allAngles, BodyPartMask bodyParts);
+    void removeKeyframe(int frame, BodyPartMask bodyParts);
 
-    std::vector<Keyframe> getKeyframesForBodyPart(const std::string& bodyPart) const;
+    int getBodyPartCount() const;
+    int findBodyPart(const std::string& name) const;
+    const std::string& getBodyPartName(int bodyPart) const;
+
+    std::vector<Keyframe> getKeyframesForBodyPart(int bodyPart) const;
     std::vector<std::pair<std::string, Keyframe>> getAllKeyframes() const;
 
     void clearKeyframes();
 
+    // Replaces one body part's keys (any order) and extends maxFrame to cover them.
+    void setBodyPartKeyframes(int bodyPart, std::vector<Keyframe> keys);
+
     std::vector<float> interpolate(int frame, const std::vector<float>& defaultAngles) const;
 
+    // Allocation-free form of interpolate: inOutAngles holds numJoints defaults and receives the result.
+    // Read-only, so one clip can be evaluated for many instances concurrently.
+    void interpolateInto(int frame, float* inOutAngles) const;
+
+    // Same, with one cursor per body part track for callers that walk frames in order.
+    void interpolateInto(int frame, float* inOutAngles, KeyframeTrack::Cursor* cursors) const;
+
+    // Frame shown at the given playback time, honouring loop / clamp like update().
+    int getFrameAtTime(float seconds) const;
+
     void update(float deltaTime);
 
     void play();
@@ -35,26 +57,64 @@ public:
 
     void setFrame(int frame);
 
-    std::vector<float> getCurrentAngles(const std::vector<float>& defaultAngles) const;
+    // Reads the baked row for the current frame (baking invalidated frames first).
+    std::vector<float> getCurrentAngles(const std::vector<float>& defaultAngles);
+
+    // Samples every invalidated frame in 0..maxFrame into the baked pose cache.
+    void bake();
 
+    // Baked lookup; keyed joints are overwritten, the rest keep their defaults.
+    void sampleBaked(int frame, float* inOutAngles);
+
+    // Read-only baked lookup for worker threads; false when the frame still needs baking.
+    bool sampleBakedInto(int frame, float* inOutAngles) const;
+
+    // JSON ("2.0") is streamed both ways: export writes dump(2)-identical text without a DOM, import
+    // feeds SAX events straight into the tracks. Import throws std::runtime_error on invalid input.
     std::string exportToJsonString() const;
+    void exportToJson(std::ostream& out) const;
     void importFromJsonString(const std::string& jsonText);
+    void importFromJson(std::istream& in);
+
+    // Binary clip (see AnimationClipFormat.h): 16-bit quantised angles, delta-encoded frames. Returns false
+    // (outBytes empty) when a track has a negative frame, which the unsigned deltas cannot encode.
+    bool exportToBinary(std::vector<unsigned char>& outBytes) const;
+
+    // Validates a clip in place (e.g. in a MappedFile), then decodes it into the tracks; throws
+    // std::runtime_error on malformed input.
+    void importFromBinary(const unsigned char* data, size_t size);
+
+    // Maps path and imports it; false (current clip kept) when it cannot be opened or is not a valid clip.
+    bool importFromBinaryFile(const std::string& path);
+
+    // Binary clip when path has animationClipFormat::kFileExtension, JSON otherwise; false as above.
+    bool importFromFile(const std::string& path);
 
     int getCurrentFrame() const;
     int getMaxFrame() const;
+    int getJointCount() const;
     float getFrameRate() const;
     float getDuration() const;
     float getAnimationTime() const;
     bool getIsPlaying() const;
 
 private:
-    std::vector<float> interpolateBodyPart(const std::string& bodyPart, int frame, const std::vector<float>& defaultAngles) const;
+    BodyPartMask resolveMask(BodyPartMask bodyParts) const;
+
+    void applyJsonReader(AnimationJsonReader& reader);
+
+    // Invalidates the frames whose pose depends on the key at frame (up to its neighbours).
+    void invalidateAroundKey(int bodyPart, int frame);
+    void invalidateBaked(int begin, int end);
+    void resizeBaked();
 
 private:
     int numJoints = 0;
 
-    std::unordered_map<std::string, std::vector<int>> bodyPartMap;
-    std::unordered_map<std::string, std::vector<Keyframe>> keyframes;
+    // Indexed by body part id.
+    std::vector<std::string> bodyPartNames;
+    std::vector<std::vector<int>> bodyPartJoints;
+    std::vector<KeyframeTrack> tracks;
 
     int currentFrame = 0;
     bool isPlaying = false;
@@ -67,4 +127,13 @@ private:
 
     float duration = 5.0f;
     int maxFrame = 600;
+
+    // Baked pose cache: (maxFrame + 1) rows of numJoints angles. Rows in [bakedDirtyBegin, bakedDirtyEnd)
+    // are stale; keyframe edits widen that range and bake() re-samples it.
+    std::vector<float> bakedAngles;
+    std::vector<unsigned char> bakedJointKeyed;
+    int bakedFrameCount = 0;
+    int bakedDirtyBegin = 0;
+    int bakedDirtyEnd = 0;
+    std::vector<KeyframeTrack::Cursor> bakeCursors;
 };
\ No newline at end of file
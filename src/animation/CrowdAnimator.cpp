@@ -0,0 +1,85 @@
+#include "CrowdAnimator.h"
+
+#include <algorithm>
+
+#include "../util/ThreadPool.h"
+
+// Small enough to balance across workers, large enough that a chunk outweighs a steal.
+static constexpr int kInstancesPerTask = 32;
+
+void CrowdAnimator::resize(int instanceCount, int inJointCount)
+{
+    instanceCount = std::max(0, instanceCount);
+    jointCount = std::max(0, inJointCount);
+
+    instances.resize(static_cast<size_t>(instanceCount));
+    angles.assign(static_cast<size_t>(instanceCount) * static_cast<size_t>(jointCount), 0.0f);
+}
+
+int CrowdAnimator::getInstanceCount() const
+{
+    return static_cast<int>(instances.size());
+}
+
+int CrowdAnimator::getJointCount() const
+{
+    return jointCount;
+}
+
+CrowdAnimator::Instance& CrowdAnimator::getInstance(int instance)
+{
+    return instances[instance];
+}
+
+const CrowdAnimator::Instance& CrowdAnimator::getInstance(int instance) const
+{
+    return instances[instance];
+}
+
+void CrowdAnimator::evaluateRange(const AnimationSystem* const* clips, int clipCount, float time, const float* defaultAngles, int begin, int end)
+{
+    for (int i = begin; i < end; ++i)
+    {
+        const Instance& inst = instances[i];
+        float* out = angles.data() + static_cast<size_t>(i) * static_cast<size_t>(jointCount);
+
+        std::copy(defaultAngles, defaultAngles + jointCount, out);
+
+        if (inst.clip < 0 || inst.clip >= clipCount || !clips[inst.clip])
+        {
+            continue;
+        }
+
+        const AnimationSystem& clip = *clips[inst.clip];
+
+        if (clip.getJointCount() != jointCount)
+        {
+            continue;
+        }
+
+        int frame = clip.getFrameAtTime(inst.timeOffset + time * inst.speed);
+
+        if (!clip.sampleBakedInto(frame, out))
+        {
+            clip.interpolateInto(frame, out);
+        }
+    }
+}
+
+void CrowdAnimator::evaluate(const AnimationSystem* const* clips, int clipCount, float time, const float* defaultAngles, ThreadPool& pool)
+{
+    pool.parallelFor(getInstanceCount(), kInstancesPerTask, [&](int begin, int end)
+    {
+        evaluateRange(clips, clipCount, time, defaultAngles, begin, end);
+    });
+}
+
+const float* CrowdAnimator::getInstanceAngles(int instance) const
+{
+    return angles.data() + static_cast<size_t>(instance) * static_cast<size_t>(jointCount);
+}
+
+const std::vector<float>& CrowdAnimator::getAngles() const
+{
+    return angles;
+}
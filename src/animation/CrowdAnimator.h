@@ -0,0 +1,45 @@
+#pragma once
+
+#include <vector>
+
+#include "AnimationSystem.h"
+
+class ThreadPool;
+
+// Evaluates one clip per instance, each with its own time offset and speed, into a preallocated
+// instance-major angle buffer (instanceCount * jointCount). Batches of instances are spread over a
+// ThreadPool; clips are only read, so instances sharing a clip evaluate concurrently.
+class CrowdAnimator
+{
+public:
+    struct Instance
+    {
+        int clip = 0;
+        float timeOffset = 0.0f;
+        float speed = 1.0f;
+    };
+
+    void resize(int instanceCount, int jointCount);
+
+    int getInstanceCount() const;
+    int getJointCount() const;
+
+    Instance& getInstance(int instance);
+    const Instance& getInstance(int instance) const;
+
+    // Every instance starts from defaultAngles (jointCount values) and overwrites the keyed joints.
+    // Bake the clips beforehand so instances read cached rows instead of interpolating.
+    void evaluate(const AnimationSystem* const* clips, int clipCount, float time, const float* defaultAngles, ThreadPool& pool);
+
+    const float* getInstanceAngles(int instance) const;
+    const std::vector<float>& getAngles() const;
+
+private:
+    void evaluateRange(const AnimationSystem* const* clips, int clipCount, float time, const float* defaultAngles, int begin, int end);
+
+private:
+    int jointCount = 0;
+
+    std::vector<Instance> instances;
+    std::vector<float> angles;
+};
@@ -0,0 +1,125 @@
+#include "KeyframeTrack.h"
+
+#include <algorithm>
+
+bool KeyframeTrack::empty() const
+{
+    return keys.empty();
+}
+
+size_t KeyframeTrack::size() const
+{
+    return keys.size();
+}
+
+const std::vector<KeyframeTrack::Keyframe>& KeyframeTrack::getKeys() const
+{
+    return keys;
+}
+
+void KeyframeTrack::setKey(const Keyframe& kf)
+{
+    auto it = std::lower_bound(keys.begin(), keys.end(), kf.frame, [](const Keyframe& a, int f)
+    {
+        return a.frame < f;
+    });
+
+    if (it != keys.end() && it->frame == kf.frame)
+    {
+        *it = kf;
+    }
+    else
+    {
+        keys.insert(it, kf);
+    }
+}
+
+bool KeyframeTrack::removeKey(int frame)
+{
+    int i = findKey(frame);
+
+    if (i < 0 || keys[i].frame != frame)
+    {
+        return false;
+    }
+
+    keys.erase(keys.begin() + i);
+
+    return true;
+}
+
+void KeyframeTrack::clear()
+{
+    keys.clear();
+}
+
+void KeyframeTrack::assign(std::vector<Keyframe> inKeys)
+{
+    keys = std::move(inKeys);
+
+    if (std::is_sorted(keys.begin(), keys.end(), [](const Keyframe& a, const Keyframe& b) { return a.frame < b.frame; }))
+    {
+        return;
+    }
+
+    std::stable_sort(keys.begin(), keys.end(), [](const Keyframe& a, const Keyframe& b)
+    {
+        return a.frame < b.frame;
+    });
+}
+
+int KeyframeTrack::findKey(int frame) const
+{
+    auto it = std::upper_bound(keys.begin(), keys.end(), frame, [](int f, const Keyframe& a)
+    {
+        return f < a.frame;
+    });
+
+    return static_cast<int>(it - keys.begin()) - 1;
+}
+
+int KeyframeTrack::seek(int frame, Cursor& cursor) const
+{
+    int count = static_cast<int>(keys.size());
+
+    if (cursor.index >= count || frame < cursor.lastFrame)
+    {
+        cursor.index = findKey(frame);
+    }
+    else
+    {
+        while (cursor.index + 1 < count && keys[cursor.index + 1].frame <= frame)
+        {
+            ++cursor.index;
+        }
+    }
+
+    cursor.lastFrame = frame;
+
+    return cursor.index;
+}
+
+KeyframeTrack::Sample KeyframeTrack::sample(int frame, Cursor* cursor) const
+{
+    int i = cursor ? seek(frame, *cursor) : findKey(frame);
+
+    Sample out;
+
+    // Single key, before the first or past the last key, or exactly on a key: copy it.
+    if (keys.size() == 1 || i < 0)
+    {
+        out.hold = &keys[0];
+    }
+    else if (i + 1 >= static_cast<int>(keys.size()) || keys[i].frame == frame)
+    {
+        out.hold = &keys[i];
+    }
+    else
+    {
+        out.before = &keys[i];
+        out.after = &keys[i + 1];
+        out.t = static_cast<float>(frame - out.before->frame) / static_cast<float>(out.after->frame - out.before->frame);
+    }
+
+    return out;
+}
\ No newline at end of file
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// Frame-sorted keys of one body part. Random access finds the bracketing keys by binary search;
+// sequential evaluation can carry a Cursor so stepping forward a frame at a time is amortised O(1).
+class KeyframeTrack
+{
+public:
+    struct Keyframe
+    {
+        int frame = 0;
+        std::vector<float> angles;
+    };
+
+    // Index of the last key at or before lastFrame (-1 = before the first key); reset with Cursor().
+    struct Cursor
+    {
+        int index = -1;
+        int lastFrame = -1;
+    };
+
+    bool empty() const;
+    size_t size() const;
+
+    const std::vector<Keyframe>& getKeys() const;
+
+    // Inserts or replaces the key at kf.frame.
+    void setKey(const Keyframe& kf);
+    bool removeKey(int frame);
+    void clear();
+
+    // Replaces all keys; input may be unsorted.
+    void assign(std::vector<Keyframe> keys);
+
+    // Last key with key.frame <= frame, or -1.
+    int findKey(int frame) const;
+
+    // findKey through a cursor: walks forward from the previous lookup and falls back to a binary
+    // search when time moves backwards (scrubbing, or a looping clip restarting).
+    int seek(int frame, Cursor& cursor) const;
+
+    // Keys bracketing frame: copy hold when set, otherwise lerp before -> after by t.
+    struct Sample
+    {
+        const Keyframe* hold = nullptr;
+        const Keyframe* before = nullptr;
+        const Keyframe* after = nullptr;
+        float t = 0.0f;
+    };
+
+    // Requires a non-empty track.
+    Sample sample(int frame, Cursor* cursor = nullptr) const;
+
+private:
+    std::vector<Keyframe> keys;
+};
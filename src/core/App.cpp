@@ -1,36 +1,77 @@
 #include "App.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
 #include <filesystem>
-#include <iostream>
 #include <fstream>
 #include <chrono>
 #include <gtc/matrix_transform.hpp>
 
 #include "../util/ModelLoader.h"
 #include "../util/FileUtils.h"
+#include "../util/AllocationCounter.h"
+#include "../util/Log.h"
+#include "../scene/SceneGraph.h"
+#include "../animation/AngleLerp.h"
+#include "../animation/AnimationClipFormat.h"
 #include "imgui.h"
 #include "imgui_impl_glfw.h"
 #include "imgui_impl_opengl3.h"
 
-bool App::initialize()
+// --check-allocations runs the single rig, then the animated instanced crowd; each phase runs
+// kAllocationWarmupFrames uncounted frames, then kAllocationCheckFrames that must not allocate.
+static constexpr int kAllocationWarmupFrames = 60;
+static constexpr int kAllocationCheckFrames = 120;
+
+// GL thread time per frame spent creating textures and filling buffers for a background reload.
+static constexpr double kModelUploadBudgetMs = 4.0;
+
+int App::getExitCode() const
 {
+    return exitCode;
+}
+
+bool App::initialize(const LaunchOptions& options)
+{
+    launchTime = std::chrono::high_resolution_clock::now();
+
+    std::snprintf(modelPath, sizeof(modelPath), "%s", options.modelPath.c_str());
+    useModelCache = options.useModelCache;
+    optimizeMeshes = options.optimizeMeshes;
+    generateLods = options.generateLods;
+    winWidth = options.width;
+    winHeight = options.height;
+    headless = options.headless;
+    checkAllocations = options.checkAllocations;
+
     initializeGlfw();
     initializeGlad();
 
-    glfwSetMouseButtonCallback(window, App::mouseButtonCallback);
-    glfwSetCursorPosCallback(window, App::cursorPosCallback);
-    glfwSetScrollCallback(window, App::scrollCallback);
+    if (!headless.enabled)
+    {
+        glfwSetMouseButtonCallback(window, App::mouseButtonCallback);
+        glfwSetCursorPosCallback(window, App::cursorPosCallback);
+        glfwSetScrollCallback(window, App::scrollCallback);
 
-    initializeImGui();
+        initializeImGui();
+    }
 
     loadShaders();
 
-    robotRig.initialize();
+    threadPool = std::make_unique<ThreadPool>(std::max(1, (int)std::thread::hardware_concurrency()));
+
+    robotRig.initialize(robotShader, outlineShader);
+    crowdRenderer.initialize(crowdShader, robotShader);
+    crowdRenderer.setInstanceCount(crowdCount, crowdSpacing);
 
     camera.reset();
     projectionMatrix = glm::perspective(glm::radians(45.0f), (float)winWidth / (float)winHeight, 0.1f, 100.0f);
 
-    robotRig.onResize(winWidth, winHeight);
+    if (!headless.enabled)
+    {
+        robotRig.onResize(winWidth, winHeight);
+    }
 
     loadScene();
 
@@ -39,6 +80,19 @@ bool App::initialize()
 
 void App::initializeGlfw()
 {
+    if (headless.enabled)
+    {
+        if (!createHeadlessContext())
+        {
+            logging::print("Headless: could not create an OpenGL 3.3 context\n");
+            std::exit(1);
+        }
+
+        glfwSetWindowUserPointer(window, this);
+
+        return;
+    }
+
     if (!glfwInit())
     {
         std::exit(1);
@@ -62,6 +116,69 @@ void App::initializeGlfw()
     glfwSetWindowUserPointer(window, this);
 }
 
+bool App::createHeadlessContext()
+{
+#ifndef _WIN32
+    // Display-less nodes: GLFW's null platform has no window system at all and takes its context
+    // from EGL (surfaceless) or OSMesa, whichever is installed.
+    static const int kHeadlessContextApis[] = { GLFW_EGL_CONTEXT_API, GLFW_OSMESA_CONTEXT_API };
+
+    if (glfwPlatformSupported(GLFW_PLATFORM_NULL))
+    {
+        for (int api : kHeadlessContextApis)
+        {
+            glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+
+            if (!glfwInit())
+            {
+                break;
+            }
+
+            glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+            glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+            glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+            glfwWindowHint(GLFW_CONTEXT_CREATION_API, api);
+            glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+            window = glfwCreateWindow(winWidth, winHeight, "Hierarchical Modeling", nullptr, nullptr);
+
+            if (window)
+            {
+                glfwMakeContextCurrent(window);
+                return true;
+            }
+
+            glfwTerminate();
+        }
+    }
+#endif
+
+    // Otherwise a hidden window on the native platform; rendering never touches its framebuffer.
+    glfwInitHint(GLFW_PLATFORM, GLFW_ANY_PLATFORM);
+
+    if (!glfwInit())
+    {
+        return false;
+    }
+
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+    window = glfwCreateWindow(winWidth, winHeight, "Hierarchical Modeling", nullptr, nullptr);
+
+    if (!window)
+    {
+        glfwTerminate();
+        return false;
+    }
+
+    glfwMakeContextCurrent(window);
+
+    return true;
+}
+
 void App::initializeGlad()
 {
     if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
@@ -91,37 +208,180 @@ void App::loadShaders()
         std::exit(1);
     }
 
-    if (!pickShader.loadFromFiles("shaders/pick.vert", "shaders/pick.frag"))
+    if (!outlineShader.loadFromFiles("shaders/outline.vert", "shaders/outline.frag"))
     {
         std::exit(1);
     }
 
-    if (!outlineShader.loadFromFiles("shaders/outline.vert", "shaders/outline.frag"))
+    robotShader.bindUniformBlock("FrameData", RobotRig::kFrameDataBinding);
+    outlineShader.bindUniformBlock("FrameData", RobotRig::kFrameDataBinding);
+
+    // Instanced path shares the robot fragment stage; only the transform fetch differs.
+    if (!crowdShader.loadFromFiles("shaders/crowd.vert", "shaders/robot.frag"))
     {
         std::exit(1);
     }
+
+    crowdShader.bindUniformBlock("FrameData", RobotRig::kFrameDataBinding);
 }
 
 void App::loadScene()
 {
     if (rootNode)
     {
-        robotRig.setRootNode(nullptr);
+        robotRig.setRootNode(nullptr, nullptr);
         ModelLoader::destroyNodeGpu(rootNode);
+        ModelLoader::destroyFlatSceneGpu(flatScene);
         rootNode.reset();
     }
 
-    rootNode = ModelLoader::loadGlbOrGltf(modelPath);
-    robotRig.setRootNode(rootNode);
+    ModelLoader::LoadStats stats;
+
+    rootNode = ModelLoader::loadGlbOrGltf(modelPath, flatScene, getLoadOptions(), &stats);
+    robotRig.setRootNode(rootNode, flatScene);
 
     if (!rootNode)
     {
-        std::cout << "Failed to load model: " << modelPath << "\n";
+        logging::print("Failed to load model: %s\n", modelPath);
+
+        return;
+    }
+
+    benchmarks::reportLoadStats(stats);
+
+    startupLoadStats = stats;
+}
+
+ModelLoader::LoadOptions App::getLoadOptions() const
+{
+    ModelLoader::LoadOptions options;
+    options.packMeshArena = packMeshArena;
+    options.optimizeMeshes = optimizeMeshes;
+    options.generateLods = generateLods;
+    options.pool = threadPool.get();
+    options.cacheDir = useModelCache ? LaunchOptions::kModelCacheDir : "";
+
+    return options;
+}
+
+void App::startAsyncLoad()
+{
+    if (asyncLoad.active)
+    {
+        return;
+    }
+
+    // The pool is swapped for the worker's own below.
+    ModelLoader::LoadOptions options = getLoadOptions();
+
+    asyncLoad.active = true;
+    asyncLoad.path = modelPath;
+    asyncLoad.ready.store(false, std::memory_order_relaxed);
+    asyncLoad.pending.reset();
+
+    // The worker owns a pool of its own: parallelFor must come from a pool's owning thread, and the
+    // main pool stays free for crowd posing while the load runs.
+    asyncLoad.worker = std::thread([this, options]() mutable
+    {
+        ThreadPool pool(std::max(1, (int)std::thread::hardware_concurrency()));
+        options.pool = &pool;
+
+        asyncLoad.pending = ModelLoader::prepareModel(asyncLoad.path, options);
+        asyncLoad.ready.store(true, std::memory_order_release);
+    });
+}
+
+void App::pollAsyncLoad()
+{
+    if (!asyncLoad.active || !asyncLoad.ready.load(std::memory_order_acquire))
+    {
+        return;
+    }
+
+    if (asyncLoad.worker.joinable())
+    {
+        asyncLoad.worker.join();
+    }
+
+    if (!asyncLoad.pending)
+    {
+        logging::print("Failed to load model: %s\n", asyncLoad.path.c_str());
+        asyncLoad.active = false;
+
+        return;
+    }
+
+    if (!ModelLoader::uploadPreparedModel(*asyncLoad.pending, kModelUploadBudgetMs))
+    {
+        return;
+    }
+
+    ModelLoader::LoadStats stats;
+    std::shared_ptr<FlatScene> newFlat;
+    std::shared_ptr<SceneNode> newRoot = ModelLoader::finishPreparedModel(*asyncLoad.pending, newFlat, &stats);
+
+    asyncLoad.pending.reset();
+    asyncLoad.active = false;
+
+    if (!newRoot)
+    {
+        logging::print("Failed to load model: %s\n", asyncLoad.path.c_str());
+
+        return;
     }
+
+    // Swap between frames: the rig moves to the new scene before the old one's GPU data goes away.
+    robotRig.setRootNode(newRoot, newFlat);
+
+    if (rootNode)
+    {
+        ModelLoader::destroyNodeGpu(rootNode);
+        ModelLoader::destroyFlatSceneGpu(flatScene);
+    }
+
+    rootNode = newRoot;
+    flatScene = newFlat;
+
+    benchmarks::reportLoadStats(stats);
+}
+
+void App::cancelAsyncLoad()
+{
+    if (!asyncLoad.active)
+    {
+        return;
+    }
+
+    if (asyncLoad.worker.joinable())
+    {
+        asyncLoad.worker.join();
+    }
+
+    if (asyncLoad.pending)
+    {
+        ModelLoader::discardPreparedModel(*asyncLoad.pending);
+        asyncLoad.pending.reset();
+    }
+
+    asyncLoad.active = false;
 }
 
 void App::run()
 {
+    if (headless.enabled)
+    {
+        exitCode = rootNode ? headlessRenderer::render(headless, winWidth, winHeight, robotRig, robotShader, camera, *threadPool) : 1;
+
+        return;
+    }
+
+    if (checkAllocations && !startAllocationCheck())
+    {
+        exitCode = 1;
+
+        return;
+    }
+
     auto last = std::chrono::high_resolution_clock::now();
 
     while (!glfwWindowShouldClose(window))
@@ -132,30 +392,130 @@ void App::run()
         float dt = std::chrono::duration<float>(now - last).count();
         last = now;
 
+        frameArena.reset();
+
+        uint64_t allocationsBefore = allocationCounter::getCount();
+
         update(dt);
         render();
+
+        if (firstFramePending)
+        {
+            firstFramePending = false;
+
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - launchTime).count();
+            logging::print("Time to first frame: %.1f ms (model %s, load %.1f ms)\n", ms, startupLoadStats.cacheHit ? "from cache" : "from source", startupLoadStats.totalMs);
+        }
+
+        lastFrameAllocations = allocationCounter::getCount() - allocationsBefore;
+
+        if (checkAllocations)
+        {
+            stepAllocationCheck();
+        }
     }
 }
 
+bool App::startAllocationCheck()
+{
+    if (!allocationCounter::isEnabled())
+    {
+        logging::print("Allocation check: this build does not count allocations (build with /p:CountAllocations=true)\n");
+
+        return false;
+    }
+
+    if (!rootNode)
+    {
+        return false;
+    }
+
+    AnimationSystem& animSystem = robotRig.getAnimationSystem();
+
+    if (!headless.animPath.empty() && !animSystem.importFromFile(headless.animPath))
+    {
+        logging::print("Allocation check: cannot load animation %s\n", headless.animPath.c_str());
+
+        return false;
+    }
+
+    animSystem.play();
+
+    // Uncapped, so the check is not paced by the display.
+    glfwSwapInterval(0);
+
+    return true;
+}
+
+void App::stepAllocationCheck()
+{
+    int phaseFrames = kAllocationWarmupFrames + kAllocationCheckFrames;
+    int phase = allocationCheckFrame / phaseFrames;
+    int phaseFrame = allocationCheckFrame % phaseFrames;
+
+    ++allocationCheckFrame;
+
+    if (phaseFrame < kAllocationWarmupFrames)
+    {
+        return;
+    }
+
+    allocationCheckTotal += lastFrameAllocations;
+
+    if (phaseFrame + 1 < phaseFrames)
+    {
+        return;
+    }
+
+    logging::print("Allocation check (%s): %s, %llu heap allocations over %d frames\n", phase == 0 ? "single rig" : "animated crowd", allocationCheckTotal == 0 ? "PASS" : "FAIL", static_cast<unsigned long long>(allocationCheckTotal), kAllocationCheckFrames);
+
+    if (allocationCheckTotal != 0)
+    {
+        exitCode = 1;
+    }
+
+    allocationCheckTotal = 0;
+
+    if (phase == 0)
+    {
+        crowdEnabled = true;
+        crowdInstanced = true;
+        crowdAnimate = true;
+
+        return;
+    }
+
+    glfwSetWindowShouldClose(window, GLFW_TRUE);
+}
+
 void App::shutdown()
 {
-    robotRig.setRootNode(nullptr);
+    cancelAsyncLoad();
+
+    robotRig.setRootNode(nullptr, nullptr);
 
     if (rootNode)
     {
         ModelLoader::destroyNodeGpu(rootNode);
+        ModelLoader::destroyFlatSceneGpu(flatScene);
         rootNode.reset();
     }
 
+    crowdRenderer.shutdown();
     robotRig.shutdown();
 
+    threadPool.reset();
+
     robotShader.destroy();
-    pickShader.destroy();
     outlineShader.destroy();
+    crowdShader.destroy();
 
-    ImGui_ImplOpenGL3_Shutdown();
-    ImGui_ImplGlfw_Shutdown();
-    ImGui::DestroyContext();
+    if (!headless.enabled)
+    {
+        ImGui_ImplOpenGL3_Shutdown();
+        ImGui_ImplGlfw_Shutdown();
+        ImGui::DestroyContext();
+    }
 
     glfwDestroyWindow(window);
     glfwTerminate();
@@ -176,8 +536,20 @@ void App::update(float deltaTime)
         robotRig.onResize(winWidth, winHeight);
     }
 
+    pollAsyncLoad();
+
     robotRig.update(deltaTime);
 
+    smoothedFrameMs += (deltaTime * 1000.0f - smoothedFrameMs) * 0.05f;
+
+    if (crowdEnabled && crowdAnimate)
+    {
+        crowdTime += deltaTime;
+    }
+
+    crowdBenchmark.step(deltaTime);
+    lodBenchmark.step(deltaTime, getDrawnTriangleCount());
+
     bool allowKeyboard = true;
 
     if (ImGui::GetCurrentContext() != nullptr)
@@ -201,22 +573,63 @@ void App::render()
 
     drawImGui();
 
+    // Pose once per frame, after UI edits; every pass below reads the cached transforms.
+    robotRig.updatePose(threadPool.get());
+
     glm::vec3 eye = camera.getEye();
     glm::mat4 V = camera.getViewMatrix();
     glm::mat4 MVP = projectionMatrix * V;
 
-    glViewport(0, 0, winWidth, winHeight);
     glEnable(GL_DEPTH_TEST);
 
-    glClearColor(0.18f, 0.18f, 0.18f, 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    robotRig.beginScenePass(glm::vec4(0.18f, 0.18f, 0.18f, 1.0f));
 
     if (rootNode)
     {
-        robotRig.renderRobotScene(robotShader, MVP, eye);
-        robotRig.renderOutline(outlineShader, MVP);
+        robotRig.beginFrame(MVP, eye);
+
+        const std::shared_ptr<FlatScene>& flat = robotRig.getFlatScene();
+
+        if (crowdEnabled && flat)
+        {
+            sceneGraph::Frustum frustum = sceneGraph::extractFrustum(MVP);
+            const sceneGraph::Frustum* cullFrustum = robotRig.getFrustumCulling() ? &frustum : nullptr;
+
+            sceneGraph::LodView lodView;
+            lodView.viewProj = MVP;
+            lodView.viewportHeight = static_cast<float>(winHeight);
+            lodView.maxPixelError = robotRig.getLodPixelError();
+            const sceneGraph::LodView* crowdLodView = robotRig.getMeshLods() ? &lodView : nullptr;
+
+            if (crowdAnimate)
+            {
+                crowdRenderer.updateTransformsPerInstance(*flat, updateCrowdAnimation(), cullFrustum, crowdLodView);
+            }
+            else
+            {
+                // Every instance shares the cached pose; instance 0 sits where the single rig would.
+                crowdRenderer.updateTransforms(*flat, robotRig.getWorldTransforms().data(), cullFrustum, crowdLodView);
+            }
+
+            if (crowdInstanced)
+            {
+                crowdRenderer.renderInstanced(crowdShader, *flat);
+            }
+            else
+            {
+                crowdRenderer.renderPerInstance(robotShader, *flat);
+            }
+        }
+        else
+        {
+            robotRig.renderRobotScene(robotShader);
+        }
+
+        robotRig.renderOutline(outlineShader);
     }
 
+    robotRig.endScenePass(window);
+
     ImGui::Render();
     ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 
@@ -228,10 +641,41 @@ void App::drawImGui()
     ImGui::Begin("Robot Controls");
 
     ImGui::InputText("Model Path", modelPath, sizeof(modelPath));
+    ImGui::Checkbox("Packed Mesh Arena", &packMeshArena);
+    ImGui::SameLine();
+    ImGui::Checkbox("Model Cache", &useModelCache);
+    ImGui::SameLine();
+    ImGui::Checkbox("Optimize Meshes", &optimizeMeshes);
+    ImGui::SameLine();
+    ImGui::Checkbox("Generate LODs", &generateLods);
+
+    ImGui::BeginDisabled(asyncLoad.active);
 
     if (ImGui::Button("Reload Model"))
     {
-        loadScene();
+        startAsyncLoad();
+    }
+
+    ImGui::EndDisabled();
+
+    ImGui::SameLine();
+
+    if (ImGui::Button("Run Load Benchmark"))
+    {
+        benchmarks::runLoadBenchmark(modelPath, getLoadOptions());
+    }
+
+    ImGui::SameLine();
+
+    if (ImGui::Button("Run Cache Benchmark"))
+    {
+        benchmarks::runCacheBenchmark(modelPath, getLoadOptions());
+    }
+
+    if (asyncLoad.active)
+    {
+        ImGui::SameLine();
+        ImGui::TextUnformatted(asyncLoad.ready.load(std::memory_order_acquire) ? "Uploading..." : "Loading...");
     }
 
     ImGui::Separator();
@@ -321,89 +765,47 @@ void App::drawImGui()
 
     ImGui::Separator();
 
-    struct BodyPartUiItem
+    // Labels indexed by RobotRig body part id.
+    static const char* bodyPartLabels[RobotRig::kBodyPartCount] =
     {
-        const char* key;
-        const char* label;
+        "Torso",
+        "Head",
+        "L Arm (U)",
+        "L Arm (L)",
+        "R Arm (U)",
+        "R Arm (L)",
+        "L Leg (U)",
+        "L Leg (L)",
+        "R Leg (U)",
+        "R Leg (L)",
+        "L Hand",
+        "R Hand"
     };
 
-    static BodyPartUiItem bodyParts[12] =
-    {
-        { "torso", "Torso" },
-        { "head", "Head" },
-        { "left_arm_high", "L Arm (U)" },
-        { "left_arm_low", "L Arm (L)" },
-        { "right_arm_high", "R Arm (U)" },
-        { "right_arm_low", "R Arm (L)" },
-        { "left_leg_high", "L Leg (U)" },
-        { "left_leg_low", "L Leg (L)" },
-        { "right_leg_high", "R Leg (U)" },
-        { "right_leg_low", "R Leg (L)" },
-        { "left_hand", "L Hand" },
-        { "right_hand", "R Hand" }
-    };
+    const unsigned int allBodyPartsMask = (1u << RobotRig::kBodyPartCount) - 1u;
 
     ImGui::Text("Keyframe Target Body Parts (none = all)");
 
-    static bool selectAllBodyPartsUi = false;
+    bool selectAllBodyPartsUi = (bodyPartMaskUi == allBodyPartsMask);
 
     if (ImGui::Checkbox("All Body Parts", &selectAllBodyPartsUi))
     {
-        for (int i = 0; i < 12; ++i)
-        {
-            bodyPartSelectedUi[i] = selectAllBodyPartsUi;
-        }
+        bodyPartMaskUi = selectAllBodyPartsUi ? allBodyPartsMask : 0u;
     }
 
     ImGui::Separator();
 
-    bool anyChanged = false;
-
     if (ImGui::BeginTable("BodyPartsTable", 2, ImGuiTableFlags_SizingStretchSame))
     {
-        for (int i = 0; i < 12; ++i)
+        for (int i = 0; i < RobotRig::kBodyPartCount; ++i)
         {
             ImGui::TableNextColumn();
-
-            if (ImGui::Checkbox(bodyParts[i].label, &bodyPartSelectedUi[i]))
-            {
-                anyChanged = true;
-            }
+            ImGui::CheckboxFlags(bodyPartLabels[i], &bodyPartMaskUi, 1u << i);
         }
 
         ImGui::EndTable();
     }
 
-    if (anyChanged)
-    {
-        bool allSelected = true;
-
-        for (int i = 0; i < 12; ++i)
-        {
-            if (!bodyPartSelectedUi[i])
-            {
-                allSelected = false;
-
-                break;
-            }
-        }
-
-        selectAllBodyPartsUi = allSelected;
-    }
-
-    std::vector<std::string> selectedParts;
-    selectedParts.reserve(12);
-
-    for (int i = 0; i < 12; ++i)
-    {
-        if (bodyPartSelectedUi[i])
-        {
-            selectedParts.push_back(bodyParts[i].key);
-        }
-    }
-
-    std::vector<std::string>* partsPtr = selectedParts.empty() ? nullptr : &selectedParts;
-
     ImGui::Separator();
 
     ImGui::Text("Frame: %d / %d", animSystem.getCurrentFrame(), animSystem.getMaxFrame());
@@ -426,26 +828,26 @@ void App::drawImGui()
     if (ImGui::Button("Stop"))
     {
         animSystem.stop();
-        theta = animSystem.getCurrentAngles(theta);
+        animSystem.sampleBaked(animSystem.getCurrentFrame(), theta.data());
     }
 
     int frame = animSystem.getCurrentFrame();
     if (ImGui::SliderInt("Timeline", &frame, 0, animSystem.getMaxFrame()))
     {
         animSystem.setFrame(frame);
-        theta = animSystem.getCurrentAngles(theta);
+        animSystem.sampleBaked(animSystem.getCurrentFrame(), theta.data());
     }
 
     if (ImGui::Button("Set Keyframe"))
     {
-        animSystem.setKeyframe(animSystem.getCurrentFrame(), theta, partsPtr);
+        animSystem.setKeyframe(animSystem.getCurrentFrame(), theta, bodyPartMaskUi);
     }
 
     ImGui::SameLine();
 
     if (ImGui::Button("Delete Keyframe"))
     {
-        animSystem.removeKeyframe(animSystem.getCurrentFrame(), partsPtr);
+        animSystem.removeKeyframe(animSystem.getCurrentFrame(), bodyPartMaskUi);
     }
 
     ImGui::Separator();
@@ -459,9 +861,25 @@ void App::drawImGui()
         std::filesystem::path fileName = std::filesystem::path(saveAnimPath).filename();
         std::filesystem::path outPath = std::filesystem::path("savedAnimations") / fileName;
 
-        std::string text = animSystem.exportToJsonString();
-        std::ofstream out(outPath.string(), std::ios::out | std::ios::trunc);
-        out << text;
+        std::ofstream out(outPath.string(), std::ios::out | std::ios::trunc | std::ios::binary);
+        animSystem.exportToJson(out);
+    }
+
+    ImGui::SameLine();
+
+    if (ImGui::Button("Save Animation Binary"))
+    {
+        std::filesystem::create_directories("savedAnimations");
+
+        std::filesystem::path fileName = std::filesystem::path(saveAnimPath).filename().replace_extension(animationClipFormat::kFileExtension);
+        std::filesystem::path outPath = std::filesystem::path("savedAnimations") / fileName;
+
+        std::vector<unsigned char> bytes;
+
+        if (animSystem.exportToBinary(bytes))
+        {
+            fileUtils::writeBytesToFile(outPath.string(), bytes);
+        }
     }
 
     ImGui::InputText("Load Anim Path", loadAnimPath, sizeof(loadAnimPath));
@@ -471,13 +889,13 @@ void App::drawImGui()
         std::filesystem::path fileName = std::filesystem::path(loadAnimPath).filename();
         std::filesystem::path inPath = std::filesystem::path("savedAnimations") / fileName;
 
-        std::string text;
-        if (fileUtils::readFileToString(inPath.string(), text))
+        std::ifstream in(inPath.string(), std::ios::in | std::ios::binary);
+        if (in)
         {
             try
             {
-                animSystem.importFromJsonString(text);
-                theta = animSystem.getCurrentAngles(theta);
+                animSystem.importFromJson(in);
+                animSystem.sampleBaked(animSystem.getCurrentFrame(), theta.data());
             }
             catch (...)
             {
@@ -485,11 +903,64 @@ void App::drawImGui()
         }
     }
 
+    ImGui::SameLine();
+
+    if (ImGui::Button("Load Animation Binary"))
+    {
+        std::filesystem::path fileName = std::filesystem::path(loadAnimPath).filename().replace_extension(animationClipFormat::kFileExtension);
+        std::filesystem::path inPath = std::filesystem::path("savedAnimations") / fileName;
+
+        if (animSystem.importFromBinaryFile(inPath.string()))
+        {
+            animSystem.sampleBaked(animSystem.getCurrentFrame(), theta.data());
+        }
+    }
+
+    if (ImGui::Button("Convert Saved JSON to Binary"))
+    {
+        benchmarks::convertSavedAnimationsToBinary(animSystem);
+    }
+
+    ImGui::SameLine();
+
+    if (ImGui::Button("Run Clip Format Benchmark"))
+    {
+        benchmarks::runClipFormatBenchmark(animSystem, loadAnimPath);
+    }
+
+    ImGui::Separator();
+
+    drawCrowdImGui();
+
     ImGui::Separator();
 
     const std::string& selected = robotRig.getSelectedNodeName();
     ImGui::Text("Selection: %s", selected.empty() ? "(none)" : selected.c_str());
 
+    if (robotRig.getHoveredPart() >= 0)
+    {
+        ImGui::Text("Hover: %s (instance %d)", RobotRig::getBodyPartName(robotRig.getHoveredPart()), robotRig.getHoveredInstance());
+    }
+    else
+    {
+        ImGui::Text("Hover: (none)");
+    }
+
+    int pickMode = (int)robotRig.getPickMode();
+
+    ImGui::Text("Click picking:");
+    ImGui::SameLine();
+    ImGui::RadioButton("ID Buffer", &pickMode, (int)RobotRig::PickMode::IdBuffer);
+    ImGui::SameLine();
+    ImGui::RadioButton("CPU Ray", &pickMode, (int)RobotRig::PickMode::CpuRay);
+
+    robotRig.setPickMode((RobotRig::PickMode)pickMode);
+
+    if (ImGui::Button("Run Pick Benchmark"))
+    {
+        benchmarks::runPickBenchmark(robotRig, projectionMatrix * camera.getViewMatrix(), threadPool.get());
+    }
+
     if (ImGui::Button("Clear Selection"))
     {
         robotRig.clearSelection();
@@ -498,6 +969,186 @@ void App::drawImGui()
     ImGui::End();
 }
 
+void App::drawCrowdImGui()
+{
+    const std::shared_ptr<FlatScene>& flat = robotRig.getFlatScene();
+    int maxCount = flat ? crowdRenderer.getMaxInstanceCount(*flat) : 1;
+
+    ImGui::Text("Crowd");
+
+    ImGui::BeginDisabled(crowdBenchmark.isRunning() || lodBenchmark.isRunning());
+
+    ImGui::Checkbox("Enable Crowd", &crowdEnabled);
+    ImGui::SameLine();
+    ImGui::Checkbox("Instanced", &crowdInstanced);
+    ImGui::SameLine();
+    ImGui::Checkbox("Animate Instances", &crowdAnimate);
+
+    if (ImGui::SliderInt("Instances", &crowdCount, 1, std::min(maxCount, 4096)))
+    {
+        crowdCount = std::clamp(crowdCount, 1, maxCount);
+        crowdRenderer.setInstanceCount(crowdCount, crowdSpacing);
+    }
+
+    if (ImGui::Button("Run Crowd Benchmark"))
+    {
+        benchmarks::CrowdBenchmark::Target target;
+        target.enabled = &crowdEnabled;
+        target.instanced = &crowdInstanced;
+        target.count = &crowdCount;
+        target.spacing = crowdSpacing;
+        target.maxCount = maxCount;
+        target.renderer = &crowdRenderer;
+
+        crowdBenchmark.start(target);
+    }
+
+    ImGui::SameLine();
+
+    if (ImGui::Button("Run Animation Benchmark"))
+    {
+        benchmarks::runAnimationBenchmark(robotRig);
+    }
+
+    ImGui::SameLine();
+
+    if (ImGui::Button("Run LOD Benchmark"))
+    {
+        benchmarks::LodBenchmark::Target target;
+        target.camera = &camera;
+        target.rig = &robotRig;
+        target.crowdInstances = crowdEnabled ? crowdRenderer.getInstanceCount() : 0;
+
+        lodBenchmark.start(target);
+    }
+
+    ImGui::EndDisabled();
+
+    if (crowdBenchmark.isRunning())
+    {
+        ImGui::SameLine();
+        ImGui::Text("Running %d / %d", crowdBenchmark.getStep() + 1, crowdBenchmark.getStepCount());
+    }
+
+    if (lodBenchmark.isRunning())
+    {
+        ImGui::SameLine();
+        ImGui::Text("Running %d / %d", lodBenchmark.getStep() + 1, lodBenchmark.getStepCount());
+    }
+
+    ImGui::Text("Draw calls: %d", crowdEnabled ? crowdRenderer.getLastDrawCalls() : 0);
+    ImGui::Text("Frame time: %.2f ms", smoothedFrameMs);
+
+    bool culling = robotRig.getFrustumCulling();
+
+    if (ImGui::Checkbox("Frustum Culling", &culling))
+    {
+        robotRig.setFrustumCulling(culling);
+    }
+
+    if (crowdEnabled)
+    {
+        ImGui::Text("Culled instances: %d / %d", crowdRenderer.getCulledInstanceCount(), crowdRenderer.getInstanceCount());
+    }
+    else
+    {
+        const RobotRig::CullStats& cull = robotRig.getCullStats();
+        ImGui::Text("Culled nodes: %d / %d (%d whole subtrees)", cull.culledNodes, cull.culledNodes + cull.drawnNodes, cull.culledSubtrees);
+    }
+
+    bool lods = robotRig.getMeshLods();
+
+    if (ImGui::Checkbox("Mesh LODs", &lods))
+    {
+        robotRig.setMeshLods(lods);
+    }
+
+    float lodPixelError = robotRig.getLodPixelError();
+
+    if (ImGui::SliderFloat("LOD Pixel Error", &lodPixelError, 0.25f, 8.0f, "%.2f px"))
+    {
+        robotRig.setLodPixelError(lodPixelError);
+    }
+
+    int perLevel[GpuMesh::kMaxLods];
+
+    for (int l = 0; l < GpuMesh::kMaxLods; ++l)
+    {
+        perLevel[l] = crowdEnabled ? crowdRenderer.getLodInstanceCount(l) : robotRig.getLodStats().nodesPerLevel[l];
+    }
+
+    ImGui::Text("Triangles: %llu", (unsigned long long)getDrawnTriangleCount());
+    ImGui::Text("%s per LOD: %d / %d / %d / %d", crowdEnabled ? "Instances" : "Nodes", perLevel[0], perLevel[1], perLevel[2], perLevel[3]);
+
+    ImGui::Separator();
+
+    if (allocationCounter::isEnabled())
+    {
+        ImGui::Text("Heap allocations last frame: %llu", (unsigned long long)lastFrameAllocations);
+    }
+    else
+    {
+        ImGui::TextDisabled("Heap allocations: not counted in this build");
+    }
+
+    ImGui::Text("Frame arena: %.1f KB peak / %.1f KB", frameArena.getPeakBytes() / 1024.0, frameArena.getCapacity() / 1024.0);
+
+    ImGui::Text("Joint lerp kernel: %s", angleLerp::getKernelName(angleLerp::getActiveKernel()));
+    ImGui::SameLine();
+
+    if (ImGui::Button("Run Lerp Benchmark"))
+    {
+        benchmarks::runLerpBenchmark();
+    }
+}
+
+uint64_t App::getDrawnTriangleCount() const
+{
+    bool crowdDrawn = crowdEnabled && robotRig.getFlatScene();
+
+    return crowdDrawn ? crowdRenderer.getLastTriangleCount() : robotRig.getLodStats().triangles;
+}
+
+const glm::mat4* App::updateCrowdAnimation()
+{
+    const std::shared_ptr<FlatScene>& flat = robotRig.getFlatScene();
+    int count = crowdRenderer.getInstanceCount();
+
+    if (crowdAnimator.getInstanceCount() != count)
+    {
+        crowdAnimator.resize(count, RobotRig::kJointCount);
+
+        // Spread instances over the clip so the crowd does not move in lockstep.
+        for (int i = 0; i < count; ++i)
+        {
+            CrowdAnimator::Instance& inst = crowdAnimator.getInstance(i);
+            float phase = std::fmod((float)i * 0.618034f, 1.0f);
+
+            inst.clip = 0;
+            inst.timeOffset = (float)i * 0.173f;
+            inst.speed = 0.85f + 0.3f * phase;
+        }
+    }
+
+    robotRig.getAnimationSystem().bake();
+
+    const AnimationSystem* clip = &robotRig.getAnimationSystem();
+    crowdAnimator.evaluate(&clip, 1, crowdTime, robotRig.getAngles().data(), *threadPool);
+
+    size_t nodeCount = static_cast<size_t>(flat->getNodeCount());
+    glm::mat4* world = frameArena.allocate<glm::mat4>(static_cast<size_t>(count) * nodeCount);
+
+    threadPool->parallelFor(count, RobotRig::kPoseInstancesPerTask, [&](int begin, int end)
+    {
+        for (int i = begin; i < end; ++i)
+        {
+            robotRig.poseInstance(crowdAnimator.getInstanceAngles(i), world + static_cast<size_t>(i) * nodeCount);
+        }
+    });
+
+    return world;
+}
+
 void App::onMouseButton(int button, int action, int mods)
 {
     (void)mods;
@@ -528,7 +1179,7 @@ void App::onMouseButton(int button, int action, int mods)
 
     if (action == GLFW_PRESS)
     {
-        bool hit = robotRig.onLeftMousePress(window, MVP, pickShader);
+        bool hit = robotRig.onLeftMousePress(window, MVP);
         if (!hit)
         {
             camera.beginOrbit(window);
@@ -537,7 +1188,7 @@ void App::onMouseButton(int button, int action, int mods)
     else if (action == GLFW_RELEASE)
     {
         camera.endOrbit();
-        robotRig.onLeftMouseRelease(window, MVP, pickShader);
+        robotRig.onLeftMouseRelease(window, MVP);
     }
 }
 
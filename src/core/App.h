@@ -1,35 +1,69 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <string>
+#include <thread>
 #include <memory>
+#include <vector>
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <glm.hpp>
 
 #include "../scene/SceneTypes.h"
 #include "../scene/RobotRig.h"
+#include "../scene/CrowdRenderer.h"
+#include "../animation/CrowdAnimator.h"
+#include "../util/ThreadPool.h"
+#include "../util/FrameArena.h"
 #include "../util/ShaderLoader.h"
+#include "../util/ModelLoader.h"
 #include "../scene/CameraController.h"
+#include "Benchmarks.h"
+#include "CommandLine.h"
 
 class App
 {
 public:
-    bool initialize();
+    bool initialize(const LaunchOptions& options);
     void run();
     void shutdown();
 
+    int getExitCode() const;
+
 private:
     void initializeGlfw();
+    bool createHeadlessContext();
     void initializeGlad();
     void initializeImGui();
 
     void loadShaders();
     void loadScene();
+    ModelLoader::LoadOptions getLoadOptions() const;
+
+    // Non-blocking reload: the worker prepares the model, then pollAsyncLoad uploads it a slice per
+    // frame and swaps it in once it is complete.
+    void startAsyncLoad();
+    void pollAsyncLoad();
+    void cancelAsyncLoad();
 
     void update(float deltaTime);
     void render();
 
+    // --check-allocations: startAllocationCheck loads the clip and starts playback, stepAllocationCheck
+    // runs after every frame and closes the window once both phases are counted.
+    bool startAllocationCheck();
+    void stepAllocationCheck();
+
     void drawImGui();
+    void drawCrowdImGui();
+
+    // Triangles submitted last frame by the crowd or the single rig, whichever is drawn.
+    uint64_t getDrawnTriangleCount() const;
+
+    // Returns the instance-major crowd world transforms, allocated from the frame arena.
+    const glm::mat4* updateCrowdAnimation();
 
 public:
     static void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods);
@@ -48,19 +82,71 @@ private:
     int winHeight = 1080;
 
     ShaderProgram robotShader;
-    ShaderProgram pickShader;
     ShaderProgram outlineShader;
+    ShaderProgram crowdShader;
 
     std::shared_ptr<SceneNode> rootNode;
+    std::shared_ptr<FlatScene> flatScene;
+
+    // The model being loaded in the background; rootNode / flatScene keep rendering until it replaces them.
+    struct AsyncModelLoad
+    {
+        bool active = false;
+        std::string path;
+        std::thread worker;
+
+        // Set by the worker once pending is written; pending is only read after that.
+        std::atomic<bool> ready{ false };
+        std::shared_ptr<ModelLoader::PendingModel> pending;
+    } asyncLoad;
 
     glm::mat4 projectionMatrix = glm::mat4(1.0f);
 
     CameraController camera;
     RobotRig robotRig;
+    CrowdRenderer crowdRenderer;
+    CrowdAnimator crowdAnimator;
+    std::unique_ptr<ThreadPool> threadPool;
+
+    // Transient per-frame data; rewound at the top of every frame.
+    FrameArena frameArena;
 
-    bool bodyPartSelectedUi[12] = { false };
+    uint64_t lastFrameAllocations = 0;
 
-    char modelPath[512] = "robotModel/robot.glb";
+    // --check-allocations progress: frames run so far and allocations counted in the current phase.
+    bool checkAllocations = false;
+    int allocationCheckFrame = 0;
+    uint64_t allocationCheckTotal = 0;
+
+    bool crowdEnabled = false;
+    bool crowdInstanced = true;
+    bool crowdAnimate = false;
+    float crowdTime = 0.0f;
+    int crowdCount = 64;
+    float crowdSpacing = 1.5f;
+    float smoothedFrameMs = 0.0f;
+
+    benchmarks::CrowdBenchmark crowdBenchmark;
+
+    benchmarks::LodBenchmark lodBenchmark;
+
+    // Keyframe target body parts, one bit per RobotRig body part id (0 = all).
+    unsigned int bodyPartMaskUi = 0;
+
+    char modelPath[512] = {};
+    bool packMeshArena = true;
+    bool useModelCache = true;
+    bool optimizeMeshes = true;
+    bool generateLods = true;
+
+    // Time to first frame is measured from the start of initialize() and printed once.
+    std::chrono::high_resolution_clock::time_point launchTime;
+    ModelLoader::LoadStats startupLoadStats;
+    bool firstFramePending = true;
     char saveAnimPath[512] = "robot-animation.json";
     char loadAnimPath[512] = "robot-animation.json";
+
+    HeadlessOptions headless;
+
+    int exitCode = 0;
 };
\ No newline at end of file
@@ -0,0 +1,687 @@
+#include "Benchmarks.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <nlohmann/json.hpp>
+
+#include "../util/FileUtils.h"
+#include "../util/MappedFile.h"
+#include "../util/Log.h"
+#include "../util/ThreadPool.h"
+#include "../scene/CameraController.h"
+#include "../scene/CrowdRenderer.h"
+#include "../scene/RobotRig.h"
+#include "../animation/AngleLerp.h"
+#include "../animation/AnimationClipFormat.h"
+#include "../animation/AnimationSystem.h"
+#include "../animation/CrowdAnimator.h"
+
+static constexpr int kCrowdBenchmarkCounts[] = { 1, 16, 64, 256, 1024, 4096 };
+static constexpr int kCrowdBenchmarkSteps = 2 * static_cast<int>(sizeof(kCrowdBenchmarkCounts) / sizeof(kCrowdBenchmarkCounts[0]));
+
+// Camera distances for the LOD benchmark, each measured with LODs off and on.
+static constexpr float kLodBenchmarkRadii[] = { 2.0f, 5.0f, 10.0f, 15.0f, 20.0f };
+static constexpr int kLodBenchmarkSteps = 2 * static_cast<int>(sizeof(kLodBenchmarkRadii) / sizeof(kLodBenchmarkRadii[0]));
+
+static constexpr int kAnimBenchmarkThreads[] = { 1, 2, 4, 8, 16 };
+static constexpr int kAnimBenchmarkInstances = 4096;
+static constexpr int kAnimBenchmarkIterations = 50;
+
+// Lanes per lerp benchmark run: one rig, and a 4096-instance crowd.
+static constexpr size_t kLerpBenchmarkWidths[] = { (size_t)RobotRig::kJointCount, (size_t)RobotRig::kJointCount * 4096 };
+static constexpr size_t kLerpBenchmarkLanes = 50000000;
+
+// Rays per side of the screen-space grid cast by the pick benchmark.
+static constexpr int kPickBenchmarkGrid = 256;
+
+// The clip format benchmark repeats the loaded take this many times back to back.
+static constexpr int kClipBenchmarkRepeats = 1000;
+
+void benchmarks::reportLoadStats(const ModelLoader::LoadStats& stats, const char* prefix)
+{
+    if (stats.cacheHit)
+    {
+        logging::print("%sModel load: %.1f ms from cache (%d textures, %d meshes) - hash + open %.1f, GL upload %.1f over %d steps\n",
+            prefix, stats.totalMs, stats.imageCount, stats.primitiveCount, stats.parseMs, stats.uploadMs, stats.uploadSteps);
+    }
+    else
+    {
+        logging::print("%sModel load: %.1f ms on %d threads (%d images, %d primitives, %d zero-copy) - parse %.1f, decode %.1f, convert %.1f, cache write %.1f, GL upload %.1f over %d steps\n",
+            prefix, stats.totalMs, stats.threadCount, stats.imageCount, stats.primitiveCount, stats.zeroCopyPrimitiveCount, stats.parseMs, stats.decodeMs, stats.convertMs, stats.cacheWriteMs, stats.uploadMs, stats.uploadSteps);
+    }
+
+    const meshOptimizer::Stats& mesh = stats.meshStats;
+
+    if (mesh.trianglesBefore > 0)
+    {
+        logging::print("  mesh optimisation: vertices %llu -> %llu, triangles %llu -> %llu, ACMR %.3f -> %.3f, overdraw %.3f -> %.3f\n",
+            static_cast<unsigned long long>(mesh.verticesBefore), static_cast<unsigned long long>(mesh.verticesAfter),
+            static_cast<unsigned long long>(mesh.trianglesBefore), static_cast<unsigned long long>(mesh.trianglesAfter),
+            mesh.getAcmrBefore(), mesh.getAcmrAfter(), mesh.getOverdrawBefore(), mesh.getOverdrawAfter());
+    }
+
+    const uint64_t* lod = stats.lodTriangles;
+
+    if (lod[1] < lod[0])
+    {
+        logging::print("  LOD triangles: %llu / %llu / %llu / %llu\n",
+            static_cast<unsigned long long>(lod[0]), static_cast<unsigned long long>(lod[1]), static_cast<unsigned long long>(lod[2]), static_cast<unsigned long long>(lod[3]));
+    }
+}
+
+void benchmarks::runLoadBenchmark(const std::string& modelPath, const ModelLoader::LoadOptions& options)
+{
+    logging::print("Load benchmark: %s\n", modelPath.c_str());
+
+    // With optimisation on, the third load carries the stats, so the timed passes stay clean.
+    int passes = options.optimizeMeshes ? 3 : 2;
+
+    for (int pass = 0; pass < passes; ++pass)
+    {
+        ModelLoader::LoadOptions passOptions = options;
+        passOptions.measureMeshStats = (pass == 2);
+        passOptions.pool = (pass == 0) ? nullptr : options.pool;
+        passOptions.cacheDir.clear();
+
+        ModelLoader::LoadStats stats;
+        std::shared_ptr<FlatScene> flat;
+        std::shared_ptr<SceneNode> root = ModelLoader::loadGlbOrGltf(modelPath, flat, passOptions, &stats);
+
+        if (!root)
+        {
+            logging::print("  failed to load\n");
+
+            return;
+        }
+
+        reportLoadStats(stats, "  ");
+
+        ModelLoader::destroyNodeGpu(root);
+        ModelLoader::destroyFlatSceneGpu(flat);
+    }
+}
+
+void benchmarks::runCacheBenchmark(const std::string& modelPath, const ModelLoader::LoadOptions& options)
+{
+    logging::print("Model cache benchmark: %s\n", modelPath.c_str());
+
+    // A private cache directory, so the first pass is guaranteed cold and the real cache is untouched.
+    std::error_code ec;
+    std::filesystem::path cacheDir = std::filesystem::temp_directory_path(ec) / "hm-model-cache-benchmark";
+    std::filesystem::remove_all(cacheDir, ec);
+
+    double passMs[2] = { 0.0, 0.0 };
+
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        ModelLoader::LoadOptions passOptions = options;
+        passOptions.packMeshArena = true;
+        passOptions.cacheDir = cacheDir.string();
+
+        ModelLoader::LoadStats stats;
+        std::shared_ptr<FlatScene> flat;
+        std::shared_ptr<SceneNode> root = ModelLoader::loadGlbOrGltf(modelPath, flat, passOptions, &stats);
+
+        if (!root)
+        {
+            logging::print("  failed to load\n");
+
+            break;
+        }
+
+        reportLoadStats(stats, pass == 0 ? "  cold " : "  warm ");
+
+        passMs[pass] = stats.totalMs;
+
+        ModelLoader::destroyNodeGpu(root);
+        ModelLoader::destroyFlatSceneGpu(flat);
+    }
+
+    if (passMs[1] > 0.0)
+    {
+        logging::print("  warm load is %.1fx faster\n", passMs[0] / passMs[1]);
+    }
+
+    std::filesystem::remove_all(cacheDir, ec);
+}
+
+void benchmarks::runLerpBenchmark()
+{
+    logging::print("Joint lerp benchmark (%zu lanes per row)\n", kLerpBenchmarkLanes);
+    logging::print("  width     kernel   ns/lane   speedup   bit-identical\n");
+
+    for (size_t width : kLerpBenchmarkWidths)
+    {
+        std::vector<float> from(width);
+        std::vector<float> to(width);
+        std::vector<float> weights(width);
+        std::vector<float> reference(width);
+        std::vector<float> out(width);
+
+        // Deterministic angles spread over several turns so both wrap branches are exercised.
+        unsigned int seed = 12345u;
+
+        auto next = [&seed]()
+        {
+            seed = seed * 1664525u + 1013904223u;
+
+            return (float)(seed >> 8) / 16777216.0f;
+        };
+
+        for (size_t i = 0; i < width; ++i)
+        {
+            from[i] = next() * 720.0f - 360.0f;
+            to[i] = next() * 720.0f - 360.0f;
+            weights[i] = next();
+        }
+
+        angleLerp::lerpWrapped(angleLerp::Kernel::Scalar, from.data(), to.data(), weights.data(), reference.data(), width);
+
+        size_t iterations = std::max<size_t>(1, kLerpBenchmarkLanes / width);
+        double scalarNs = 0.0;
+
+        for (int k = 0; k < (int)angleLerp::Kernel::Count; ++k)
+        {
+            angleLerp::Kernel kernel = (angleLerp::Kernel)k;
+
+            if (!angleLerp::isSupported(kernel))
+            {
+                continue;
+            }
+
+            auto t0 = std::chrono::high_resolution_clock::now();
+
+            for (size_t it = 0; it < iterations; ++it)
+            {
+                angleLerp::lerpWrapped(kernel, from.data(), to.data(), weights.data(), out.data(), width);
+            }
+
+            auto t1 = std::chrono::high_resolution_clock::now();
+
+            double ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / (double)(iterations * width);
+
+            if (kernel == angleLerp::Kernel::Scalar)
+            {
+                scalarNs = ns;
+            }
+
+            bool identical = std::memcmp(out.data(), reference.data(), width * sizeof(float)) == 0;
+
+            logging::print("  %7zu   %6s   %7.3f   %6.2fx   %s\n", width, angleLerp::getKernelName(kernel), ns, scalarNs / std::max(ns, 1e-9), identical ? "yes" : "NO");
+        }
+    }
+}
+
+void benchmarks::runAnimationBenchmark(RobotRig& rig)
+{
+    const std::shared_ptr<FlatScene>& flat = rig.getFlatScene();
+    rig.getAnimationSystem().bake();
+
+    const AnimationSystem* clip = &rig.getAnimationSystem();
+
+    CrowdAnimator animator;
+    animator.resize(kAnimBenchmarkInstances, RobotRig::kJointCount);
+
+    for (int i = 0; i < kAnimBenchmarkInstances; ++i)
+    {
+        animator.getInstance(i).timeOffset = (float)i * 0.173f;
+    }
+
+    size_t nodeCount = flat ? static_cast<size_t>(flat->getNodeCount()) : 0;
+    std::vector<glm::mat4> world(static_cast<size_t>(kAnimBenchmarkInstances) * nodeCount);
+
+    logging::print("Animation benchmark (%d instances, %d iterations)\n", kAnimBenchmarkInstances, kAnimBenchmarkIterations);
+    logging::print("  threads   evaluate inst/ms   evaluate+pose inst/ms\n");
+
+    for (int threads : kAnimBenchmarkThreads)
+    {
+        ThreadPool pool(threads);
+
+        auto t0 = std::chrono::high_resolution_clock::now();
+
+        for (int it = 0; it < kAnimBenchmarkIterations; ++it)
+        {
+            animator.evaluate(&clip, 1, (float)it / 60.0f, rig.getAngles().data(), pool);
+        }
+
+        auto t1 = std::chrono::high_resolution_clock::now();
+
+        for (int it = 0; it < kAnimBenchmarkIterations && nodeCount > 0; ++it)
+        {
+            animator.evaluate(&clip, 1, (float)it / 60.0f, rig.getAngles().data(), pool);
+
+            pool.parallelFor(kAnimBenchmarkInstances, RobotRig::kPoseInstancesPerTask, [&](int begin, int end)
+            {
+                for (int i = begin; i < end; ++i)
+                {
+                    rig.poseInstance(animator.getInstanceAngles(i), world.data() + static_cast<size_t>(i) * nodeCount);
+                }
+            });
+        }
+
+        auto t2 = std::chrono::high_resolution_clock::now();
+
+        double evalMs = std::chrono::duration<double, std::milli>(t1 - t0).count();
+        double poseMs = std::chrono::duration<double, std::milli>(t2 - t1).count();
+        double total = (double)kAnimBenchmarkInstances * kAnimBenchmarkIterations;
+
+        logging::print("  %7d   %16.1f   %21.1f\n", threads, total / std::max(evalMs, 1e-6), nodeCount > 0 ? total / std::max(poseMs, 1e-6) : 0.0);
+    }
+}
+
+void benchmarks::runPickBenchmark(RobotRig& rig, const glm::mat4& viewProj, ThreadPool* pool)
+{
+    rig.updatePose(pool);
+
+    glm::mat4 inv = glm::inverse(viewProj);
+
+    std::vector<glm::vec3> origins;
+    std::vector<glm::vec3> dirs;
+    origins.reserve(kPickBenchmarkGrid * kPickBenchmarkGrid);
+    dirs.reserve(kPickBenchmarkGrid * kPickBenchmarkGrid);
+
+    // Same unprojection as a click, over an even grid of pixel centres.
+    for (int j = 0; j < kPickBenchmarkGrid; ++j)
+    {
+        for (int i = 0; i < kPickBenchmarkGrid; ++i)
+        {
+            float x = ((float)i + 0.5f) / kPickBenchmarkGrid * 2.0f - 1.0f;
+            float y = ((float)j + 0.5f) / kPickBenchmarkGrid * 2.0f - 1.0f;
+
+            glm::vec4 nearPoint = inv * glm::vec4(x, y, -1.0f, 1.0f);
+            glm::vec4 farPoint = inv * glm::vec4(x, y, 1.0f, 1.0f);
+
+            origins.push_back(glm::vec3(nearPoint) / nearPoint.w);
+            dirs.push_back(glm::vec3(farPoint) / farPoint.w - origins.back());
+        }
+    }
+
+    int hits = 0;
+
+    auto t0 = std::chrono::high_resolution_clock::now();
+
+    for (size_t k = 0; k < origins.size(); ++k)
+    {
+        if (rig.raycastNode(origins[k], dirs[k]) >= 0)
+        {
+            ++hits;
+        }
+    }
+
+    auto t1 = std::chrono::high_resolution_clock::now();
+
+    double us = std::chrono::duration<double, std::micro>(t1 - t0).count() / (double)origins.size();
+
+    logging::print("Pick benchmark: %zu rays, %d hits, %g us per ray cast\n", origins.size(), hits, us);
+}
+
+void benchmarks::convertSavedAnimationsToBinary(const AnimationSystem& layout)
+{
+    std::error_code ec;
+
+    for (const auto& entry : std::filesystem::directory_iterator("savedAnimations", ec))
+    {
+        if (!entry.is_regular_file() || entry.path().extension() != ".json")
+        {
+            continue;
+        }
+
+        std::ifstream in(entry.path().string(), std::ios::in | std::ios::binary);
+
+        if (!in)
+        {
+            continue;
+        }
+
+        // A copy keeps the rig's body part layout without touching the open animation.
+        AnimationSystem clip = layout;
+
+        try
+        {
+            clip.importFromJson(in);
+        }
+        catch (...)
+        {
+            logging::print("Skipping %s: not a valid animation\n", entry.path().string().c_str());
+
+            continue;
+        }
+
+        std::vector<unsigned char> bytes;
+
+        if (!clip.exportToBinary(bytes))
+        {
+            logging::print("Skipping %s: negative key frames\n", entry.path().string().c_str());
+
+            continue;
+        }
+
+        std::filesystem::path outPath = entry.path();
+        outPath.replace_extension(animationClipFormat::kFileExtension);
+
+        if (fileUtils::writeBytesToFile(outPath.string(), bytes))
+        {
+            logging::print("%s (%llu bytes) -> %s (%zu bytes)\n", entry.path().string().c_str(), static_cast<unsigned long long>(entry.file_size()), outPath.string().c_str(), bytes.size());
+        }
+    }
+}
+
+void benchmarks::runClipFormatBenchmark(const AnimationSystem& layout, const std::string& clipName)
+{
+    std::filesystem::path jsonSource = std::filesystem::path("savedAnimations") / std::filesystem::path(clipName).filename();
+
+    std::string text;
+    AnimationSystem take = layout;
+
+    if (!fileUtils::readFileToString(jsonSource.string(), text))
+    {
+        logging::print("Clip format benchmark: cannot read %s\n", jsonSource.string().c_str());
+
+        return;
+    }
+
+    try
+    {
+        take.importFromJsonString(text);
+    }
+    catch (...)
+    {
+        logging::print("Clip format benchmark: %s is not a valid animation\n", jsonSource.string().c_str());
+
+        return;
+    }
+
+    // Scale the sample into a long take by repeating it back to back.
+    AnimationSystem scaled = layout;
+    scaled.clearKeyframes();
+
+    int period = take.getMaxFrame() + 1;
+    size_t keyCount = 0;
+
+    for (int part = 0; part < take.getBodyPartCount(); ++part)
+    {
+        std::vector<AnimationSystem::Keyframe> keys = take.getKeyframesForBodyPart(part);
+        std::vector<AnimationSystem::Keyframe> repeated;
+        repeated.reserve(keys.size() * kClipBenchmarkRepeats);
+
+        for (int r = 0; r < kClipBenchmarkRepeats; ++r)
+        {
+            for (const AnimationSystem::Keyframe& kf : keys)
+            {
+                repeated.push_back(kf);
+                repeated.back().frame += r * period;
+            }
+        }
+
+        keyCount += repeated.size();
+        scaled.setBodyPartKeyframes(part, std::move(repeated));
+    }
+
+    std::vector<unsigned char> bytes;
+
+    if (!scaled.exportToBinary(bytes))
+    {
+        logging::print("Clip format benchmark: %s has negative key frames\n", jsonSource.string().c_str());
+
+        return;
+    }
+
+    std::filesystem::path tempDir = std::filesystem::temp_directory_path();
+    std::filesystem::path jsonPath = tempDir / "hm-clip-benchmark.json";
+    std::filesystem::path binaryPath = tempDir / "hm-clip-benchmark.hmclip";
+
+    auto e0 = std::chrono::high_resolution_clock::now();
+    {
+        std::ofstream out(jsonPath.string(), std::ios::out | std::ios::trunc | std::ios::binary);
+        scaled.exportToJson(out);
+    }
+    auto e1 = std::chrono::high_resolution_clock::now();
+
+    size_t jsonBytes = static_cast<size_t>(std::filesystem::file_size(jsonPath));
+
+    fileUtils::writeBytesToFile(binaryPath.string(), bytes);
+
+    AnimationSystem loaded = layout;
+
+    // The previous DOM path (read whole file, json::parse, walk the tree) for comparison.
+    auto d0 = std::chrono::high_resolution_clock::now();
+
+    std::string readBack;
+    fileUtils::readFileToString(jsonPath.string(), readBack);
+    nlohmann::json dom = nlohmann::json::parse(readBack, nullptr, false);
+
+    auto d1 = std::chrono::high_resolution_clock::now();
+
+    auto t0 = std::chrono::high_resolution_clock::now();
+    {
+        std::ifstream in(jsonPath.string(), std::ios::in | std::ios::binary);
+        loaded.importFromJson(in);
+    }
+    auto t1 = std::chrono::high_resolution_clock::now();
+
+    // Mapping and decoding are timed apart: the decode into editable tracks is the part that grows with the clip.
+    MappedFile mapped;
+    bool binaryOk = mapped.open(binaryPath.string());
+
+    auto t2 = std::chrono::high_resolution_clock::now();
+
+    if (binaryOk)
+    {
+        try
+        {
+            loaded.importFromBinary(mapped.getData(), mapped.getSize());
+        }
+        catch (...)
+        {
+            binaryOk = false;
+        }
+    }
+
+    auto t3 = std::chrono::high_resolution_clock::now();
+
+    mapped.close();
+
+    double exportMs = std::chrono::duration<double, std::milli>(e1 - e0).count();
+    double domMs = std::chrono::duration<double, std::milli>(d1 - d0).count();
+    double jsonMs = std::chrono::duration<double, std::milli>(t1 - t0).count();
+    double mapMs = std::chrono::duration<double, std::milli>(t2 - t1).count();
+    double decodeMs = std::chrono::duration<double, std::milli>(t3 - t2).count();
+    double binaryMs = mapMs + decodeMs;
+
+    logging::print("Clip format benchmark (%s x%d, %zu keys)\n", jsonSource.filename().string().c_str(), kClipBenchmarkRepeats, keyCount);
+    logging::print("  JSON    %10zu bytes   load %8.2f ms   save %8.2f ms (streamed)\n", jsonBytes, jsonMs, exportMs);
+    logging::print("  JSON    DOM parse only       %8.2f ms (%.1f MB/s streamed vs %.1f MB/s DOM)\n", domMs, jsonBytes / 1.0e3 / std::max(jsonMs, 1e-6), jsonBytes / 1.0e3 / std::max(domMs, 1e-6));
+    logging::print("  binary  %10zu bytes   load %8.2f ms (map %.2f, decode %.2f = %.1f ns per key)%s\n", bytes.size(), binaryMs, mapMs, decodeMs, decodeMs * 1.0e6 / std::max<size_t>(1, keyCount), binaryOk ? "" : " (failed)");
+    logging::print("  ratio   %10.1fx smaller      %6.1fx faster\n", (double)jsonBytes / std::max<size_t>(1, bytes.size()), jsonMs / std::max(binaryMs, 1e-6));
+
+    std::error_code ec;
+    std::filesystem::remove(jsonPath, ec);
+    std::filesystem::remove(binaryPath, ec);
+}
+
+void benchmarks::StepTimer::reset()
+{
+    frame = 0;
+    accumMs = 0.0;
+}
+
+bool benchmarks::StepTimer::addFrame(float deltaTime)
+{
+    ++frame;
+
+    if (frame > kSweepWarmupFrames)
+    {
+        accumMs += deltaTime * 1000.0;
+    }
+
+    return frame >= kSweepWarmupFrames + kSweepMeasureFrames;
+}
+
+float benchmarks::StepTimer::getMeanMs() const
+{
+    return static_cast<float>(accumMs / kSweepMeasureFrames);
+}
+
+void benchmarks::CrowdBenchmark::start(const Target& inTarget)
+{
+    target = inTarget;
+
+    savedEnabled = *target.enabled;
+    savedInstanced = *target.instanced;
+    savedCount = *target.count;
+
+    running = true;
+    currentStep = 0;
+    results.clear();
+
+    // Unthrottled frames so the measurement is not pinned to the display refresh.
+    glfwSwapInterval(0);
+
+    beginStep();
+}
+
+void benchmarks::CrowdBenchmark::step(float deltaTime)
+{
+    if (!running || !timer.addFrame(deltaTime))
+    {
+        return;
+    }
+
+    Result result;
+    result.instances = target.renderer->getInstanceCount();
+    result.instanced = *target.instanced;
+    result.drawCalls = target.renderer->getLastDrawCalls();
+    result.frameMs = timer.getMeanMs();
+    results.push_back(result);
+
+    if (++currentStep < kCrowdBenchmarkSteps)
+    {
+        beginStep();
+
+        return;
+    }
+
+    running = false;
+
+    *target.enabled = savedEnabled;
+    *target.instanced = savedInstanced;
+    *target.count = savedCount;
+    target.renderer->setInstanceCount(savedCount, target.spacing);
+
+    glfwSwapInterval(1);
+
+    logging::print("Crowd benchmark (%d frames per row)\n", kSweepMeasureFrames);
+    logging::print("  instances  path          draw calls   frame ms\n");
+
+    for (const Result& r : results)
+    {
+        logging::print("  %9d  %-12s  %10d  %9.3f\n", r.instances, r.instanced ? "instanced" : "per-instance", r.drawCalls, r.frameMs);
+    }
+}
+
+bool benchmarks::CrowdBenchmark::isRunning() const
+{
+    return running;
+}
+
+int benchmarks::CrowdBenchmark::getStep() const
+{
+    return currentStep;
+}
+
+int benchmarks::CrowdBenchmark::getStepCount() const
+{
+    return kCrowdBenchmarkSteps;
+}
+
+void benchmarks::CrowdBenchmark::beginStep()
+{
+    *target.enabled = true;
+    *target.instanced = (currentStep % 2) == 0;
+    target.renderer->setInstanceCount(std::min(kCrowdBenchmarkCounts[currentStep / 2], target.maxCount), target.spacing);
+
+    timer.reset();
+}
+
+void benchmarks::LodBenchmark::start(const Target& inTarget)
+{
+    target = inTarget;
+
+    savedRadius = target.camera->getRadius();
+    savedLods = target.rig->getMeshLods();
+
+    running = true;
+    currentStep = 0;
+    results.clear();
+
+    glfwSwapInterval(0);
+
+    beginStep();
+}
+
+void benchmarks::LodBenchmark::step(float deltaTime, uint64_t drawnTriangles)
+{
+    if (!running || !timer.addFrame(deltaTime))
+    {
+        return;
+    }
+
+    Result result;
+    result.radius = target.camera->getRadius();
+    result.lods = target.rig->getMeshLods();
+    result.triangles = drawnTriangles;
+    result.frameMs = timer.getMeanMs();
+    results.push_back(result);
+
+    if (++currentStep < kLodBenchmarkSteps)
+    {
+        beginStep();
+
+        return;
+    }
+
+    running = false;
+
+    target.camera->setRadius(savedRadius);
+    target.rig->setMeshLods(savedLods);
+
+    glfwSwapInterval(1);
+
+    std::string mode = target.crowdInstances > 0 ? std::to_string(target.crowdInstances) + " instances" : std::string("single rig");
+
+    logging::print("LOD benchmark (%s, %g px error, %d frames per row)\n", mode.c_str(), target.rig->getLodPixelError(), kSweepMeasureFrames);
+    logging::print("  radius  LODs   triangles   frame ms\n");
+
+    for (const Result& r : results)
+    {
+        logging::print("  %6.1f  %-4s  %10llu  %9.3f\n", r.radius, r.lods ? "on" : "off", static_cast<unsigned long long>(r.triangles), r.frameMs);
+    }
+}
+
+bool benchmarks::LodBenchmark::isRunning() const
+{
+    return running;
+}
+
+int benchmarks::LodBenchmark::getStep() const
+{
+    return currentStep;
+}
+
+int benchmarks::LodBenchmark::getStepCount() const
+{
+    return kLodBenchmarkSteps;
+}
+
+void benchmarks::LodBenchmark::beginStep()
+{
+    target.camera->setRadius(kLodBenchmarkRadii[currentStep / 2]);
+    target.rig->setMeshLods((currentStep % 2) == 1);
+
+    timer.reset();
+}
\ No newline at end of file
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <glm.hpp>
+
+#include "../util/ModelLoader.h"
+
+class AnimationSystem;
+class CameraController;
+class CrowdRenderer;
+class RobotRig;
+class ThreadPool;
+
+// Benchmarks and diagnostics behind the debug UI. Results are printed with logging::print.
+namespace benchmarks
+{
+    // One line per load, then mesh optimisation and LOD lines when the stats carry them.
+    void reportLoadStats(const ModelLoader::LoadStats& stats, const char* prefix = "");
+
+    // Loads modelPath serially, then on options.pool; each copy is freed straight away and the live scene
+    // is untouched. With optimisation on, a third pooled load measures its effect.
+    void runLoadBenchmark(const std::string& modelPath, const ModelLoader::LoadOptions& options);
+
+    // A cold and then a warm packed-arena load through a private cache directory.
+    void runCacheBenchmark(const std::string& modelPath, const ModelLoader::LoadOptions& options);
+
+    // Every supported angleLerp kernel against the scalar one, for a single rig and a large crowd.
+    void runLerpBenchmark();
+
+    // Crowd evaluate, then evaluate + pose, at several pool sizes.
+    void runAnimationBenchmark(RobotRig& rig);
+
+    // CPU ray casts over an even screen grid under viewProj.
+    void runPickBenchmark(RobotRig& rig, const glm::mat4& viewProj, ThreadPool* pool);
+
+    // Writes a binary clip next to every savedAnimations/*.json; layout supplies the rig's body parts.
+    void convertSavedAnimationsToBinary(const AnimationSystem& layout);
+
+    // JSON vs binary size and load time for savedAnimations/clipName repeated into a long take.
+    void runClipFormatBenchmark(const AnimationSystem& layout, const std::string& clipName);
+
+    // Frame-driven sweeps: each step skips kSweepWarmupFrames, then averages the next kSweepMeasureFrames.
+    constexpr int kSweepWarmupFrames = 10;
+    constexpr int kSweepMeasureFrames = 60;
+
+    struct StepTimer
+    {
+        int frame = 0;
+        double accumMs = 0.0;
+
+        void reset();
+
+        // True once the step has seen all of its frames.
+        bool addFrame(float deltaTime);
+        float getMeanMs() const;
+    };
+
+    // Sweeps instance counts over both crowd draw paths with vsync off. The settings it drives belong to
+    // App; start() saves them and the last step restores them.
+    class CrowdBenchmark
+    {
+    public:
+        struct Target
+        {
+            bool* enabled = nullptr;
+            bool* instanced = nullptr;
+            int* count = nullptr;
+            float spacing = 0.0f;
+            int maxCount = 1;
+            CrowdRenderer* renderer = nullptr;
+        };
+
+        void start(const Target& inTarget);
+
+        // Once per frame while running.
+        void step(float deltaTime);
+
+        bool isRunning() const;
+        int getStep() const;
+        int getStepCount() const;
+
+    private:
+        struct Result
+        {
+            int instances = 0;
+            bool instanced = false;
+            int drawCalls = 0;
+            float frameMs = 0.0f;
+        };
+
+        void beginStep();
+
+    private:
+        Target target;
+        bool running = false;
+        int currentStep = 0;
+        StepTimer timer;
+        std::vector<Result> results;
+
+        bool savedEnabled = false;
+        bool savedInstanced = true;
+        int savedCount = 0;
+    };
+
+    // Sweeps the camera distance with mesh LODs off and on, in whichever mode (single rig or crowd) is drawn.
+    class LodBenchmark
+    {
+    public:
+        struct Target
+        {
+            CameraController* camera = nullptr;
+            RobotRig* rig = nullptr;
+
+            // Drawn crowd size for the report title; 0 for the single rig.
+            int crowdInstances = 0;
+        };
+
+        void start(const Target& inTarget);
+
+        // Once per frame while running; drawnTriangles is what the last frame submitted.
+        void step(float deltaTime, uint64_t drawnTriangles);
+
+        bool isRunning() const;
+        int getStep() const;
+        int getStepCount() const;
+
+    private:
+        struct Result
+        {
+            float radius = 0.0f;
+            bool lods = false;
+            uint64_t triangles = 0;
+            float frameMs = 0.0f;
+        };
+
+        void beginStep();
+
+    private:
+        Target target;
+        bool running = false;
+        int currentStep = 0;
+        StepTimer timer;
+        std::vector<Result> results;
+
+        float savedRadius = 0.0f;
+        bool savedLods = true;
+    };
+}
\ No newline at end of file
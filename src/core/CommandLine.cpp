@@ -0,0 +1,148 @@
+#include "CommandLine.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+#include "../util/Log.h"
+#include "../animation/AnimationClipFormat.h"
+
+static void printUsage(const char* program)
+{
+    logging::print("Usage: %s [--model <path>] [--no-model-cache] [--no-mesh-optimize] [--no-lods] [--headless --anim <path> [--size <W>x<H>] [--out <dir>] [--frames <N>]] [--check-allocations [--anim <path>]]\n", program);
+    logging::print("  --no-model-cache  always load the model from source (neither reads nor writes %s/)\n", LaunchOptions::kModelCacheDir);
+    logging::print("  --no-mesh-optimize  keep the model's own vertex and triangle order\n");
+    logging::print("  --no-lods    do not generate simplified mesh LODs while loading\n");
+    logging::print("  --headless   render the animation offscreen to <dir>/frame_NNNNN.png and exit\n");
+    logging::print("  --anim       .json or %s clip to play (required with --headless)\n", animationClipFormat::kFileExtension);
+    logging::print("  --size       output resolution (default 1280x720)\n");
+    logging::print("  --out        output directory (default renders)\n");
+    logging::print("  --frames     number of frames (default: the whole clip)\n");
+    logging::print("  --check-allocations  play the clip and the animated crowd, then exit non-zero if a frame allocated after warm-up\n");
+}
+
+// Options that consume the following argument.
+static bool takesValue(const std::string& arg)
+{
+    return arg == "--model" || arg == "--anim" || arg == "--out" || arg == "--frames" || arg == "--size";
+}
+
+bool commandLine::parse(int argc, char** argv, LaunchOptions& outOptions)
+{
+    bool sizeGiven = false;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+
+        if (arg == "--headless")
+        {
+            outOptions.headless.enabled = true;
+            continue;
+        }
+
+        if (arg == "--check-allocations")
+        {
+            outOptions.checkAllocations = true;
+            continue;
+        }
+
+        if (arg == "--no-model-cache")
+        {
+            outOptions.useModelCache = false;
+            continue;
+        }
+
+        if (arg == "--no-mesh-optimize")
+        {
+            outOptions.optimizeMeshes = false;
+            continue;
+        }
+
+        if (arg == "--no-lods")
+        {
+            outOptions.generateLods = false;
+            continue;
+        }
+
+        if (arg == "--help" || arg == "-h")
+        {
+            printUsage(argv[0]);
+            return false;
+        }
+
+        if (!takesValue(arg))
+        {
+            logging::print("Unknown argument %s\n", arg.c_str());
+            printUsage(argv[0]);
+            return false;
+        }
+
+        if (!value)
+        {
+            logging::print("Missing value for %s\n", arg.c_str());
+            printUsage(argv[0]);
+            return false;
+        }
+
+        ++i;
+
+        if (arg == "--model")
+        {
+            outOptions.modelPath = value;
+        }
+        else if (arg == "--anim")
+        {
+            outOptions.headless.animPath = value;
+        }
+        else if (arg == "--out")
+        {
+            outOptions.headless.outputDir = value;
+        }
+        else if (arg == "--frames")
+        {
+            outOptions.headless.frameCount = std::max(0, std::atoi(value));
+        }
+        else if (arg == "--size")
+        {
+            int w = 0;
+            int h = 0;
+
+            if (std::sscanf(value, "%dx%d", &w, &h) != 2 || w <= 0 || h <= 0)
+            {
+                logging::print("Bad --size %s, expected <W>x<H>\n", value);
+                return false;
+            }
+
+            outOptions.width = w;
+            outOptions.height = h;
+            sizeGiven = true;
+        }
+    }
+
+    if (outOptions.headless.enabled && outOptions.checkAllocations)
+    {
+        logging::print("--headless and --check-allocations cannot be combined\n");
+        printUsage(argv[0]);
+        return false;
+    }
+
+    if (outOptions.headless.enabled)
+    {
+        if (outOptions.headless.animPath.empty())
+        {
+            logging::print("--headless needs --anim\n");
+            printUsage(argv[0]);
+            return false;
+        }
+
+        if (!sizeGiven)
+        {
+            outOptions.width = 1280;
+            outOptions.height = 720;
+        }
+    }
+
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <string>
+
+#include "../scene/HeadlessRenderer.h"
+
+// Start-up settings the command line can override; App::initialize takes them from here.
+struct LaunchOptions
+{
+    // GPU-ready copies of loaded .glb models, keyed by source hash (see ModelCacheFormat.h).
+    static constexpr const char* kModelCacheDir = "modelCache";
+
+    std::string modelPath = "robotModel/robot.glb";
+    bool useModelCache = true;
+    bool optimizeMeshes = true;
+    bool generateLods = true;
+
+    // Window size, or the offscreen target size when headless.
+    int width = 1920;
+    int height = 1080;
+
+    HeadlessOptions headless;
+
+    // Runs the windowed frame loop with headless.animPath playing (if given) and exits non-zero on any
+    // heap allocation after warm-up. Needs a build with HM_COUNT_ALLOCATIONS (see AllocationCounter.h).
+    bool checkAllocations = false;
+};
+
+namespace commandLine
+{
+    // Returns false (after printing usage) on bad arguments or --help.
+    bool parse(int argc, char** argv, LaunchOptions& outOptions);
+}
\ No newline at end of file
@@ -1,10 +1,17 @@
 #include "core/App.h"
 
-int main()
+int main(int argc, char** argv)
 {
+    LaunchOptions options;
+
+    if (!commandLine::parse(argc, argv, options))
+    {
+        return 1;
+    }
+
     App app;
 
-    if (!app.initialize())
+    if (!app.initialize(options))
     {
         return 1;
     }
@@ -12,5 +19,5 @@ int main()
     app.run();
     app.shutdown();
 
-    return 0;
+    return app.getExitCode();
 }
\ No newline at end of file
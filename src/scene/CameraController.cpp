@@ -178,8 +178,17 @@ void CameraController::onMouseMove(double x, double y)
 
 void CameraController::onScroll(double yOffset)
 {
-    cameraRadius += (float)yOffset * 0.1f;
-    cameraRadius = std::max(0.5f, std::min(20.0f, cameraRadius));
+    setRadius(cameraRadius + (float)yOffset * 0.1f);
+}
+
+float CameraController::getRadius() const
+{
+    return cameraRadius;
+}
+
+void CameraController::setRadius(float radius)
+{
+    cameraRadius = std::max(kMinRadius, std::min(kMaxRadius, radius));
 }
 
 bool CameraController::getIsOrbiting() const
@@ -7,6 +7,10 @@
 class CameraController
 {
 public:
+    // Orbit distance range reachable with the scroll wheel.
+    static constexpr float kMinRadius = 0.5f;
+    static constexpr float kMaxRadius = 20.0f;
+
     void reset();
 
     void updateKeyboard(GLFWwindow* window, float deltaTime, bool allowKeyboard);
@@ -24,6 +28,10 @@ public:
     glm::vec3 getEye() const;
     glm::mat4 getViewMatrix() const;
 
+    // Orbit distance from the look-at point, clamped to [kMinRadius, kMaxRadius].
+    float getRadius() const;
+    void setRadius(float radius);
+
 private:
     glm::vec3 sphericalToCartesian(float radius, float theta, float phi) const;
 
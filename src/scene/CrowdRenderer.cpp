@@ -0,0 +1,574 @@
+#include "CrowdRenderer.h"
+#include "SceneGraph.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <gtc/matrix_transform.hpp>
+
+// Texture units: 0 = base colour (shared with the robot shader), 1 = instance transforms, 2 = instance ids.
+static constexpr int kInstanceTransformUnit = 1;
+static constexpr int kInstanceIdUnit = 2;
+
+// Grows the buffer when needed, otherwise orphans it so the driver does not wait on last frame's draws.
+static void uploadStream(GLenum target, GLuint buffer, const void* data, size_t bytes, size_t& capacity)
+{
+    glBindBuffer(target, buffer);
+
+    if (bytes > capacity)
+    {
+        glBufferData(target, bytes, data, GL_STREAM_DRAW);
+        capacity = bytes;
+    }
+    else
+    {
+        glBufferData(target, capacity, nullptr, GL_STREAM_DRAW);
+        glBufferSubData(target, 0, bytes, data);
+    }
+
+    glBindBuffer(target, 0);
+}
+
+bool CrowdRenderer::initialize(const ShaderProgram& crowdShader, const ShaderProgram& robotShader)
+{
+    // Sampler units never change, so they are program state set once rather than per frame.
+    crowdShader.bind();
+    crowdShader.setInt("uSampler", 0);
+    crowdShader.setInt("uInstanceTransforms", kInstanceTransformUnit);
+    crowdShader.setInt("uInstanceIds", kInstanceIdUnit);
+
+    uSlotCount = crowdShader.getUniform<int>("uSlotCount");
+    uNodeSlot = crowdShader.getUniform<int>("uNodeSlot");
+    uNodePickId = crowdShader.getUniform<GLuint>("uNodePickId");
+    uInstanceBase = crowdShader.getUniform<int>("uInstanceBase");
+
+    robotShader.bind();
+    robotShader.setInt("uSampler", 0);
+
+    uModel = robotShader.getUniform<glm::mat4>("model");
+    uNormalMatrix = robotShader.getUniform<glm::mat3>("normalMatrix");
+    uPickId = robotShader.getUniform<GLuint>("uPickId");
+
+    glGenBuffers(1, &tbo);
+    glBindBuffer(GL_TEXTURE_BUFFER, tbo);
+    glBufferData(GL_TEXTURE_BUFFER, sizeof(glm::mat4), nullptr, GL_STREAM_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    glGenTextures(1, &tboTex);
+    glBindTexture(GL_TEXTURE_BUFFER, tboTex);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, tbo);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+
+    glGenBuffers(1, &idTbo);
+    glBindBuffer(GL_TEXTURE_BUFFER, idTbo);
+    glBufferData(GL_TEXTURE_BUFFER, sizeof(GLuint), nullptr, GL_STREAM_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    glGenTextures(1, &idTboTex);
+    glBindTexture(GL_TEXTURE_BUFFER, idTboTex);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_R32UI, idTbo);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+
+    glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels);
+
+    uploadedBytes = sizeof(glm::mat4);
+    uploadedIdBytes = sizeof(GLuint);
+
+    setInstanceCount(1, 1.0f);
+
+    return tbo != 0 && tboTex != 0 && idTbo != 0 && idTboTex != 0;
+}
+
+void CrowdRenderer::shutdown()
+{
+    if (tboTex != 0) glDeleteTextures(1, &tboTex);
+    if (tbo != 0) glDeleteBuffers(1, &tbo);
+
+    if (idTboTex != 0) glDeleteTextures(1, &idTboTex);
+    if (idTbo != 0) glDeleteBuffers(1, &idTbo);
+
+    tboTex = 0;
+    tbo = 0;
+    idTboTex = 0;
+    idTbo = 0;
+    uploadedBytes = 0;
+    uploadedIdBytes = 0;
+
+    instanceRoots.clear();
+    instanceMatrices.clear();
+    visibleInstances.clear();
+    visibleLods.clear();
+    groupedMatrices.clear();
+    groupedInstances.clear();
+    instanceLods.clear();
+    drawNodes.clear();
+}
+
+void CrowdRenderer::setInstanceCount(int count, float spacing)
+{
+    count = std::max(1, count);
+
+    instanceRoots.resize(static_cast<size_t>(count));
+    instanceLods.assign(static_cast<size_t>(count), 0);
+
+    // Square spiral so instance 0 sits at the origin and the crowd grows outward evenly.
+    int x = 0;
+    int z = 0;
+    int dx = 1;
+    int dz = 0;
+    int legLength = 1;
+    int legStep = 0;
+    int legsDone = 0;
+
+    for (int i = 0; i < count; ++i)
+    {
+        instanceRoots[i] = glm::translate(glm::mat4(1.0f), glm::vec3((float)x * spacing, 0.0f, (float)z * spacing));
+
+        x += dx;
+        z += dz;
+
+        if (++legStep == legLength)
+        {
+            legStep = 0;
+            int t = dx;
+            dx = -dz;
+            dz = t;
+
+            if (++legsDone % 2 == 0)
+            {
+                ++legLength;
+            }
+        }
+    }
+}
+
+int CrowdRenderer::getInstanceCount() const
+{
+    return static_cast<int>(instanceRoots.size());
+}
+
+int CrowdRenderer::getMaxInstanceCount(const FlatScene& scene) const
+{
+    int slots = 0;
+
+    for (int n = 0; n < scene.getNodeCount(); ++n)
+    {
+        if (scene.meshRanges[n].count > 0)
+        {
+            ++slots;
+        }
+    }
+
+    if (slots == 0 || maxTexels <= 0)
+    {
+        return 1;
+    }
+
+    return std::max(1, maxTexels / (slots * 4));
+}
+
+const glm::mat4& CrowdRenderer::getInstanceRoot(int instance) const
+{
+    return instanceRoots[instance];
+}
+
+void CrowdRenderer::rebuildDrawSlots(const FlatScene& scene)
+{
+    drawNodes.clear();
+
+    for (int n = 0; n < scene.getNodeCount(); ++n)
+    {
+        if (scene.meshRanges[n].count > 0)
+        {
+            drawNodes.push_back(n);
+        }
+    }
+
+    instanceMatrices.resize(instanceRoots.size() * drawNodes.size());
+    visibleInstances.clear();
+    visibleInstances.reserve(instanceRoots.size());
+    visibleLods.clear();
+    visibleLods.reserve(instanceRoots.size());
+}
+
+// Worst error per level over the drawn nodes of one pose, scaled by each node's world scale.
+void CrowdRenderer::computeLodErrors(const FlatScene& scene, const glm::mat4* nodeWorld)
+{
+    lodLevelCount = 1;
+
+    for (int l = 0; l < GpuMesh::kMaxLods; ++l)
+    {
+        lodErrors[l] = 0.0f;
+    }
+
+    for (int n : drawNodes)
+    {
+        lodLevelCount = std::max(lodLevelCount, scene.nodeLodCounts[n]);
+
+        float scale = sceneGraph::getMaxScale(nodeWorld[n]);
+
+        for (int l = 0; l < GpuMesh::kMaxLods; ++l)
+        {
+            lodErrors[l] = std::max(lodErrors[l], scene.nodeLodErrors[static_cast<size_t>(n) * GpuMesh::kMaxLods + l] * scale);
+        }
+    }
+}
+
+int CrowdRenderer::selectInstanceLod(size_t instance, const sceneGraph::LodView* lodView, const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+{
+    if (!lodView || lodLevelCount <= 1)
+    {
+        return 0;
+    }
+
+    float pixelsPerUnit = sceneGraph::computePixelsPerUnit(*lodView, boundsMin, boundsMax);
+    int level = sceneGraph::selectLod(lodErrors, lodLevelCount, pixelsPerUnit, lodView->maxPixelError, instanceLods[instance]);
+
+    instanceLods[instance] = static_cast<unsigned char>(level);
+
+    return level;
+}
+
+// Counting sort of the drawn instances by level, so each level is one contiguous instanced draw.
+void CrowdRenderer::groupByLod(const FlatScene& scene)
+{
+    int counts[GpuMesh::kMaxLods] = {};
+
+    for (unsigned char level : visibleLods)
+    {
+        ++counts[level];
+    }
+
+    lodOffsets[0] = 0;
+    lastTriangles = 0;
+
+    for (int l = 0; l < GpuMesh::kMaxLods; ++l)
+    {
+        lodOffsets[l + 1] = lodOffsets[l] + counts[l];
+
+        if (counts[l] == 0)
+        {
+            continue;
+        }
+
+        uint64_t trianglesPerInstance = 0;
+
+        for (int n : drawNodes)
+        {
+            const MeshRange& range = scene.meshRanges[n];
+
+            for (int i = range.first; i < range.first + range.count; ++i)
+            {
+                const GpuMesh& m = scene.meshes[i];
+                trianglesPerInstance += static_cast<uint64_t>(m.getLodIndexCount(std::min(l, m.lodCount - 1)) / 3);
+            }
+        }
+
+        lastTriangles += trianglesPerInstance * static_cast<uint64_t>(counts[l]);
+    }
+
+    // Nothing to move when one level holds every drawn instance (always so without LODs).
+    for (int l = 0; l < GpuMesh::kMaxLods; ++l)
+    {
+        if (counts[l] == static_cast<int>(visibleLods.size()))
+        {
+            return;
+        }
+    }
+
+    size_t slots = drawNodes.size();
+
+    groupedMatrices.resize(instanceMatrices.size());
+    groupedInstances.resize(visibleInstances.size());
+
+    int cursor[GpuMesh::kMaxLods];
+    std::copy(lodOffsets, lodOffsets + GpuMesh::kMaxLods, cursor);
+
+    for (size_t v = 0; v < visibleLods.size(); ++v)
+    {
+        size_t dst = static_cast<size_t>(cursor[visibleLods[v]]++);
+
+        std::copy(instanceMatrices.begin() + v * slots, instanceMatrices.begin() + (v + 1) * slots, groupedMatrices.begin() + dst * slots);
+        groupedInstances[dst] = visibleInstances[v];
+    }
+
+    instanceMatrices.swap(groupedMatrices);
+    visibleInstances.swap(groupedInstances);
+
+    for (int l = 0; l < GpuMesh::kMaxLods; ++l)
+    {
+        std::fill(visibleLods.begin() + lodOffsets[l], visibleLods.begin() + lodOffsets[l + 1], static_cast<unsigned char>(l));
+    }
+}
+
+void CrowdRenderer::updateTransforms(const FlatScene& scene, const glm::mat4* nodeWorld, const sceneGraph::Frustum* frustum, const sceneGraph::LodView* lodView)
+{
+    rebuildDrawSlots(scene);
+    computeLodErrors(scene, nodeWorld);
+
+    size_t slots = drawNodes.size();
+
+    // The pose is shared, so its bounds are computed once and only moved per instance.
+    glm::vec3 poseMin(std::numeric_limits<float>::max());
+    glm::vec3 poseMax(-std::numeric_limits<float>::max());
+
+    for (size_t s = 0; s < slots; ++s)
+    {
+        int n = drawNodes[s];
+        glm::vec3 nodeMin;
+        glm::vec3 nodeMax;
+
+        sceneGraph::transformBounds(nodeWorld[n], scene.nodeBoundsMin[n], scene.nodeBoundsMax[n], nodeMin, nodeMax);
+        poseMin = glm::min(poseMin, nodeMin);
+        poseMax = glm::max(poseMax, nodeMax);
+    }
+
+    for (size_t i = 0; i < instanceRoots.size(); ++i)
+    {
+        glm::vec3 instanceMin(0.0f);
+        glm::vec3 instanceMax(0.0f);
+
+        if ((frustum || lodView) && slots > 0)
+        {
+            sceneGraph::transformBounds(instanceRoots[i], poseMin, poseMax, instanceMin, instanceMax);
+
+            if (frustum && sceneGraph::isBoxOutside(*frustum, instanceMin, instanceMax))
+            {
+                continue;
+            }
+        }
+
+        glm::mat4* out = instanceMatrices.data() + visibleInstances.size() * slots;
+
+        for (size_t s = 0; s < slots; ++s)
+        {
+            out[s] = instanceRoots[i] * nodeWorld[drawNodes[s]];
+        }
+
+        visibleInstances.push_back(static_cast<GLuint>(i));
+        visibleLods.push_back(static_cast<unsigned char>(selectInstanceLod(i, lodView, instanceMin, instanceMax)));
+    }
+
+    groupByLod(scene);
+    upload();
+}
+
+void CrowdRenderer::updateTransformsPerInstance(const FlatScene& scene, const glm::mat4* instanceWorld, const sceneGraph::Frustum* frustum, const sceneGraph::LodView* lodView)
+{
+    rebuildDrawSlots(scene);
+
+    size_t slots = drawNodes.size();
+    size_t nodeCount = static_cast<size_t>(scene.getNodeCount());
+
+    for (size_t i = 0; i < instanceRoots.size(); ++i)
+    {
+        const glm::mat4* world = instanceWorld + i * nodeCount;
+
+        // Written in place at the next compacted slot; a culled instance is simply not kept.
+        glm::mat4* out = instanceMatrices.data() + visibleInstances.size() * slots;
+
+        glm::vec3 instanceMin(std::numeric_limits<float>::max());
+        glm::vec3 instanceMax(-std::numeric_limits<float>::max());
+
+        for (size_t s = 0; s < slots; ++s)
+        {
+            int n = drawNodes[s];
+            out[s] = instanceRoots[i] * world[n];
+
+            if (frustum || lodView)
+            {
+                glm::vec3 nodeMin;
+                glm::vec3 nodeMax;
+
+                sceneGraph::transformBounds(out[s], scene.nodeBoundsMin[n], scene.nodeBoundsMax[n], nodeMin, nodeMax);
+                instanceMin = glm::min(instanceMin, nodeMin);
+                instanceMax = glm::max(instanceMax, nodeMax);
+            }
+        }
+
+        if (frustum && slots > 0 && sceneGraph::isBoxOutside(*frustum, instanceMin, instanceMax))
+        {
+            continue;
+        }
+
+        // Each instance has its own pose, node scales included, so its errors come from its own matrices.
+        if (lodView)
+        {
+            computeLodErrors(scene, world);
+        }
+
+        visibleInstances.push_back(static_cast<GLuint>(i));
+        visibleLods.push_back(static_cast<unsigned char>(selectInstanceLod(i, lodView, instanceMin, instanceMax)));
+    }
+
+    groupByLod(scene);
+    upload();
+}
+
+void CrowdRenderer::upload()
+{
+    size_t bytes = visibleInstances.size() * drawNodes.size() * sizeof(glm::mat4);
+
+    if (bytes == 0)
+    {
+        return;
+    }
+
+    uploadStream(GL_TEXTURE_BUFFER, tbo, instanceMatrices.data(), bytes, uploadedBytes);
+    uploadStream(GL_TEXTURE_BUFFER, idTbo, visibleInstances.data(), visibleInstances.size() * sizeof(GLuint), uploadedIdBytes);
+}
+
+void CrowdRenderer::renderInstanced(ShaderProgram& crowdShader, const FlatScene& scene)
+{
+    lastDrawCalls = 0;
+
+    if (drawNodes.empty() || visibleInstances.empty())
+    {
+        return;
+    }
+
+    crowdShader.bind();
+    crowdShader.set(uSlotCount, static_cast<int>(drawNodes.size()));
+
+    glActiveTexture(GL_TEXTURE0 + kInstanceTransformUnit);
+    glBindTexture(GL_TEXTURE_BUFFER, tboTex);
+    glActiveTexture(GL_TEXTURE0 + kInstanceIdUnit);
+    glBindTexture(GL_TEXTURE_BUFFER, idTboTex);
+    glActiveTexture(GL_TEXTURE0);
+
+    GLuint boundVao = 0;
+    GLuint boundTex = 0;
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    for (size_t s = 0; s < drawNodes.size(); ++s)
+    {
+        crowdShader.set(uNodeSlot, static_cast<int>(s));
+
+        // Node part only; the shader maps each drawn instance through uInstanceIds to the crowd instance
+        // it stands for and puts that in the high 16 bits.
+        crowdShader.set(uNodePickId, sceneGraph::encodePickId(0, drawNodes[s]));
+
+        const MeshRange& range = scene.meshRanges[drawNodes[s]];
+
+        for (int i = range.first; i < range.first + range.count; ++i)
+        {
+            const GpuMesh& m = scene.meshes[i];
+
+            if (m.vao != boundVao)
+            {
+                glBindVertexArray(m.vao);
+                boundVao = m.vao;
+            }
+
+            if (m.textureId != boundTex)
+            {
+                glBindTexture(GL_TEXTURE_2D, m.textureId);
+                boundTex = m.textureId;
+            }
+
+            // One draw per level in use; the shader offsets gl_InstanceID by the level's first instance.
+            for (int l = 0; l < GpuMesh::kMaxLods; ++l)
+            {
+                GLsizei instances = static_cast<GLsizei>(lodOffsets[l + 1] - lodOffsets[l]);
+
+                if (instances == 0)
+                {
+                    continue;
+                }
+
+                int level = std::min(l, m.lodCount - 1);
+
+                crowdShader.set(uInstanceBase, lodOffsets[l]);
+                glDrawElementsInstancedBaseVertex(GL_TRIANGLES, m.getLodIndexCount(level), m.indexType, reinterpret_cast<const void*>(m.getLodIndexOffset(level)), instances, m.baseVertex);
+                ++lastDrawCalls;
+            }
+        }
+    }
+
+    glBindVertexArray(0);
+
+    glActiveTexture(GL_TEXTURE0 + kInstanceTransformUnit);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glActiveTexture(GL_TEXTURE0 + kInstanceIdUnit);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+void CrowdRenderer::renderPerInstance(ShaderProgram& robotShader, const FlatScene& scene)
+{
+    lastDrawCalls = 0;
+
+    robotShader.bind();
+
+    glActiveTexture(GL_TEXTURE0);
+
+    size_t slots = drawNodes.size();
+    GLuint boundVao = 0;
+    GLuint boundTex = 0;
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    for (size_t v = 0; v < visibleInstances.size(); ++v)
+    {
+        int inst = static_cast<int>(visibleInstances[v]);
+
+        for (size_t s = 0; s < slots; ++s)
+        {
+            const glm::mat4& model = instanceMatrices[v * slots + s];
+
+            robotShader.set(uModel, model);
+            robotShader.set(uNormalMatrix, sceneGraph::computeNormalMatrix(model));
+            robotShader.set(uPickId, sceneGraph::encodePickId(inst, drawNodes[s]));
+
+            const MeshRange& range = scene.meshRanges[drawNodes[s]];
+
+            for (int i = range.first; i < range.first + range.count; ++i)
+            {
+                const GpuMesh& m = scene.meshes[i];
+
+                if (m.vao != boundVao)
+                {
+                    glBindVertexArray(m.vao);
+                    boundVao = m.vao;
+                }
+
+                if (m.textureId != boundTex)
+                {
+                    glBindTexture(GL_TEXTURE_2D, m.textureId);
+                    boundTex = m.textureId;
+                }
+
+                int level = std::min(static_cast<int>(visibleLods[v]), m.lodCount - 1);
+
+                glDrawElementsBaseVertex(GL_TRIANGLES, m.getLodIndexCount(level), m.indexType, reinterpret_cast<const void*>(m.getLodIndexOffset(level)), m.baseVertex);
+                ++lastDrawCalls;
+            }
+        }
+    }
+
+    glBindVertexArray(0);
+}
+
+int CrowdRenderer::getLastDrawCalls() const
+{
+    return lastDrawCalls;
+}
+
+int CrowdRenderer::getVisibleInstanceCount() const
+{
+    return static_cast<int>(visibleInstances.size());
+}
+
+int CrowdRenderer::getCulledInstanceCount() const
+{
+    return static_cast<int>(instanceRoots.size() - visibleInstances.size());
+}
+
+int CrowdRenderer::getLodInstanceCount(int level) const
+{
+    return (level >= 0 && level < GpuMesh::kMaxLods) ? lodOffsets[level + 1] - lodOffsets[level] : 0;
+}
+
+uint64_t CrowdRenderer::getLastTriangleCount() const
+{
+    return lastTriangles;
+}
\ No newline at end of file
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <vector>
+#include <glad/glad.h>
+#include <glm.hpp>
+
+#include "SceneTypes.h"
+#include "SceneGraph.h"
+#include "../util/ShaderLoader.h"
+
+// Draws many posed copies of one FlatScene. Every instance's node world matrices are packed into a
+// buffer texture (instance-major, 4 RGBA32F texels per matrix) and each mesh is drawn once for all
+// instances with glDrawElementsInstancedBaseVertex. Instances whose posed bounds miss the view frustum
+// are left out of the buffer; a second buffer texture maps each drawn instance back to its index.
+// With a LodView each drawn instance also gets a LOD level from its projected size; the buffer is then
+// grouped by level and each mesh is drawn once per level in use.
+class CrowdRenderer
+{
+public:
+    // crowdShader and robotShader are the programs later passed to renderInstanced and renderPerInstance;
+    // their sampler units are set here and their per-draw uniforms resolved once.
+    bool initialize(const ShaderProgram& crowdShader, const ShaderProgram& robotShader);
+    void shutdown();
+
+    // Lays instances out on a grid around the origin; instance 0 stays at the origin.
+    void setInstanceCount(int count, float spacing);
+    int getInstanceCount() const;
+    int getMaxInstanceCount(const FlatScene& scene) const;
+
+    const glm::mat4& getInstanceRoot(int instance) const;
+
+    // Shared pose: every instance gets instanceRoot * nodeWorld. A null frustum disables culling, a null
+    // lodView draws every instance at level 0.
+    void updateTransforms(const FlatScene& scene, const glm::mat4* nodeWorld, const sceneGraph::Frustum* frustum, const sceneGraph::LodView* lodView);
+
+    // Per-instance poses: instanceWorld holds instanceCount * nodeCount matrices, instance-major.
+    void updateTransformsPerInstance(const FlatScene& scene, const glm::mat4* instanceWorld, const sceneGraph::Frustum* frustum, const sceneGraph::LodView* lodView);
+
+    void renderInstanced(ShaderProgram& crowdShader, const FlatScene& scene);
+
+    // Reference path: one draw per mesh per instance with per-draw uniforms (for benchmarking).
+    void renderPerInstance(ShaderProgram& robotShader, const FlatScene& scene);
+
+    int getLastDrawCalls() const;
+
+    // Instances kept / culled by the last update.
+    int getVisibleInstanceCount() const;
+    int getCulledInstanceCount() const;
+
+    // Drawn instances at a LOD level and the triangles all drawn instances submit, from the last update.
+    int getLodInstanceCount(int level) const;
+    uint64_t getLastTriangleCount() const;
+
+private:
+    void rebuildDrawSlots(const FlatScene& scene);
+    void computeLodErrors(const FlatScene& scene, const glm::mat4* nodeWorld);
+    int selectInstanceLod(size_t instance, const sceneGraph::LodView* lodView, const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+    void groupByLod(const FlatScene& scene);
+    void upload();
+
+private:
+    GLuint tbo = 0;
+    GLuint tboTex = 0;
+    GLint maxTexels = 0;
+
+    // R32UI: original instance index of each drawn instance, for pick IDs.
+    GLuint idTbo = 0;
+    GLuint idTboTex = 0;
+
+    std::vector<glm::mat4> instanceRoots;
+
+    // Nodes with meshes, each owning one matrix slot per instance.
+    std::vector<int> drawNodes;
+
+    // Drawn instances only, compacted in instance order (then grouped by LOD level).
+    std::vector<glm::mat4> instanceMatrices;
+    std::vector<GLuint> visibleInstances;
+
+    // Level of each drawn instance. After groupByLod the drawn instances are sorted by level and level L
+    // occupies [lodOffsets[L], lodOffsets[L + 1]).
+    std::vector<unsigned char> visibleLods;
+    int lodOffsets[GpuMesh::kMaxLods + 1] = {};
+
+    // Scratch for the regrouping, kept so steady-state frames do not allocate.
+    std::vector<glm::mat4> groupedMatrices;
+    std::vector<GLuint> groupedInstances;
+
+    // Per instance, kept across frames for hysteresis.
+    std::vector<unsigned char> instanceLods;
+
+    // Per level: the worst error over all drawn nodes, world units.
+    float lodErrors[GpuMesh::kMaxLods] = {};
+    int lodLevelCount = 1;
+
+    uint64_t lastTriangles = 0;
+    size_t uploadedBytes = 0;
+    size_t uploadedIdBytes = 0;
+
+    int lastDrawCalls = 0;
+
+    UniformHandle<int> uSlotCount;
+    UniformHandle<int> uNodeSlot;
+    UniformHandle<GLuint> uNodePickId;
+    UniformHandle<int> uInstanceBase;
+
+    UniformHandle<glm::mat4> uModel;
+    UniformHandle<glm::mat3> uNormalMatrix;
+    UniformHandle<GLuint> uPickId;
+};
\ No newline at end of file
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <string>
+
+class CameraController;
+class RobotRig;
+class ShaderProgram;
+class ThreadPool;
+
+// Command-line render mode: no visible window or UI, frames go to PNG files.
+struct HeadlessOptions
+{
+    bool enabled = false;
+    std::string animPath;
+    std::string outputDir = "renders";
+    int frameCount = 0; // 0 = the whole clip
+};
+
+namespace headlessRenderer
+{
+    // Plays options.animPath (.json or binary clip) frame by frame into a width x height offscreen target
+    // through an ImageSequenceRecorder. Returns the process exit code.
+    int render(const HeadlessOptions& options, int width, int height, RobotRig& rig, ShaderProgram& robotShader, const CameraController& camera, ThreadPool& pool);
+}
\ No newline at end of file
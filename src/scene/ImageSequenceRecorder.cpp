@@ -0,0 +1,285 @@
+#include "ImageSequenceRecorder.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#define STB_IMAGE_WRITE_STATIC
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "stb_image_write.h"
+
+// Encode jobs (each owning a full frame of pixels) kept in flight per pool thread.
+static constexpr int kJobsPerThread = 2;
+static constexpr int kMaxJobs = 16;
+
+bool ImageSequenceRecorder::initialize(int inWidth, int inHeight, ThreadPool* inPool, const std::string& inOutputDir)
+{
+    width = inWidth;
+    height = inHeight;
+    pool = inPool;
+    outputDir = inOutputDir;
+    stats = Stats();
+
+    std::error_code ec;
+    std::filesystem::create_directories(outputDir, ec);
+
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+
+    glGenTextures(1, &colorTex);
+    glBindTexture(GL_TEXTURE_2D, colorTex);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colorTex, 0);
+
+    glGenRenderbuffers(1, &depthRb);
+    glBindRenderbuffer(GL_RENDERBUFFER, depthRb);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthRb);
+
+    bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    GLsizeiptr frameBytes = static_cast<GLsizeiptr>(width) * height * 4;
+
+    for (Readback& r : readbacks)
+    {
+        glGenBuffers(1, &r.pbo);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, r.pbo);
+        glBufferData(GL_PIXEL_PACK_BUFFER, frameBytes, nullptr, GL_STREAM_READ);
+        r.fence = nullptr;
+        r.frameIndex = -1;
+    }
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    int jobCount = std::min(kMaxJobs, std::max(2, (pool ? pool->getThreadCount() : 1) * kJobsPerThread));
+
+    jobs.clear();
+
+    for (int i = 0; i < jobCount; ++i)
+    {
+        jobs.push_back(std::make_unique<EncodeJob>());
+        jobs.back()->width = width;
+        jobs.back()->height = height;
+        jobs.back()->pixels.resize(static_cast<size_t>(frameBytes));
+    }
+
+    nextReadback = 0;
+    nextJob = 0;
+
+    return complete;
+}
+
+void ImageSequenceRecorder::shutdown()
+{
+    finish();
+
+    for (Readback& r : readbacks)
+    {
+        if (r.pbo != 0) glDeleteBuffers(1, &r.pbo);
+
+        r.pbo = 0;
+    }
+
+    if (depthRb != 0) glDeleteRenderbuffers(1, &depthRb);
+    if (colorTex != 0) glDeleteTextures(1, &colorTex);
+    if (fbo != 0) glDeleteFramebuffers(1, &fbo);
+
+    depthRb = 0;
+    colorTex = 0;
+    fbo = 0;
+
+    jobs.clear();
+}
+
+void ImageSequenceRecorder::beginFrame()
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glViewport(0, 0, width, height);
+}
+
+void ImageSequenceRecorder::endFrame(int frameIndex)
+{
+    Readback& r = readbacks[nextReadback];
+    nextReadback = (nextReadback + 1) % kReadbackRing;
+
+    // Oldest slot: its copy was queued kReadbackRing frames ago.
+    if (r.fence)
+    {
+        collect(r);
+    }
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, r.pbo);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    r.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    r.frameIndex = frameIndex;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void ImageSequenceRecorder::finish()
+{
+    // Collect in submission order, starting with the oldest slot.
+    for (int i = 0; i < kReadbackRing; ++i)
+    {
+        Readback& r = readbacks[(nextReadback + i) % kReadbackRing];
+
+        if (r.fence)
+        {
+            collect(r);
+        }
+    }
+
+    for (std::unique_ptr<EncodeJob>& job : jobs)
+    {
+        retire(*job);
+    }
+}
+
+const ImageSequenceRecorder::Stats& ImageSequenceRecorder::getStats() const
+{
+    return stats;
+}
+
+void ImageSequenceRecorder::collect(Readback& readback)
+{
+    auto t0 = std::chrono::high_resolution_clock::now();
+
+    // The first wait flushes so the fence is guaranteed to signal.
+    GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+
+    for (;;)
+    {
+        GLenum status = glClientWaitSync(readback.fence, flags, 1000000);
+
+        if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED || status == GL_WAIT_FAILED)
+        {
+            break;
+        }
+
+        flags = 0;
+    }
+
+    glDeleteSync(readback.fence);
+    readback.fence = nullptr;
+
+    auto t1 = std::chrono::high_resolution_clock::now();
+
+    EncodeJob& job = *jobs[nextJob];
+    nextJob = (nextJob + 1) % static_cast<int>(jobs.size());
+
+    retire(job);
+
+    auto t2 = std::chrono::high_resolution_clock::now();
+
+    stats.readbackWaitMs += std::chrono::duration<double, std::milli>(t1 - t0).count();
+    stats.encodeWaitMs += std::chrono::duration<double, std::milli>(t2 - t1).count();
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo);
+
+    const void* mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, static_cast<GLsizeiptr>(job.pixels.size()), GL_MAP_READ_BIT);
+
+    if (mapped)
+    {
+        std::memcpy(job.pixels.data(), mapped, job.pixels.size());
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    if (!mapped)
+    {
+        ++stats.writeFailures;
+
+        return;
+    }
+
+    char fileName[32];
+    std::snprintf(fileName, sizeof(fileName), "frame_%05d.png", readback.frameIndex);
+    job.path = (std::filesystem::path(outputDir) / fileName).string();
+    job.inFlight = true;
+
+    if (pool)
+    {
+        pool->submit(job.group, job);
+    }
+    else
+    {
+        job();
+    }
+}
+
+void ImageSequenceRecorder::retire(EncodeJob& job)
+{
+    if (!job.inFlight)
+    {
+        return;
+    }
+
+    if (pool)
+    {
+        pool->wait(job.group);
+    }
+
+    job.inFlight = false;
+
+    if (job.ok)
+    {
+        ++stats.framesWritten;
+    }
+    else
+    {
+        ++stats.writeFailures;
+    }
+}
+
+// stb_image_write callback: appends the encoded bytes to the std::vector passed as context.
+static void appendToVector(void* context, void* data, int size)
+{
+    std::vector<unsigned char>& out = *static_cast<std::vector<unsigned char>*>(context);
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+
+    out.insert(out.end(), bytes, bytes + size);
+}
+
+void ImageSequenceRecorder::EncodeJob::operator()()
+{
+    // GL rows are bottom-up, so start at the last row and step backwards rather than touching stb's
+    // global flip flag, which other jobs read concurrently.
+    int stride = width * 4;
+    const unsigned char* topRow = pixels.data() + static_cast<size_t>(height - 1) * stride;
+
+    png.clear();
+    ok = stbi_write_png_to_func(&appendToVector, &png, width, height, 4, topRow, -stride) != 0;
+
+    if (!ok)
+    {
+        return;
+    }
+
+    std::ofstream out(path, std::ios::out | std::ios::binary | std::ios::trunc);
+
+    if (!out.is_open())
+    {
+        ok = false;
+
+        return;
+    }
+
+    out.write(reinterpret_cast<const char*>(png.data()), static_cast<std::streamsize>(png.size()));
+    ok = out.good();
+}
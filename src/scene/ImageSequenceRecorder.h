@@ -0,0 +1,88 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <glad/glad.h>
+
+#include "../util/ThreadPool.h"
+
+// Renders into an offscreen FBO and writes every frame as a PNG. Readback goes through a ring of
+// pixel pack buffers: glReadPixels only queues a copy, and a buffer is mapped kReadbackRing frames
+// later when the copy has long finished. Mapped pixels are handed to encode jobs on the thread pool,
+// so neither the GPU nor the render loop waits on compression or disk.
+class ImageSequenceRecorder
+{
+public:
+    static constexpr int kReadbackRing = 3;
+
+    struct Stats
+    {
+        int framesWritten = 0;
+        int writeFailures = 0;
+
+        // Main-thread time blocked on readback fences and on encode jobs still in flight.
+        double readbackWaitMs = 0.0;
+        double encodeWaitMs = 0.0;
+    };
+
+    bool initialize(int width, int height, ThreadPool* pool, const std::string& outputDir);
+    void shutdown();
+
+    // Binds the offscreen target and sets the viewport to its size.
+    void beginFrame();
+
+    // Queues readback of the target; the frame lands as outputDir/frame_NNNNN.png.
+    void endFrame(int frameIndex);
+
+    // Drains the readback ring and waits until every queued frame is on disk.
+    void finish();
+
+    const Stats& getStats() const;
+
+private:
+    struct Readback
+    {
+        GLuint pbo = 0;
+        GLsync fence = nullptr;
+        int frameIndex = -1;
+    };
+
+    // Job state is only touched by the pool between submit and wait; operator() is what runs there.
+    struct EncodeJob
+    {
+        ThreadPool::TaskGroup group;
+        bool inFlight = false;
+
+        int width = 0;
+        int height = 0;
+        std::string path;
+        std::vector<unsigned char> pixels;
+
+        std::vector<unsigned char> png;
+        bool ok = false;
+
+        void operator()();
+    };
+
+    void collect(Readback& readback);
+    void retire(EncodeJob& job);
+
+private:
+    int width = 0;
+    int height = 0;
+    std::string outputDir;
+    ThreadPool* pool = nullptr;
+
+    GLuint fbo = 0;
+    GLuint colorTex = 0;
+    GLuint depthRb = 0;
+
+    Readback readbacks[kReadbackRing];
+    int nextReadback = 0;
+
+    std::vector<std::unique_ptr<EncodeJob>> jobs;
+    int nextJob = 0;
+
+    Stats stats;
+};
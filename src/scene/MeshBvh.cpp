@@ -0,0 +1,333 @@
+#include "MeshBvh.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+static constexpr int kMaxLeafTriangles = 4;
+
+// Median splits halve the triangle count per level, so depth stays near log2(n / leaf).
+static constexpr int kMaxStackDepth = 64;
+
+void MeshBvh::build(const float* positions, size_t vertexCount, const unsigned int* indices, size_t indexCount)
+{
+    build(reinterpret_cast<const unsigned char*>(positions), 3 * sizeof(float), vertexCount, reinterpret_cast<const unsigned char*>(indices), sizeof(unsigned int), indexCount);
+}
+
+void MeshBvh::build(const unsigned char* positions, size_t positionStride, size_t vertexCount, const unsigned char* indices, size_t indexSize, size_t indexCount)
+{
+    nodes.clear();
+    corners.clear();
+
+    std::vector<glm::vec3> source;
+    std::vector<glm::vec3> centroids;
+    std::vector<int> order;
+
+    auto index = [&](size_t i) -> size_t
+    {
+        if (indexSize == sizeof(uint16_t))
+        {
+            uint16_t v;
+            std::memcpy(&v, indices + i * indexSize, sizeof(v));
+            return v;
+        }
+
+        uint32_t v;
+        std::memcpy(&v, indices + i * indexSize, sizeof(v));
+        return v;
+    };
+
+    auto position = [&](size_t v)
+    {
+        glm::vec3 p;
+        std::memcpy(&p[0], positions + v * positionStride, sizeof(p));
+        return p;
+    };
+
+    for (size_t i = 0; i + 2 < indexCount; i += 3)
+    {
+        size_t i0 = index(i);
+        size_t i1 = index(i + 1);
+        size_t i2 = index(i + 2);
+
+        if (i0 >= vertexCount || i1 >= vertexCount || i2 >= vertexCount)
+        {
+            continue;
+        }
+
+        glm::vec3 a = position(i0);
+        glm::vec3 b = position(i1);
+        glm::vec3 c = position(i2);
+
+        order.push_back(static_cast<int>(centroids.size()));
+        centroids.push_back((a + b + c) * (1.0f / 3.0f));
+        source.push_back(a);
+        source.push_back(b);
+        source.push_back(c);
+    }
+
+    if (order.empty())
+    {
+        return;
+    }
+
+    nodes.reserve(order.size() / kMaxLeafTriangles * 2 + 1);
+
+    buildNode(order, source, centroids, 0, static_cast<int>(order.size()));
+
+    corners.resize(order.size() * 3);
+
+    for (size_t k = 0; k < order.size(); ++k)
+    {
+        corners[k * 3 + 0] = source[order[k] * 3 + 0];
+        corners[k * 3 + 1] = source[order[k] * 3 + 1];
+        corners[k * 3 + 2] = source[order[k] * 3 + 2];
+    }
+}
+
+int MeshBvh::buildNode(std::vector<int>& order, const std::vector<glm::vec3>& source, const std::vector<glm::vec3>& centroids, int begin, int end)
+{
+    int index = static_cast<int>(nodes.size());
+    nodes.emplace_back();
+
+    glm::vec3 boundsMin(std::numeric_limits<float>::max());
+    glm::vec3 boundsMax(-std::numeric_limits<float>::max());
+    glm::vec3 centroidMin = boundsMin;
+    glm::vec3 centroidMax = boundsMax;
+
+    for (int k = begin; k < end; ++k)
+    {
+        int t = order[k];
+
+        for (int v = 0; v < 3; ++v)
+        {
+            boundsMin = glm::min(boundsMin, source[t * 3 + v]);
+            boundsMax = glm::max(boundsMax, source[t * 3 + v]);
+        }
+
+        centroidMin = glm::min(centroidMin, centroids[t]);
+        centroidMax = glm::max(centroidMax, centroids[t]);
+    }
+
+    nodes[index].boundsMin = boundsMin;
+    nodes[index].boundsMax = boundsMax;
+
+    glm::vec3 extent = centroidMax - centroidMin;
+    int axis = (extent.x >= extent.y && extent.x >= extent.z) ? 0 : (extent.y >= extent.z ? 1 : 2);
+
+    if (end - begin <= kMaxLeafTriangles || extent[axis] <= 0.0f)
+    {
+        nodes[index].rightOrFirst = begin;
+        nodes[index].count = end - begin;
+
+        return index;
+    }
+
+    // Median split on the widest centroid axis.
+    int mid = (begin + end) / 2;
+
+    std::nth_element(order.begin() + begin, order.begin() + mid, order.begin() + end, [&](int a, int b)
+    {
+        return centroids[a][axis] < centroids[b][axis];
+    });
+
+    // Depth-first, so the left child is always index + 1.
+    buildNode(order, source, centroids, begin, mid);
+    int right = buildNode(order, source, centroids, mid, end);
+
+    nodes[index].rightOrFirst = right;
+    nodes[index].count = 0;
+
+    return index;
+}
+
+bool MeshBvh::empty() const
+{
+    return nodes.empty();
+}
+
+size_t MeshBvh::getTriangleCount() const
+{
+    return corners.size() / 3;
+}
+
+const glm::vec3& MeshBvh::getBoundsMin() const
+{
+    static const glm::vec3 kZero(0.0f);
+
+    return nodes.empty() ? kZero : nodes[0].boundsMin;
+}
+
+const glm::vec3& MeshBvh::getBoundsMax() const
+{
+    static const glm::vec3 kZero(0.0f);
+
+    return nodes.empty() ? kZero : nodes[0].boundsMax;
+}
+
+size_t MeshBvh::getNodeCount() const
+{
+    return nodes.size();
+}
+
+const void* MeshBvh::getNodeData() const
+{
+    return nodes.data();
+}
+
+const glm::vec3* MeshBvh::getCorners() const
+{
+    return corners.data();
+}
+
+bool MeshBvh::assign(const void* nodeData, size_t nodeCount, const glm::vec3* inCorners, size_t triangleCount)
+{
+    nodes.resize(nodeCount);
+    corners.assign(inCorners, inCorners + triangleCount * 3);
+
+    if (nodeCount > 0)
+    {
+        std::memcpy(nodes.data(), nodeData, nodeCount * kNodeBytes);
+    }
+
+    // Children always follow their parent, which also bounds the traversal depth.
+    for (size_t i = 0; i < nodes.size(); ++i)
+    {
+        const Node& node = nodes[i];
+
+        bool ok = (node.count > 0)
+            ? node.rightOrFirst >= 0 && static_cast<size_t>(node.rightOrFirst) + static_cast<size_t>(node.count) <= triangleCount
+            : node.count == 0 && i + 1 < nodes.size() && node.rightOrFirst > static_cast<int>(i + 1) && static_cast<size_t>(node.rightOrFirst) < nodes.size();
+
+        if (!ok)
+        {
+            nodes.clear();
+            corners.clear();
+
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Slab test; returns the entry distance or +inf when the box is missed within [0, maxT).
+static float intersectBox(const glm::vec3& boundsMin, const glm::vec3& boundsMax, const glm::vec3& origin, const glm::vec3& invDir, float maxT)
+{
+    glm::vec3 t0 = (boundsMin - origin) * invDir;
+    glm::vec3 t1 = (boundsMax - origin) * invDir;
+
+    glm::vec3 tNear = glm::min(t0, t1);
+    glm::vec3 tFar = glm::max(t0, t1);
+
+    float enter = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+    float exit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, maxT));
+
+    return (enter <= exit) ? enter : std::numeric_limits<float>::infinity();
+}
+
+// Moller-Trumbore, both faces.
+static bool intersectTriangle(const glm::vec3* tri, const glm::vec3& origin, const glm::vec3& dir, float& inOutT)
+{
+    glm::vec3 e1 = tri[1] - tri[0];
+    glm::vec3 e2 = tri[2] - tri[0];
+    glm::vec3 p = glm::cross(dir, e2);
+    float det = glm::dot(e1, p);
+
+    if (std::abs(det) < 1e-12f)
+    {
+        return false;
+    }
+
+    float invDet = 1.0f / det;
+    glm::vec3 s = origin - tri[0];
+    float u = glm::dot(s, p) * invDet;
+
+    if (u < 0.0f || u > 1.0f)
+    {
+        return false;
+    }
+
+    glm::vec3 q = glm::cross(s, e1);
+    float v = glm::dot(dir, q) * invDet;
+
+    if (v < 0.0f || u + v > 1.0f)
+    {
+        return false;
+    }
+
+    float t = glm::dot(e2, q) * invDet;
+
+    if (t < 0.0f || t >= inOutT)
+    {
+        return false;
+    }
+
+    inOutT = t;
+
+    return true;
+}
+
+bool MeshBvh::raycast(const glm::vec3& origin, const glm::vec3& dir, float& inOutT) const
+{
+    if (nodes.empty())
+    {
+        return false;
+    }
+
+    // IEEE division gives +-inf for axis-parallel rays, which the slab test handles.
+    glm::vec3 invDir(1.0f / dir.x, 1.0f / dir.y, 1.0f / dir.z);
+
+    if (intersectBox(nodes[0].boundsMin, nodes[0].boundsMax, origin, invDir, inOutT) == std::numeric_limits<float>::infinity())
+    {
+        return false;
+    }
+
+    int stack[kMaxStackDepth];
+    int top = 0;
+    stack[top++] = 0;
+
+    bool hit = false;
+
+    while (top > 0)
+    {
+        const Node& node = nodes[stack[--top]];
+
+        if (node.count > 0)
+        {
+            for (int k = 0; k < node.count; ++k)
+            {
+                hit |= intersectTriangle(&corners[(size_t)(node.rightOrFirst + k) * 3], origin, dir, inOutT);
+            }
+
+            continue;
+        }
+
+        int left = static_cast<int>(&node - nodes.data()) + 1;
+        int right = node.rightOrFirst;
+
+        float tLeft = intersectBox(nodes[left].boundsMin, nodes[left].boundsMax, origin, invDir, inOutT);
+        float tRight = intersectBox(nodes[right].boundsMin, nodes[right].boundsMax, origin, invDir, inOutT);
+
+        // Push the farther child first so the nearer one is visited first and shortens inOutT.
+        if (tLeft > tRight)
+        {
+            std::swap(left, right);
+            std::swap(tLeft, tRight);
+        }
+
+        if (tRight != std::numeric_limits<float>::infinity() && top < kMaxStackDepth)
+        {
+            stack[top++] = right;
+        }
+
+        if (tLeft != std::numeric_limits<float>::infinity() && top < kMaxStackDepth)
+        {
+            stack[top++] = left;
+        }
+    }
+
+    return hit;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include <glm.hpp>
+
+// Bounding volume hierarchy over one mesh's triangles in mesh-local space, for CPU ray picking.
+// Triangles are copied (reordered by leaf), so the source buffers can be dropped after build.
+class MeshBvh
+{
+public:
+    // Triangle list: indexCount / 3 triangles of xyz positions.
+    void build(const float* positions, size_t vertexCount, const unsigned int* indices, size_t indexCount);
+
+    // Same, read in place: float xyz every positionStride bytes, indices of indexSize (2 or 4) bytes.
+    void build(const unsigned char* positions, size_t positionStride, size_t vertexCount, const unsigned char* indices, size_t indexSize, size_t indexCount);
+
+    bool empty() const;
+    size_t getTriangleCount() const;
+
+    const glm::vec3& getBoundsMin() const;
+    const glm::vec3& getBoundsMax() const;
+
+    // Nearest two-sided hit along origin + t * dir with 0 <= t < inOutT; shortens inOutT on a hit.
+    // dir need not be normalised, so a ray transformed by an affine matrix keeps its t.
+    bool raycast(const glm::vec3& origin, const glm::vec3& dir, float& inOutT) const;
+
+    // Raw node and triangle arrays for the model cache; assign() restores a BVH from them without a
+    // rebuild, and fails (leaving the BVH empty) if a node points outside the arrays.
+    static constexpr size_t kNodeBytes = 32;
+
+    size_t getNodeCount() const;
+    const void* getNodeData() const;
+    const glm::vec3* getCorners() const;
+
+    bool assign(const void* nodeData, size_t nodeCount, const glm::vec3* corners, size_t triangleCount);
+
+private:
+    int buildNode(std::vector<int>& order, const std::vector<glm::vec3>& source, const std::vector<glm::vec3>& centroids, int begin, int end);
+
+private:
+    // Inner nodes: left child follows at index + 1, right child at rightOrFirst. Leaves: triangles
+    // [rightOrFirst, rightOrFirst + count).
+    struct Node
+    {
+        glm::vec3 boundsMin = glm::vec3(0.0f);
+        int rightOrFirst = 0;
+        glm::vec3 boundsMax = glm::vec3(0.0f);
+        int count = 0;
+    };
+
+    static_assert(sizeof(Node) == kNodeBytes, "Node layout is part of the model cache format");
+
+    std::vector<Node> nodes;
+
+    // Three corners per triangle.
+    std::vector<glm::vec3> corners;
+};
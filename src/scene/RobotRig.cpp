@@ -2,7 +2,12 @@
 
 #include <algorithm>
 #include <cmath>
+#include <limits>
 #include <gtc/matrix_transform.hpp>
+#include <gtc/matrix_inverse.hpp>
+
+#include "SceneGraph.h"
+#include "MeshBvh.h"
 
 static constexpr const char* kTorso = "torso";
 static constexpr const char* kHead = "head";
@@ -17,111 +22,249 @@ static constexpr const char* kRLegLo = "right_leg_low";
 static constexpr const char* kLHand = "left_hand";
 static constexpr const char* kRHand = "right_hand";
 
-static glm::mat4 scaleUniform(float s)
+struct BodyPartJoints
 {
-    glm::mat4 S(1.0f);
-    S[0][0] = s;
-    S[1][1] = s;
-    S[2][2] = s;
-
-    return S;
-}
+    const char* name;
+    int joints[2];
+};
 
-bool RobotRig::initialize()
+// Posed body parts and the joints driving each of them (-1 = unused); the array index is the body part id.
+// For limb dragging, joints[0] follows dy (primary) and joints[1] follows dx (secondary).
+static const BodyPartJoints kBodyParts[RobotRig::kBodyPartCount] =
 {
-    theta.assign(kJointCount, 0.0f);
-    selectedNodeName.clear();
+    { kTorso, { 0, -1 } },
+    { kHead, { 1, 10 } },
+    { kLArmHi, { 2, 11 } },
+    { kLArmLo, { 3, -1 } },
+    { kRArmHi, { 4, 12 } },
+    { kRArmLo, { 5, -1 } },
+    { kLLegHi, { 6, 13 } },
+    { kLLegLo, { 7, 19 } },
+    { kRLegHi, { 8, 14 } },
+    { kRLegLo, { 9, 20 } },
+    { kLHand, { 15, 17 } },
+    { kRHand, { 16, 18 } }
+};
+
+// Scenes at least this large update world transforms level by level across cores.
+static constexpr int kParallelNodeThreshold = 4096;
+
+// Draws a run of meshes at one LOD level (clamped per mesh), merging consecutive meshes that share VAO,
+// index type and (when textured) texture into one glMultiDrawElementsBaseVertex call. Bound VAO/texture
+// are tracked across calls.
+static void drawMeshes(const GpuMesh* meshes, int count, int lod, bool bindTextures, GLuint& boundVao, GLuint& boundTex)
+{
+    static constexpr int kMaxBatch = 64;
 
-    // Pickable node colors (id packed in RGB).
-    std::vector<std::string> pickables =
-    {
-        kTorso, kHead,
-        kLArmHi, kLArmLo, kRArmHi, kRArmLo,
-        kLLegHi, kLLegLo, kRLegHi, kRLegLo,
-        kLHand, kRHand
-    };
+    GLsizei counts[kMaxBatch];
+    const void* offsets[kMaxBatch];
+    GLint baseVertices[kMaxBatch];
 
-    nameToPickColor.clear();
-    pickIdToName.clear();
+    int i = 0;
 
-    for (int i = 0; i < (int)pickables.size(); ++i)
+    while (i < count)
     {
-        unsigned int id = (unsigned int)(i + 1);
-        float r = ((id) & 255) / 255.0f;
-        float g = ((id >> 8) & 255) / 255.0f;
-        float b = ((id >> 16) & 255) / 255.0f;
-        nameToPickColor[pickables[i]] = glm::vec3(r, g, b);
-        pickIdToName[id] = pickables[i];
+        const GpuMesh& first = meshes[i];
+
+        if (first.vao != boundVao)
+        {
+            glBindVertexArray(first.vao);
+            boundVao = first.vao;
+        }
+
+        if (bindTextures && first.textureId != boundTex)
+        {
+            glBindTexture(GL_TEXTURE_2D, first.textureId);
+            boundTex = first.textureId;
+        }
+
+        int n = 0;
+
+        while (i < count && n < kMaxBatch)
+        {
+            const GpuMesh& m = meshes[i];
+
+            if (m.vao != first.vao || m.indexType != first.indexType || (bindTextures && m.textureId != first.textureId))
+            {
+                break;
+            }
+
+            int level = std::min(lod, m.lodCount - 1);
+
+            counts[n] = m.getLodIndexCount(level);
+            offsets[n] = reinterpret_cast<const void*>(m.getLodIndexOffset(level));
+            baseVertices[n] = m.baseVertex;
+            ++n;
+            ++i;
+        }
+
+        if (n == 1)
+        {
+            glDrawElementsBaseVertex(GL_TRIANGLES, counts[0], first.indexType, offsets[0], baseVertices[0]);
+        }
+        else
+        {
+            glMultiDrawElementsBaseVertex(GL_TRIANGLES, counts, first.indexType, offsets, n, baseVertices);
+        }
     }
+}
 
-    // Limb drag mapping (dy = primary, dx = secondary).
-    limbJointMap.clear();
-    limbJointMap[kTorso] = { 0, -1 };
-    limbJointMap[kHead] = { 1, 10 };
+// Selection outline width, constant in screen space.
+static constexpr float kOutlineWidthPixels = 3.0f;
 
-    limbJointMap[kLArmHi] = { 2, 11 };
-    limbJointMap[kLArmLo] = { 3, -1 };
+// Stencil value the main pass writes under the selected node.
+static constexpr GLint kSelectionStencil = 1;
 
-    limbJointMap[kRArmHi] = { 4, 12 };
-    limbJointMap[kRArmLo] = { 5, -1 };
+const char* RobotRig::getBodyPartName(int part)
+{
+    return (part >= 0 && part < kBodyPartCount) ? kBodyParts[part].name : "";
+}
 
-    limbJointMap[kLLegHi] = { 6, 13 };
-    limbJointMap[kLLegLo] = { 7, 19 };
+bool RobotRig::initialize(const ShaderProgram& robotShader, const ShaderProgram& outlineShader)
+{
+    // The sampler unit never changes, so it is program state set once rather than per frame.
+    robotShader.bind();
+    robotShader.setInt("uSampler", 0);
+
+    uModel = robotShader.getUniform<glm::mat4>("model");
+    uNormalMatrix = robotShader.getUniform<glm::mat3>("normalMatrix");
+    uPickId = robotShader.getUniform<GLuint>("uPickId");
 
-    limbJointMap[kRLegHi] = { 8, 14 };
-    limbJointMap[kRLegLo] = { 9, 20 };
+    uOutlineModel = outlineShader.getUniform<glm::mat4>("model");
+    uOutlineNormalMatrix = outlineShader.getUniform<glm::mat3>("normalMatrix");
+    uOutlineExtent = outlineShader.getUniform<glm::vec2>("uOutlineExtent");
+
+    theta.assign(kJointCount, 0.0f);
+    selectedPart = -1;
 
-    limbJointMap[kLHand] = { 15, 17 };
-    limbJointMap[kRHand] = { 16, 18 };
+    for (int p = 0; p < kBodyPartCount; ++p)
+    {
+        partNode[p] = -1;
+    }
 
     // Animation system mapping.
-    std::unordered_map<std::string, std::vector<int>> bodyPartMap;
-    bodyPartMap[kTorso] = { 0 };
-    bodyPartMap[kHead] = { 1, 10 };
-    bodyPartMap[kLArmHi] = { 2, 11 };
-    bodyPartMap[kLArmLo] = { 3 };
-    bodyPartMap[kRArmHi] = { 4, 12 };
-    bodyPartMap[kRArmLo] = { 5 };
-    bodyPartMap[kLLegHi] = { 6, 13 };
-    bodyPartMap[kLLegLo] = { 7, 19 };
-    bodyPartMap[kRLegHi] = { 8, 14 };
-    bodyPartMap[kRLegLo] = { 9, 20 };
-    bodyPartMap[kLHand] = { 15, 17 };
-    bodyPartMap[kRHand] = { 16, 18 };
+    std::vector<std::pair<std::string, std::vector<int>>> bodyPartMap;
+
+    for (int p = 0; p < kBodyPartCount; ++p)
+    {
+        std::vector<int> ids;
+
+        for (int k = 0; k < 2; ++k)
+        {
+            if (kBodyParts[p].joints[k] >= 0)
+            {
+                ids.push_back(kBodyParts[p].joints[k]);
+            }
+        }
+
+        bodyPartMap.push_back({ kBodyParts[p].name, ids });
+    }
 
     animSystem = AnimationSystem(kJointCount, bodyPartMap);
 
+    frameUniforms.lightPosition = glm::vec4(0.0f, 2.0f, 50.0f, 1.0f);
+
+    if (!frameUniformBuffer.create(sizeof(FrameUniforms), kFrameDataBinding))
+    {
+        return false;
+    }
+
     return true;
 }
 
 void RobotRig::shutdown()
 {
-    if (pickFbo != 0)
-    {
-        glDeleteFramebuffers(1, &pickFbo);
-        glDeleteTextures(1, &pickTex);
-        glDeleteRenderbuffers(1, &pickDepth);
+    destroySceneTargets();
 
-        pickFbo = 0;
-        pickTex = 0;
-        pickDepth = 0;
-        pickW = 0;
-        pickH = 0;
-    }
+    frameUniformBuffer.destroy();
 
     rootNode.reset();
-    selectedNodeName.clear();
+    flatScene.reset();
+    poseValid = false;
+    selectedPart = -1;
     limbDrag.active = false;
 }
 
-void RobotRig::setRootNode(const std::shared_ptr<SceneNode>& root)
+void RobotRig::setRootNode(const std::shared_ptr<SceneNode>& root, const std::shared_ptr<FlatScene>& flat)
 {
     rootNode = root;
+    flatScene = root ? flat : nullptr;
+    poseValid = false;
+
+    nodePart.clear();
+    nodePose.clear();
+    worldTransforms.clear();
+    normalMatrices.clear();
+    nodeDirty.clear();
+    nodePickPart.clear();
+    nodeBoundsMin.clear();
+    nodeBoundsMax.clear();
+    subtreeBoundsMin.clear();
+    subtreeBoundsMax.clear();
+    nodeVisible.clear();
+    nodeLod.clear();
+    cullStats = CullStats();
+    lodStats = LodStats();
+
+    for (int p = 0; p < kBodyPartCount; ++p)
+    {
+        partNode[p] = -1;
+    }
+
+    setHoveredPickId(0);
+
+    if (!flatScene)
+    {
+        return;
+    }
+
+    int count = flatScene->getNodeCount();
+
+    nodePart.assign(static_cast<size_t>(count), -1);
+    nodePose.assign(static_cast<size_t>(count), glm::mat4(1.0f));
+    worldTransforms.assign(static_cast<size_t>(count), glm::mat4(1.0f));
+    normalMatrices.assign(static_cast<size_t>(count), glm::mat3(1.0f));
+    nodeDirty.assign(static_cast<size_t>(count), 0);
+
+    // Nodes without meshes keep an empty box, which never widens a subtree and is always culled.
+    nodeBoundsMin.assign(static_cast<size_t>(count), glm::vec3(std::numeric_limits<float>::max()));
+    nodeBoundsMax.assign(static_cast<size_t>(count), glm::vec3(-std::numeric_limits<float>::max()));
+    subtreeBoundsMin = nodeBoundsMin;
+    subtreeBoundsMax = nodeBoundsMax;
+    nodeVisible.assign(static_cast<size_t>(count), 0);
+    nodeLod.assign(static_cast<size_t>(count), 0);
+
+    for (int n = 0; n < count; ++n)
+    {
+        for (int p = 0; p < kBodyPartCount; ++p)
+        {
+            if (flatScene->names[n] == kBodyParts[p].name)
+            {
+                nodePart[n] = p;
+
+                if (partNode[p] < 0)
+                {
+                    partNode[p] = n;
+                }
+
+                break;
+            }
+        }
+    }
+
+    // Parents precede children, so one forward pass inherits the nearest posed ancestor.
+    nodePickPart.assign(static_cast<size_t>(count), -1);
+
+    for (int n = 0; n < count; ++n)
+    {
+        int parent = flatScene->parentIndices[n];
+        nodePickPart[n] = (nodePart[n] >= 0) ? nodePart[n] : ((parent >= 0) ? nodePickPart[parent] : -1);
+    }
 }
 
 void RobotRig::onResize(int w, int h)
 {
-    recreatePickTargetsIfNeeded(w, h);
+    recreateSceneTargetsIfNeeded(w, h);
 }
 
 void RobotRig::update(float deltaTime)
@@ -130,12 +273,7 @@ void RobotRig::update(float deltaTime)
     if (animSystem.getIsPlaying())
     {
         animSystem.update(deltaTime);
-        std::vector<float> animAngles = animSystem.getCurrentAngles(theta);
-
-        for (int i = 0; i < (int)theta.size(); ++i)
-        {
-            theta[i] = animAngles[i];
-        }
+        animSystem.sampleBaked(animSystem.getCurrentFrame(), theta.data());
     }
 }
 
@@ -241,6 +379,34 @@ const std::vector<float>& RobotRig::getAngles() const
     return theta;
 }
 
+const std::shared_ptr<FlatScene>& RobotRig::getFlatScene() const
+{
+    return flatScene;
+}
+
+const std::vector<glm::mat4>& RobotRig::getWorldTransforms() const
+{
+    return worldTransforms;
+}
+
+void RobotRig::poseInstance(const float* angles, glm::mat4* outWorld) const
+{
+    if (!flatScene)
+    {
+        return;
+    }
+
+    int count = flatScene->getNodeCount();
+
+    for (int n = 0; n < count; ++n)
+    {
+        int parent = flatScene->parentIndices[n];
+        glm::mat4 t = (parent >= 0) ? outWorld[parent] * flatScene->localTransforms[n] : flatScene->localTransforms[n];
+
+        outWorld[n] = (nodePart[n] >= 0) ? t * buildPartPose(nodePart[n], angles) : t;
+    }
+}
+
 AnimationSystem& RobotRig::getAnimationSystem()
 {
     return animSystem;
@@ -251,7 +417,7 @@ const AnimationSystem& RobotRig::getAnimationSystem() const
     return animSystem;
 }
 
-std::unordered_map<std::string, glm::mat4> RobotRig::buildPoseTransforms() const
+glm::mat4 RobotRig::buildPartPose(int part, const float* angles) const
 {
     // Build pose transforms using degrees.
     auto RX = [&](float deg)
@@ -267,97 +433,274 @@ std::unordered_map<std::string, glm::mat4> RobotRig::buildPoseTransforms() const
             return glm::rotate(glm::mat4(1.0f), glm::radians(deg), glm::vec3(0.0f, 0.0f, 1.0f));
         };
 
-    std::unordered_map<std::string, glm::mat4> pose;
-
-    pose[kTorso] = RY(theta[0]);
-    pose[kHead] = RX(theta[1]) * RY(theta[10]);
+    switch (part)
+    {
+    case 0:  return RY(angles[0]);
+    case 1:  return RX(angles[1]) * RY(angles[10]);
+
+    case 2:  return RZ(angles[11]) * RX(angles[2]);
+    case 3:  return RX(angles[3]);
+    case 4:  return RZ(angles[12]) * RX(-angles[4]);
+    case 5:  return RX(angles[5]);
+
+    case 6:  return RZ(angles[13]) * RX(angles[6]);
+    case 7:  return RY(angles[19]) * RX(angles[7]);
+    case 8:  return RZ(angles[14]) * RX(angles[8]);
+    case 9:  return RY(angles[20]) * RX(angles[9]);
+
+    case 10: return RY(angles[17]) * RZ(-angles[15]);
+    case 11: return RY(angles[18]) * RX(angles[16]);
+    default: return glm::mat4(1.0f);
+    }
+}
 
-    pose[kLArmHi] = RZ(theta[11]) * RX(theta[2]);
-    pose[kRArmHi] = RZ(theta[12]) * RX(-theta[4]);
+void RobotRig::updateNormalMatrices(int begin, int end)
+{
+    // Only drawn nodes need one.
+    for (int n = begin; n < end; ++n)
+    {
+        if (flatScene->meshRanges[n].count > 0)
+        {
+            normalMatrices[n] = sceneGraph::computeNormalMatrix(worldTransforms[n]);
+        }
+    }
+}
 
-    pose[kLArmLo] = RX(theta[3]);
-    pose[kRArmLo] = RX(theta[5]);
+void RobotRig::updateNodeBounds(int begin, int end)
+{
+    for (int n = begin; n < end; ++n)
+    {
+        if (flatScene->meshRanges[n].count > 0)
+        {
+            sceneGraph::transformBounds(worldTransforms[n], flatScene->nodeBoundsMin[n], flatScene->nodeBoundsMax[n], nodeBoundsMin[n], nodeBoundsMax[n]);
+        }
+    }
+}
 
-    pose[kLLegHi] = RZ(theta[13]) * RX(theta[6]);
-    pose[kRLegHi] = RZ(theta[14]) * RX(theta[8]);
+void RobotRig::updateSubtreeBounds()
+{
+    int count = flatScene->getNodeCount();
 
-    pose[kLLegLo] = RY(theta[19]) * RX(theta[7]);
-    pose[kRLegLo] = RY(theta[20]) * RX(theta[9]);
+    std::copy(nodeBoundsMin.begin(), nodeBoundsMin.end(), subtreeBoundsMin.begin());
+    std::copy(nodeBoundsMax.begin(), nodeBoundsMax.end(), subtreeBoundsMax.begin());
 
-    pose[kLHand] = RY(theta[17]) * RZ(-theta[15]);
-    pose[kRHand] = RY(theta[18]) * RX(theta[16]);
+    // Children follow their parent in pre-order, so walking backwards folds every subtree into its root.
+    for (int n = count - 1; n > 0; --n)
+    {
+        int parent = flatScene->parentIndices[n];
 
-    return pose;
+        if (parent >= 0)
+        {
+            subtreeBoundsMin[parent] = glm::min(subtreeBoundsMin[parent], subtreeBoundsMin[n]);
+            subtreeBoundsMax[parent] = glm::max(subtreeBoundsMax[parent], subtreeBoundsMax[n]);
+        }
+    }
 }
 
-void RobotRig::traverseWithPose(
-    const std::shared_ptr<SceneNode>& node,
-    const glm::mat4& parentT,
-    const std::unordered_map<std::string, glm::mat4>& pose,
-    const std::function<void(const std::shared_ptr<SceneNode>&, const glm::mat4&)>& cb) const
+void RobotRig::updatePose(ThreadPool* pool)
 {
-    glm::mat4 t = parentT * node->localTransform;
+    if (!flatScene)
+    {
+        return;
+    }
+
+    int count = flatScene->getNodeCount();
+
+    if (!poseValid || posedTheta.size() != theta.size())
+    {
+        for (int n = 0; n < count; ++n)
+        {
+            nodePose[n] = (nodePart[n] >= 0) ? buildPartPose(nodePart[n], theta.data()) : glm::mat4(1.0f);
+        }
+
+        if (count >= kParallelNodeThreshold)
+        {
+            sceneGraph::computeWorldTransformsByLevel(*flatScene, nodePose.data(), worldTransforms.data(), pool);
+        }
+        else
+        {
+            sceneGraph::computeWorldTransforms(*flatScene, nodePose.data(), worldTransforms.data());
+        }
+
+        updateNormalMatrices(0, count);
+        updateNodeBounds(0, count);
+        updateSubtreeBounds();
+
+        posedTheta = theta;
+        poseValid = true;
+
+        return;
+    }
+
+    // Mark body parts whose joints moved since the last pose.
+    bool partDirty[kBodyPartCount] = { false };
+    bool anyDirty = false;
+
+    for (int p = 0; p < kBodyPartCount; ++p)
+    {
+        for (int k = 0; k < 2; ++k)
+        {
+            int j = kBodyParts[p].joints[k];
+
+            if (j >= 0 && theta[j] != posedTheta[j])
+            {
+                partDirty[p] = true;
+                anyDirty = true;
+            }
+        }
+    }
 
-    auto it = pose.find(node->name);
-    if (it != pose.end())
+    if (!anyDirty)
     {
-        t = t * it->second;
+        return;
     }
 
-    cb(node, t);
+    for (int n = 0; n < count; ++n)
+    {
+        int p = nodePart[n];
+        nodeDirty[n] = (p >= 0 && partDirty[p]) ? 1 : 0;
+
+        if (nodeDirty[n])
+        {
+            nodePose[n] = buildPartPose(p, theta.data());
+        }
+    }
 
-    for (int i = 0; i < (int)node->children.size(); ++i)
+    // Pre-order layout: recompute each outermost dirty subtree once and skip past it.
+    for (int n = 0; n < count; )
     {
-        traverseWithPose(node->children[i], t, pose, cb);
+        if (nodeDirty[n])
+        {
+            sceneGraph::computeSubtreeWorldTransforms(*flatScene, nodePose.data(), worldTransforms.data(), n);
+            updateNormalMatrices(n, flatScene->subtreeEnds[n]);
+            updateNodeBounds(n, flatScene->subtreeEnds[n]);
+            n = flatScene->subtreeEnds[n];
+        }
+        else
+        {
+            ++n;
+        }
     }
+
+    updateSubtreeBounds();
+
+    posedTheta = theta;
 }
 
-void RobotRig::recreatePickTargetsIfNeeded(int w, int h)
+void RobotRig::recreateSceneTargetsIfNeeded(int w, int h)
 {
-    if (pickFbo != 0 && pickW == w && pickH == h)
+    if (sceneFbo != 0 && sceneW == w && sceneH == h)
     {
         return;
     }
 
-    if (pickFbo != 0)
+    destroySceneTargets();
+
+    if (w <= 0 || h <= 0)
     {
-        glDeleteFramebuffers(1, &pickFbo);
-        glDeleteTextures(1, &pickTex);
-        glDeleteRenderbuffers(1, &pickDepth);
-        pickFbo = 0;
-        pickTex = 0;
-        pickDepth = 0;
+        return;
     }
 
-    pickW = w;
-    pickH = h;
+    sceneW = w;
+    sceneH = h;
+
+    glGenFramebuffers(1, &sceneFbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, sceneFbo);
 
-    glGenFramebuffers(1, &pickFbo);
-    glBindFramebuffer(GL_FRAMEBUFFER, pickFbo);
+    glGenTextures(1, &sceneColorTex);
+    glBindTexture(GL_TEXTURE_2D, sceneColorTex);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, sceneW, sceneH, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 
-    glGenTextures(1, &pickTex);
-    glBindTexture(GL_TEXTURE_2D, pickTex);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, pickW, pickH, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glGenTextures(1, &scenePickTex);
+    glBindTexture(GL_TEXTURE_2D, scenePickTex);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32UI, sceneW, sceneH, 0, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 
-    glGenRenderbuffers(1, &pickDepth);
-    glBindRenderbuffer(GL_RENDERBUFFER, pickDepth);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, pickW, pickH);
+    glBindTexture(GL_TEXTURE_2D, 0);
 
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, pickTex, 0);
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, pickDepth);
+    glGenRenderbuffers(1, &sceneDepth);
+    glBindRenderbuffer(GL_RENDERBUFFER, sceneDepth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, sceneW, sceneH);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, sceneColorTex, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, scenePickTex, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, sceneDepth);
+
+    const GLenum drawBuffers[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+    glDrawBuffers(2, drawBuffers);
 
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    for (PickReadback& r : pickReadbacks)
+    {
+        glGenBuffers(1, &r.pbo);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, r.pbo);
+        glBufferData(GL_PIXEL_PACK_BUFFER, sizeof(GLuint), nullptr, GL_STREAM_READ);
+    }
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+void RobotRig::destroySceneTargets()
+{
+    for (PickReadback& r : pickReadbacks)
+    {
+        if (r.fence) glDeleteSync(r.fence);
+        if (r.pbo != 0) glDeleteBuffers(1, &r.pbo);
+
+        r.fence = nullptr;
+        r.pbo = 0;
+    }
+
+    pickReadbackHead = 0;
+    pickReadbackCount = 0;
+
+    if (sceneFbo != 0) glDeleteFramebuffers(1, &sceneFbo);
+    if (sceneColorTex != 0) glDeleteTextures(1, &sceneColorTex);
+    if (scenePickTex != 0) glDeleteTextures(1, &scenePickTex);
+    if (sceneDepth != 0) glDeleteRenderbuffers(1, &sceneDepth);
+
+    sceneFbo = 0;
+    sceneColorTex = 0;
+    scenePickTex = 0;
+    sceneDepth = 0;
+    sceneW = 0;
+    sceneH = 0;
+}
+
+void RobotRig::beginScenePass(const glm::vec4& clearColor)
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, sceneFbo);
+    glViewport(0, 0, sceneW, sceneH);
+
+    if (sceneFbo == 0)
+    {
+        // Zero-sized (minimised) window: nothing is visible and there is nothing to pick.
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+
+        return;
+    }
+
+    const GLuint noPick[4] = { 0, 0, 0, 0 };
+
+    glClearBufferfv(GL_COLOR, 0, &clearColor.x);
+    glClearBufferuiv(GL_COLOR, 1, noPick);
+    glClear(GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
 }
 
-std::string RobotRig::pickAtCursor(GLFWwindow* window, const glm::mat4& mvp, ShaderProgram& pickShader)
+void RobotRig::endScenePass(GLFWwindow* window)
 {
-    if (!rootNode || pickFbo == 0)
+    if (sceneFbo == 0)
     {
-        return "";
+        return;
     }
 
+    collectPickReadbacks();
+
     double mx = 0.0;
     double my = 0.0;
     glfwGetCursorPos(window, &mx, &my);
@@ -367,83 +710,193 @@ std::string RobotRig::pickAtCursor(GLFWwindow* window, const glm::mat4& mvp, Sha
     int h = 0;
     glfwGetWindowSize(window, &w, &h);
 
-    int fbW = 0;
-    int fbH = 0;
-    glfwGetFramebufferSize(window, &fbW, &fbH);
-
-    float sx = (w > 0) ? (float)fbW / (float)w : 1.0f;
-    float sy = (h > 0) ? (float)fbH / (float)h : 1.0f;
+    float sx = (w > 0) ? (float)sceneW / (float)w : 1.0f;
+    float sy = (h > 0) ? (float)sceneH / (float)h : 1.0f;
 
     int px = (int)(mx * sx);
     int py = (int)(my * sy);
 
-    if (px < 0 || py < 0 || px >= fbW || py >= fbH)
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, sceneFbo);
+
+    if (px < 0 || py < 0 || px >= sceneW || py >= sceneH)
     {
-        return "";
+        setHoveredPickId(0);
     }
+    else if (pickReadbackCount < kPickReadbackRing)
+    {
+        // Never wait: with every slot still in flight this frame's pick is simply skipped.
+        PickReadback& r = pickReadbacks[(pickReadbackHead + pickReadbackCount) % kPickReadbackRing];
 
-    glBindFramebuffer(GL_FRAMEBUFFER, pickFbo);
-    glViewport(0, 0, pickW, pickH);
-    glDisable(GL_BLEND);
-    glEnable(GL_DEPTH_TEST);
-
-    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        glReadBuffer(GL_COLOR_ATTACHMENT1);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, r.pbo);
+        glReadPixels(px, sceneH - py - 1, 1, 1, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
 
-    renderPickingScene(pickShader, mvp);
+        r.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        ++pickReadbackCount;
+    }
 
-    unsigned char pxData[4] = { 0, 0, 0, 0 };
-    glReadPixels(px, pickH - py - 1, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, pxData);
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+    glBlitFramebuffer(0, 0, sceneW, sceneH, 0, 0, sceneW, sceneH, GL_COLOR_BUFFER_BIT, GL_NEAREST);
 
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void RobotRig::collectPickReadbacks()
+{
+    // In order, stopping at the first copy the GPU has not finished.
+    while (pickReadbackCount > 0)
+    {
+        PickReadback& r = pickReadbacks[pickReadbackHead];
+        GLenum status = glClientWaitSync(r.fence, 0, 0);
+
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+        {
+            return;
+        }
+
+        glDeleteSync(r.fence);
+        r.fence = nullptr;
+
+        GLuint id = 0;
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, r.pbo);
+        glGetBufferSubData(GL_PIXEL_PACK_BUFFER, 0, sizeof(GLuint), &id);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        setHoveredPickId(id);
 
-    unsigned int id = (unsigned int)pxData[0] | ((unsigned int)pxData[1] << 8) | ((unsigned int)pxData[2] << 16);
+        pickReadbackHead = (pickReadbackHead + 1) % kPickReadbackRing;
+        --pickReadbackCount;
+    }
+}
+
+void RobotRig::setHoveredPickId(unsigned int id)
+{
+    int instance = -1;
+    int node = -1;
 
-    auto it = pickIdToName.find(id);
-    if (it != pickIdToName.end())
+    if (!sceneGraph::decodePickId(id, instance, node) || node >= (int)nodePickPart.size() || nodePickPart[node] < 0)
     {
-        return it->second;
+        hoveredPickId = 0;
+        hoveredPart = -1;
+        hoveredInstance = -1;
+
+        return;
     }
 
-    return "";
+    hoveredPickId = id;
+    hoveredPart = nodePickPart[node];
+    hoveredInstance = instance;
+}
+
+int RobotRig::getHoveredPart() const
+{
+    return hoveredPart;
+}
+
+int RobotRig::getHoveredInstance() const
+{
+    return hoveredInstance;
 }
 
-void RobotRig::renderPickingScene(ShaderProgram& pickShader, const glm::mat4& mvp) const
+void RobotRig::setPickMode(PickMode mode)
 {
-    pickShader.bind();
-    pickShader.setMat4("uMvpMatrix", mvp);
+    pickMode = mode;
+}
 
-    auto pose = buildPoseTransforms();
+RobotRig::PickMode RobotRig::getPickMode() const
+{
+    return pickMode;
+}
 
-    traverseWithPose(rootNode, glm::mat4(1.0f), pose, [&](const std::shared_ptr<SceneNode>& node, const glm::mat4& t)
+int RobotRig::raycastNode(const glm::vec3& origin, const glm::vec3& dir, float* outT) const
+{
+    if (!flatScene || flatScene->meshBvhs.size() != flatScene->meshes.size())
     {
-        auto it = nameToPickColor.find(node->name);
-        if (it == nameToPickColor.end())
+        return -1;
+    }
+
+    float nearest = std::numeric_limits<float>::max();
+    int hitNode = -1;
+
+    for (int n = 0; n < flatScene->getNodeCount(); ++n)
+    {
+        const MeshRange& range = flatScene->meshRanges[n];
+
+        if (range.count == 0)
         {
-            return;
+            continue;
         }
 
-        pickShader.setMat4("model", t);
-        pickShader.setVec3("uPickColor", it->second);
+        // Affine map: the local ray keeps the world ray's t, so hits compare across nodes directly.
+        glm::mat4 toLocal = glm::affineInverse(worldTransforms[n]);
+        glm::vec3 localOrigin = glm::vec3(toLocal * glm::vec4(origin, 1.0f));
+        glm::vec3 localDir = glm::vec3(toLocal * glm::vec4(dir, 0.0f));
 
-        for (int i = 0; i < (int)node->meshes.size(); ++i)
+        for (int m = range.first; m < range.first + range.count; ++m)
         {
-            const GpuMesh& m = node->meshes[i];
-            glBindVertexArray(m.vao);
-            glDrawElements(GL_TRIANGLES, m.indexCount, GL_UNSIGNED_INT, nullptr);
+            const MeshBvh* bvh = flatScene->meshBvhs[m].get();
+
+            if (bvh && bvh->raycast(localOrigin, localDir, nearest))
+            {
+                hitNode = n;
+            }
         }
+    }
+
+    if (outT && hitNode >= 0)
+    {
+        *outT = nearest;
+    }
 
-        glBindVertexArray(0);
-    });
+    return hitNode;
 }
 
-bool RobotRig::onLeftMousePress(GLFWwindow* window, const glm::mat4& mvp, ShaderProgram& pickShader)
+int RobotRig::raycastPartAtCursor(GLFWwindow* window, const glm::mat4& mvp) const
 {
-    std::string hit = pickAtCursor(window, mvp, pickShader);
+    double mx = 0.0;
+    double my = 0.0;
+    glfwGetCursorPos(window, &mx, &my);
+
+    int w = 0;
+    int h = 0;
+    glfwGetWindowSize(window, &w, &h);
 
-    if (!hit.empty())
+    if (w <= 0 || h <= 0 || mx < 0.0 || my < 0.0 || mx >= w || my >= h)
     {
-        selectedNodeName = hit;
+        return -1;
+    }
+
+    // Cursor -> NDC -> world points on the near and far planes.
+    float x = (float)(2.0 * (mx + 0.5) / w - 1.0);
+    float y = (float)(1.0 - 2.0 * (my + 0.5) / h);
+
+    glm::mat4 inv = glm::inverse(mvp);
+    glm::vec4 nearPoint = inv * glm::vec4(x, y, -1.0f, 1.0f);
+    glm::vec4 farPoint = inv * glm::vec4(x, y, 1.0f, 1.0f);
+
+    glm::vec3 origin = glm::vec3(nearPoint) / nearPoint.w;
+    glm::vec3 dir = glm::vec3(farPoint) / farPoint.w - origin;
+
+    int node = raycastNode(origin, dir);
+
+    return (node >= 0) ? nodePickPart[node] : -1;
+}
+
+bool RobotRig::onLeftMousePress(GLFWwindow* window, const glm::mat4& mvp)
+{
+    int hit = hoveredPart;
+
+    if (pickMode == PickMode::CpuRay)
+    {
+        updatePose();
+        hit = raycastPartAtCursor(window, mvp);
+    }
+
+    if (hit >= 0)
+    {
+        selectedPart = hit;
         limbDrag.active = true;
         glfwGetCursorPos(window, &limbDrag.lastX, &limbDrag.lastY);
 
@@ -455,21 +908,27 @@ bool RobotRig::onLeftMousePress(GLFWwindow* window, const glm::mat4& mvp, Shader
     return false;
 }
 
-void RobotRig::onLeftMouseRelease(GLFWwindow* window, const glm::mat4& mvp, ShaderProgram& pickShader)
+void RobotRig::onLeftMouseRelease(GLFWwindow* window, const glm::mat4& mvp)
 {
     limbDrag.active = false;
 
-    std::string hit = pickAtCursor(window, mvp, pickShader);
+    int hit = hoveredPart;
 
-    if (!hit.empty())
+    if (pickMode == PickMode::CpuRay)
     {
-        selectedNodeName = hit;
+        updatePose();
+        hit = raycastPartAtCursor(window, mvp);
+    }
+
+    if (hit >= 0)
+    {
+        selectedPart = hit;
     }
 }
 
 void RobotRig::onMouseMove(double x, double y)
 {
-    if (!limbDrag.active || selectedNodeName.empty())
+    if (!limbDrag.active || selectedPart < 0)
     {
         return;
     }
@@ -477,21 +936,18 @@ void RobotRig::onMouseMove(double x, double y)
     double dx = x - limbDrag.lastX;
     double dy = y - limbDrag.lastY;
 
-    auto it = limbJointMap.find(selectedNodeName);
+    const BodyPartJoints& limb = kBodyParts[selectedPart];
 
-    if (it != limbJointMap.end())
+    if (dy != 0.0 && limb.joints[0] >= 0)
     {
-        if (dy != 0.0 && it->second.primary >= 0)
-        {
-            int p = it->second.primary;
-            theta[p] = clampJoint(p, theta[p] + (float)dy * limbDragSensitivity);
-        }
+        int p = limb.joints[0];
+        theta[p] = clampJoint(p, theta[p] + (float)dy * limbDragSensitivity);
+    }
 
-        if (dx != 0.0 && it->second.secondary >= 0)
-        {
-            int s = it->second.secondary;
-            theta[s] = clampJoint(s, theta[s] - (float)dx * limbDragSensitivity);
-        }
+    if (dx != 0.0 && limb.joints[1] >= 0)
+    {
+        int s = limb.joints[1];
+        theta[s] = clampJoint(s, theta[s] - (float)dx * limbDragSensitivity);
     }
 
     limbDrag.lastX = x;
@@ -510,97 +966,292 @@ bool RobotRig::getIsLimbDragging() const
 
 const std::string& RobotRig::getSelectedNodeName() const
 {
-    return selectedNodeName;
+    static const std::string kNone;
+
+    if (!flatScene || selectedPart < 0 || partNode[selectedPart] < 0)
+    {
+        return kNone;
+    }
+
+    return flatScene->names[partNode[selectedPart]];
+}
+
+int RobotRig::getSelectedPart() const
+{
+    return selectedPart;
 }
 
 void RobotRig::clearSelection()
 {
-    selectedNodeName.clear();
+    selectedPart = -1;
 }
 
-void RobotRig::renderRobotScene(ShaderProgram& robotShader, const glm::mat4& mvp, const glm::vec3& eye) const
+void RobotRig::beginFrame(const glm::mat4& mvp, const glm::vec3& eye)
 {
-    if (!rootNode)
+    frameUniforms.mvpMatrix = mvp;
+    frameUniforms.viewPosition = glm::vec4(eye, 1.0f);
+
+    // No hover highlight while dragging a limb; the selection outline already marks it.
+    frameUniforms.pickHighlight.x = limbDrag.active ? 0u : hoveredPickId;
+
+    frameUniformBuffer.update(&frameUniforms, sizeof(FrameUniforms));
+
+    selectionStenciled = false;
+    cullStats = CullStats();
+    lodStats = LodStats();
+
+    if (!flatScene)
     {
         return;
     }
 
-    robotShader.bind();
-    robotShader.setMat4("uMvpMatrix", mvp);
-    robotShader.setVec3("uViewPosition", eye);
-    robotShader.setVec3("uLightPosition", glm::vec3(0.0f, 2.0f, 50.0f));
-    robotShader.setInt("uSampler", 0);
+    sceneGraph::Frustum frustum = sceneGraph::extractFrustum(mvp);
+    int count = flatScene->getNodeCount();
+
+    for (int n = 0; n < count; )
+    {
+        int end = flatScene->subtreeEnds[n];
+
+        // One test rejects the whole subtree, e.g. an arm when the camera is on the other hand.
+        if (frustumCulling && sceneGraph::isBoxOutside(frustum, subtreeBoundsMin[n], subtreeBoundsMax[n]))
+        {
+            for (int k = n; k < end; ++k)
+            {
+                nodeVisible[k] = 0;
+
+                if (flatScene->meshRanges[k].count > 0)
+                {
+                    ++cullStats.culledNodes;
+                }
+            }
+
+            if (end - n > 1)
+            {
+                ++cullStats.culledSubtrees;
+            }
 
-    auto pose = buildPoseTransforms();
+            n = end;
 
-    traverseWithPose(rootNode, glm::mat4(1.0f), pose, [&](const std::shared_ptr<SceneNode>& node, const glm::mat4& t)
+            continue;
+        }
+
+        if (flatScene->meshRanges[n].count > 0)
+        {
+            bool visible = !frustumCulling || !sceneGraph::isBoxOutside(frustum, nodeBoundsMin[n], nodeBoundsMax[n]);
+
+            nodeVisible[n] = visible ? 1 : 0;
+
+            if (visible)
+            {
+                ++cullStats.drawnNodes;
+            }
+            else
+            {
+                ++cullStats.culledNodes;
+            }
+        }
+        else
+        {
+            nodeVisible[n] = 0;
+        }
+
+        ++n;
+    }
+
+    sceneGraph::LodView lodView;
+    lodView.viewProj = mvp;
+    lodView.viewportHeight = static_cast<float>(sceneH);
+    lodView.maxPixelError = lodPixelError;
+
+    for (int n = 0; n < count; ++n)
     {
-        robotShader.setMat4("model", t);
+        if (!nodeVisible[n])
+        {
+            continue;
+        }
+
+        int level = 0;
 
-        for (int i = 0; i < (int)node->meshes.size(); ++i)
+        if (meshLods && sceneH > 0 && flatScene->nodeLodCounts[n] > 1)
         {
-            const GpuMesh& m = node->meshes[i];
+            // Node-local errors to world units, then to pixels at the node's distance.
+            float scale = sceneGraph::getMaxScale(worldTransforms[n]);
+            float errors[GpuMesh::kMaxLods];
 
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, m.textureId);
+            for (int l = 0; l < GpuMesh::kMaxLods; ++l)
+            {
+                errors[l] = flatScene->nodeLodErrors[static_cast<size_t>(n) * GpuMesh::kMaxLods + l] * scale;
+            }
 
-            glBindVertexArray(m.vao);
-            glDrawElements(GL_TRIANGLES, m.indexCount, GL_UNSIGNED_INT, nullptr);
+            float pixelsPerUnit = sceneGraph::computePixelsPerUnit(lodView, nodeBoundsMin[n], nodeBoundsMax[n]);
+            level = sceneGraph::selectLod(errors, flatScene->nodeLodCounts[n], pixelsPerUnit, lodPixelError, nodeLod[n]);
         }
 
-        glBindVertexArray(0);
-    });
+        nodeLod[n] = static_cast<unsigned char>(level);
+        ++lodStats.nodesPerLevel[level];
+
+        const MeshRange& range = flatScene->meshRanges[n];
+
+        for (int i = range.first; i < range.first + range.count; ++i)
+        {
+            const GpuMesh& m = flatScene->meshes[i];
+            lodStats.triangles += static_cast<uint64_t>(m.getLodIndexCount(std::min(level, m.lodCount - 1)) / 3);
+        }
+    }
+}
+
+void RobotRig::setFrustumCulling(bool enabled)
+{
+    frustumCulling = enabled;
+}
+
+bool RobotRig::getFrustumCulling() const
+{
+    return frustumCulling;
+}
+
+const RobotRig::CullStats& RobotRig::getCullStats() const
+{
+    return cullStats;
+}
+
+void RobotRig::setMeshLods(bool enabled)
+{
+    meshLods = enabled;
+}
+
+bool RobotRig::getMeshLods() const
+{
+    return meshLods;
+}
+
+void RobotRig::setLodPixelError(float pixels)
+{
+    lodPixelError = std::max(pixels, 0.0f);
 }
 
-void RobotRig::renderOutline(ShaderProgram& outlineShader, const glm::mat4& mvp) const
+float RobotRig::getLodPixelError() const
 {
-    if (!rootNode || selectedNodeName.empty())
+    return lodPixelError;
+}
+
+const RobotRig::LodStats& RobotRig::getLodStats() const
+{
+    return lodStats;
+}
+
+void RobotRig::renderRobotScene(ShaderProgram& robotShader)
+{
+    if (!flatScene)
     {
         return;
     }
 
-    outlineShader.bind();
-    outlineShader.setMat4("uMvpMatrix", mvp);
+    int selectedNode = (selectedPart >= 0) ? partNode[selectedPart] : -1;
 
-    outlineShader.setVec3("uColor", glm::vec3(1.0f, 1.0f, 1.0f));
-    outlineShader.setVec3("uOutlineColor", glm::vec3(1.0f, 1.0f, 1.0f));
+    robotShader.bind();
+
+    glActiveTexture(GL_TEXTURE0);
 
-    auto pose = buildPoseTransforms();
+    GLuint boundVao = 0;
+    GLuint boundTex = 0;
+    glBindTexture(GL_TEXTURE_2D, 0);
 
-    std::shared_ptr<SceneNode> hitNode;
-    glm::mat4 hitT(1.0f);
+    // Only the selected node's draws write the stencil, so renderOutline gets its mask for free.
+    glEnable(GL_STENCIL_TEST);
+    glStencilFunc(GL_ALWAYS, kSelectionStencil, 0xFF);
+    glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
+    glStencilMask(0x00);
 
-    traverseWithPose(rootNode, glm::mat4(1.0f), pose, [&](const std::shared_ptr<SceneNode>& node, const glm::mat4& t)
+    for (int n = 0; n < flatScene->getNodeCount(); ++n)
     {
-        if (!hitNode && node->name == selectedNodeName)
+        const MeshRange& range = flatScene->meshRanges[n];
+
+        if (range.count == 0 || !nodeVisible[n])
+        {
+            continue;
+        }
+
+        if (n == selectedNode)
         {
-            hitNode = node;
-            hitT = t;
+            glStencilMask(0xFF);
         }
-    });
 
-    if (!hitNode)
+        robotShader.set(uModel, worldTransforms[n]);
+        robotShader.set(uNormalMatrix, normalMatrices[n]);
+        robotShader.set(uPickId, sceneGraph::encodePickId(0, n));
+        drawMeshes(flatScene->meshes.data() + range.first, range.count, nodeLod[n], true, boundVao, boundTex);
+
+        if (n == selectedNode)
+        {
+            glStencilMask(0x00);
+            selectionStenciled = true;
+        }
+    }
+
+    glStencilMask(0xFF);
+    glDisable(GL_STENCIL_TEST);
+
+    glBindVertexArray(0);
+}
+
+void RobotRig::renderOutline(ShaderProgram& outlineShader) const
+{
+    if (!flatScene || selectedPart < 0 || partNode[selectedPart] < 0 || sceneW <= 0 || sceneH <= 0)
     {
         return;
     }
 
-    glEnable(GL_CULL_FACE);
-    glCullFace(GL_FRONT);
-    glDepthFunc(GL_LEQUAL);
+    int hitNode = partNode[selectedPart];
 
-    glm::mat4 inflated = hitT * scaleUniform(1.03f);
-    outlineShader.setMat4("model", inflated);
+    if (!nodeVisible[hitNode])
+    {
+        return;
+    }
+
+    outlineShader.bind();
+    outlineShader.set(uOutlineModel, worldTransforms[hitNode]);
+    outlineShader.set(uOutlineNormalMatrix, normalMatrices[hitNode]);
 
-    for (int i = 0; i < (int)hitNode->meshes.size(); ++i)
+    const MeshRange& range = flatScene->meshRanges[hitNode];
+
+    GLuint boundVao = 0;
+    GLuint boundTex = 0;
+
+    glEnable(GL_STENCIL_TEST);
+
+    if (!selectionStenciled)
     {
-        const GpuMesh& m = hitNode->meshes[i];
-        glBindVertexArray(m.vao);
-        glDrawElements(GL_TRIANGLES, m.indexCount, GL_UNSIGNED_INT, nullptr);
+        // The crowd pass does not mark the selection; stamp the unextruded meshes into the stencil only.
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        glDisable(GL_DEPTH_TEST);
+        glStencilFunc(GL_ALWAYS, kSelectionStencil, 0xFF);
+        glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
+
+        outlineShader.set(uOutlineExtent, glm::vec2(0.0f));
+        drawMeshes(flatScene->meshes.data() + range.first, range.count, nodeLod[hitNode], false, boundVao, boundTex);
+
+        glEnable(GL_DEPTH_TEST);
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
     }
 
+    // The outline shader has no pick output; keep the pick attachment as the main pass left it.
+    glColorMaski(1, GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+
+    // Extruded copy drawn only outside the selection's own pixels: the band left over is the exact
+    // silhouette, including concave parts that a scaled copy would cover or miss.
+    glStencilFunc(GL_NOTEQUAL, kSelectionStencil, 0xFF);
+    glStencilMask(0x00);
+    glDepthFunc(GL_LEQUAL);
+
+    outlineShader.set(uOutlineExtent, glm::vec2(2.0f * kOutlineWidthPixels / (float)sceneW, 2.0f * kOutlineWidthPixels / (float)sceneH));
+    drawMeshes(flatScene->meshes.data() + range.first, range.count, nodeLod[hitNode], false, boundVao, boundTex);
+
     glBindVertexArray(0);
 
-    glCullFace(GL_BACK);
-    glDisable(GL_CULL_FACE);
+    glColorMaski(1, GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+    glStencilMask(0xFF);
+    glDisable(GL_STENCIL_TEST);
     glDepthFunc(GL_LESS);
 }
\ No newline at end of file
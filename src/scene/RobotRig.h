@@ -2,9 +2,7 @@
 
 #include <string>
 #include <memory>
-#include <unordered_map>
 #include <vector>
-#include <functional>
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <glm.hpp>
@@ -13,19 +11,72 @@
 #include "../util/ShaderLoader.h"
 #include "../animation/AnimationSystem.h"
 
+class ThreadPool;
+
 class RobotRig
 {
 public:
     static constexpr int kJointCount = 21;
+    static constexpr int kBodyPartCount = 12;
+
+    // Uniform buffer binding point of the per-frame "FrameData" block shared by all rig programs.
+    static constexpr GLuint kFrameDataBinding = 0;
+
+    // Pick pixel readbacks in flight; each is collected once its fence has signalled.
+    static constexpr int kPickReadbackRing = 3;
+
+    // Instances per pool task when a crowd is posed through poseInstance.
+    static constexpr int kPoseInstancesPerTask = 16;
+
+    // How clicks find the body part: the ID buffer readback, or a CPU ray cast against per-mesh BVHs
+    // (no GPU round trip; needs a model loaded with LoadOptions::buildPickBvh).
+    enum class PickMode
+    {
+        IdBuffer,
+        CpuRay
+    };
+
+    // Nodes with meshes drawn / skipped by renderRobotScene this frame; culledSubtrees counts
+    // multi-node subtrees rejected by a single test against their hierarchical bounds.
+    struct CullStats
+    {
+        int drawnNodes = 0;
+        int culledNodes = 0;
+        int culledSubtrees = 0;
+    };
+
+    // Drawn nodes per LOD level and the triangles they submit, from the last beginFrame.
+    struct LodStats
+    {
+        int nodesPerLevel[GpuMesh::kMaxLods] = {};
+        uint64_t triangles = 0;
+    };
+
+    static const char* getBodyPartName(int part);
 
-    bool initialize();
+    // robotShader and outlineShader are the programs later passed to renderRobotScene and renderOutline;
+    // the robot sampler unit is set here and the per-draw uniforms of both are resolved once.
+    bool initialize(const ShaderProgram& robotShader, const ShaderProgram& outlineShader);
     void shutdown();
 
-    void setRootNode(const std::shared_ptr<SceneNode>& root);
+    void setRootNode(const std::shared_ptr<SceneNode>& root, const std::shared_ptr<FlatScene>& flat);
 
     void update(float deltaTime);
     void onResize(int w, int h);
 
+    // Per-frame pose stage: refreshes the cached world transforms for joints whose angle changed. A full
+    // repose of a large scene is split across pool by depth level when one is given.
+    void updatePose(ThreadPool* pool = nullptr);
+
+    const std::shared_ptr<FlatScene>& getFlatScene() const;
+
+    // World transforms of the cached pose, indexed like flatScene nodes.
+    const std::vector<glm::mat4>& getWorldTransforms() const;
+
+    // Poses another set of kJointCount angles into outWorld (one matrix per flatScene node) without
+    // touching the cached pose; safe to call from several threads at once.
+    void poseInstance(const float* angles, glm::mat4* outWorld) const;
+
     void resetPose();
 
     float clampJoint(int id, float val) const;
@@ -37,35 +88,107 @@ public:
     AnimationSystem& getAnimationSystem();
     const AnimationSystem& getAnimationSystem() const;
 
-    bool onLeftMousePress(GLFWwindow* window, const glm::mat4& mvp, ShaderProgram& pickShader);
-    void onLeftMouseRelease(GLFWwindow* window, const glm::mat4& mvp, ShaderProgram& pickShader);
+    // Clicks resolve against the pick ID last read back under the cursor or, in CpuRay mode, a ray
+    // through the cursor and mvp; neither renders or stalls.
+    bool onLeftMousePress(GLFWwindow* window, const glm::mat4& mvp);
+    void onLeftMouseRelease(GLFWwindow* window, const glm::mat4& mvp);
     void onMouseMove(double x, double y);
 
+    // Body part / instance under the cursor as of the last completed pick readback (-1 = none).
+    int getHoveredPart() const;
+    int getHoveredInstance() const;
+
+    void setPickMode(PickMode mode);
+    PickMode getPickMode() const;
+
+    // Nearest flatScene node hit by the world-space ray origin + t * dir under the cached pose (-1 = none).
+    // Each mesh is tested in its node's local space, so only the ray is transformed. No GL calls.
+    int raycastNode(const glm::vec3& origin, const glm::vec3& dir, float* outT = nullptr) const;
+
+    // Body part under the cursor by ray cast; uses window coordinates, not the framebuffer size.
+    int raycastPartAtCursor(GLFWwindow* window, const glm::mat4& mvp) const;
+
     void cancelLimbDrag();
     bool getIsLimbDragging() const;
 
     const std::string& getSelectedNodeName() const;
+    int getSelectedPart() const;
     void clearSelection();
 
-    void renderRobotScene(ShaderProgram& robotShader, const glm::mat4& mvp, const glm::vec3& eye) const;
-    void renderOutline(ShaderProgram& outlineShader, const glm::mat4& mvp) const;
+    // Uploads the per-frame uniform block once, culls the posed nodes against the mvp frustum and picks
+    // each drawn node's LOD from its projected size; the passes below only set per-draw uniforms.
+    void beginFrame(const glm::mat4& mvp, const glm::vec3& eye);
 
-private:
-    void recreatePickTargetsIfNeeded(int w, int h);
+    void setFrustumCulling(bool enabled);
+    bool getFrustumCulling() const;
+    const CullStats& getCullStats() const;
 
-    std::string pickAtCursor(GLFWwindow* window, const glm::mat4& mvp, ShaderProgram& pickShader);
-    void renderPickingScene(ShaderProgram& pickShader, const glm::mat4& mvp) const;
+    // With LODs off every node draws level 0. The app applies the same settings to the crowd.
+    void setMeshLods(bool enabled);
+    bool getMeshLods() const;
+    void setLodPixelError(float pixels);
+    float getLodPixelError() const;
+    const LodStats& getLodStats() const;
 
-    std::unordered_map<std::string, glm::mat4> buildPoseTransforms() const;
+    // Main pass into the scene targets (sized by onResize): shaded colour in attachment 0, pick IDs
+    // (sceneGraph::encodePickId) in the R32UI attachment 1, depth/stencil.
+    void beginScenePass(const glm::vec4& clearColor);
 
-    void traverseWithPose(
-        const std::shared_ptr<SceneNode>& node,
-        const glm::mat4& parentT,
-        const std::unordered_map<std::string, glm::mat4>& pose,
-        const std::function<void(const std::shared_ptr<SceneNode>&, const glm::mat4&)>& cb) const;
+    // Collects finished pick readbacks, queues one for the pixel under the cursor into a PBO, then
+    // blits the colour to the default framebuffer and leaves it bound.
+    void endScenePass(GLFWwindow* window);
+
+    // Also writes the stencil under the selected node, which renderOutline masks its silhouette with.
+    void renderRobotScene(ShaderProgram& robotShader);
+
+    // Draws the selected node's meshes extruded along their normals by a fixed pixel width, outside the
+    // stencilled selection. Reads the node's world and normal matrices straight from the cached pose.
+    void renderOutline(ShaderProgram& outlineShader) const;
+
+private:
+    void recreateSceneTargetsIfNeeded(int w, int h);
+    void destroySceneTargets();
+
+    void collectPickReadbacks();
+    void setHoveredPickId(unsigned int id);
+
+    glm::mat4 buildPartPose(int part, const float* angles) const;
+    void updateNormalMatrices(int begin, int end);
+    void updateNodeBounds(int begin, int end);
+    void updateSubtreeBounds();
 
 private:
     std::shared_ptr<SceneNode> rootNode;
+    std::shared_ptr<FlatScene> flatScene;
+
+    // Cached pose, indexed like flatScene nodes.
+    std::vector<int> nodePart;
+    std::vector<glm::mat4> nodePose;
+    std::vector<glm::mat4> worldTransforms;
+    std::vector<glm::mat3> normalMatrices;
+    std::vector<float> posedTheta;
+    std::vector<unsigned char> nodeDirty;
+    bool poseValid = false;
+
+    // World bounds under the cached pose: each node's own meshes, and its whole pre-order subtree.
+    std::vector<glm::vec3> nodeBoundsMin;
+    std::vector<glm::vec3> nodeBoundsMax;
+    std::vector<glm::vec3> subtreeBoundsMin;
+    std::vector<glm::vec3> subtreeBoundsMax;
+
+    // Set by beginFrame's frustum test, read by the passes.
+    std::vector<unsigned char> nodeVisible;
+    bool frustumCulling = true;
+    CullStats cullStats;
+
+    // LOD level per node, set by beginFrame for drawn nodes and kept across frames for hysteresis.
+    std::vector<unsigned char> nodeLod;
+    bool meshLods = true;
+    float lodPixelError = 1.0f;
+    LodStats lodStats;
+
+    // Whether this frame's renderRobotScene marked the selection in the stencil (not in crowd mode).
+    bool selectionStenciled = false;
 
     std::vector<float> theta;
     AnimationSystem animSystem;
@@ -79,21 +202,54 @@ private:
         double lastY = 0.0;
     } limbDrag;
 
-    struct JointPair
+    // Body part ids are resolved to node indices once in setRootNode (-1 = not in the scene).
+    int partNode[kBodyPartCount];
+
+    // Body part a click on each node selects: its own, or the nearest posed ancestor's (-1 = none).
+    std::vector<int> nodePickPart;
+
+    int selectedPart = -1;
+
+    PickMode pickMode = PickMode::IdBuffer;
+
+    // std140 mirror of the FrameData block.
+    struct FrameUniforms
     {
-        int primary = -1;
-        int secondary = -1;
+        glm::mat4 mvpMatrix = glm::mat4(1.0f);
+        glm::vec4 viewPosition = glm::vec4(0.0f);
+        glm::vec4 lightPosition = glm::vec4(0.0f);
+        glm::uvec4 pickHighlight = glm::uvec4(0);
+    } frameUniforms;
+
+    UniformBuffer frameUniformBuffer;
+
+    UniformHandle<glm::mat4> uModel;
+    UniformHandle<glm::mat3> uNormalMatrix;
+    UniformHandle<GLuint> uPickId;
+
+    UniformHandle<glm::mat4> uOutlineModel;
+    UniformHandle<glm::mat3> uOutlineNormalMatrix;
+    UniformHandle<glm::vec2> uOutlineExtent;
+
+    GLuint sceneFbo = 0;
+    GLuint sceneColorTex = 0;
+    GLuint scenePickTex = 0;
+    GLuint sceneDepth = 0;
+    int sceneW = 0;
+    int sceneH = 0;
+
+    struct PickReadback
+    {
+        GLuint pbo = 0;
+        GLsync fence = nullptr;
     };
 
-    std::unordered_map<std::string, glm::vec3> nameToPickColor;
-    std::unordered_map<unsigned int, std::string> pickIdToName;
-    std::unordered_map<std::string, JointPair> limbJointMap;
-
-    std::string selectedNodeName;
+    // Oldest pending readback is at pickReadbackHead; pickReadbackCount are in flight.
+    PickReadback pickReadbacks[kPickReadbackRing];
+    int pickReadbackHead = 0;
+    int pickReadbackCount = 0;
 
-    GLuint pickFbo = 0;
-    GLuint pickTex = 0;
-    GLuint pickDepth = 0;
-    int pickW = 0;
-    int pickH = 0;
+    unsigned int hoveredPickId = 0;
+    int hoveredPart = -1;
+    int hoveredInstance = -1;
 };
\ No newline at end of file
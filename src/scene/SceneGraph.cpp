@@ -0,0 +1,315 @@
+#include "SceneGraph.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "../util/ThreadPool.h"
+
+// Nodes per pool task when a depth level is split; smaller levels are cheaper to walk on the calling thread.
+static constexpr int kMinNodesPerTask = 512;
+
+static void flattenRecursive(const std::shared_ptr<SceneNode>& node, int parentIndex, int depth, FlatScene& out, std::vector<int>& depths)
+{
+    int index = out.getNodeCount();
+
+    out.names.push_back(node->name);
+    out.localTransforms.push_back(node->localTransform);
+    out.parentIndices.push_back(parentIndex);
+    out.subtreeEnds.push_back(index + 1);
+    depths.push_back(depth);
+
+    MeshRange range;
+    range.first = static_cast<int>(out.meshes.size());
+    range.count = static_cast<int>(node->meshes.size());
+    out.meshRanges.push_back(range);
+    out.meshes.insert(out.meshes.end(), node->meshes.begin(), node->meshes.end());
+
+    glm::vec3 boundsMin(std::numeric_limits<float>::max());
+    glm::vec3 boundsMax(-std::numeric_limits<float>::max());
+
+    for (size_t m = 0; m < node->meshes.size(); ++m)
+    {
+        out.meshBvhs.push_back(m < node->meshBvhs.size() ? node->meshBvhs[m] : nullptr);
+
+        boundsMin = glm::min(boundsMin, node->meshes[m].boundsMin);
+        boundsMax = glm::max(boundsMax, node->meshes[m].boundsMax);
+    }
+
+    out.nodeBoundsMin.push_back(boundsMin);
+    out.nodeBoundsMax.push_back(boundsMax);
+
+    int lodCount = 1;
+
+    for (size_t m = 0; m < node->meshes.size(); ++m)
+    {
+        lodCount = std::max(lodCount, node->meshes[m].lodCount);
+    }
+
+    for (int level = 0; level < GpuMesh::kMaxLods; ++level)
+    {
+        float error = 0.0f;
+
+        for (size_t m = 0; m < node->meshes.size(); ++m)
+        {
+            const GpuMesh& mesh = node->meshes[m];
+            error = std::max(error, mesh.getLodError(std::min(level, mesh.lodCount - 1)));
+        }
+
+        out.nodeLodErrors.push_back(error);
+    }
+
+    out.nodeLodCounts.push_back(lodCount);
+
+    for (size_t i = 0; i < node->children.size(); ++i)
+    {
+        flattenRecursive(node->children[i], index, depth + 1, out, depths);
+    }
+
+    out.subtreeEnds[index] = out.getNodeCount();
+}
+
+std::shared_ptr<FlatScene> sceneGraph::flatten(const std::shared_ptr<SceneNode>& root)
+{
+    if (!root)
+    {
+        return nullptr;
+    }
+
+    std::shared_ptr<FlatScene> out = std::make_shared<FlatScene>();
+    std::vector<int> depths;
+
+    flattenRecursive(root, -1, 0, *out, depths);
+
+    // Bucket nodes by depth (counting sort keeps pre-order within a level).
+    int levelCount = *std::max_element(depths.begin(), depths.end()) + 1;
+    out->levelOffsets.assign(static_cast<size_t>(levelCount) + 1, 0);
+
+    for (size_t i = 0; i < depths.size(); ++i)
+    {
+        out->levelOffsets[static_cast<size_t>(depths[i]) + 1]++;
+    }
+
+    for (int l = 0; l < levelCount; ++l)
+    {
+        out->levelOffsets[static_cast<size_t>(l) + 1] += out->levelOffsets[static_cast<size_t>(l)];
+    }
+
+    std::vector<int> cursor(out->levelOffsets.begin(), out->levelOffsets.end() - 1);
+    out->levelNodes.resize(depths.size());
+
+    for (size_t i = 0; i < depths.size(); ++i)
+    {
+        out->levelNodes[static_cast<size_t>(cursor[static_cast<size_t>(depths[i])]++)] = static_cast<int>(i);
+    }
+
+    return out;
+}
+
+static inline void computeNodeWorld(const FlatScene& scene, const glm::mat4* nodePose, glm::mat4* outWorld, int i)
+{
+    int parent = scene.parentIndices[i];
+    glm::mat4 t = (parent >= 0) ? outWorld[parent] * scene.localTransforms[i] : scene.localTransforms[i];
+
+    outWorld[i] = nodePose ? t * nodePose[i] : t;
+}
+
+void sceneGraph::computeWorldTransforms(const FlatScene& scene, const glm::mat4* nodePose, glm::mat4* outWorld)
+{
+    int count = scene.getNodeCount();
+
+    for (int i = 0; i < count; ++i)
+    {
+        computeNodeWorld(scene, nodePose, outWorld, i);
+    }
+}
+
+void sceneGraph::computeSubtreeWorldTransforms(const FlatScene& scene, const glm::mat4* nodePose, glm::mat4* outWorld, int root)
+{
+    int end = scene.subtreeEnds[root];
+
+    for (int i = root; i < end; ++i)
+    {
+        computeNodeWorld(scene, nodePose, outWorld, i);
+    }
+}
+
+void sceneGraph::computeWorldTransformsByLevel(const FlatScene& scene, const glm::mat4* nodePose, glm::mat4* outWorld, ThreadPool* pool)
+{
+    if (!pool)
+    {
+        computeWorldTransforms(scene, nodePose, outWorld);
+
+        return;
+    }
+
+    for (int l = 0; l < scene.getLevelCount(); ++l)
+    {
+        const int* levelBegin = scene.levelNodes.data() + scene.levelOffsets[l];
+        int levelSize = scene.levelOffsets[l + 1] - scene.levelOffsets[l];
+
+        // Every parent lives on the previous level, so nodes within a level are independent.
+        pool->parallelFor(levelSize, kMinNodesPerTask, [&](int begin, int end)
+        {
+            for (int k = begin; k < end; ++k)
+            {
+                computeNodeWorld(scene, nodePose, outWorld, levelBegin[k]);
+            }
+        });
+    }
+}
+
+glm::mat3 sceneGraph::computeNormalMatrix(const glm::mat4& world)
+{
+    glm::mat3 m(world);
+
+    float l0 = glm::dot(m[0], m[0]);
+    float l1 = glm::dot(m[1], m[1]);
+    float l2 = glm::dot(m[2], m[2]);
+
+    float eps = 1e-4f * std::max(l0, std::max(l1, l2));
+
+    bool sameScale = std::abs(l0 - l1) <= eps && std::abs(l0 - l2) <= eps;
+    bool orthogonal = std::abs(glm::dot(m[0], m[1])) <= eps && std::abs(glm::dot(m[0], m[2])) <= eps && std::abs(glm::dot(m[1], m[2])) <= eps;
+
+    if (sameScale && orthogonal)
+    {
+        return m;
+    }
+
+    return glm::transpose(glm::inverse(m));
+}
+
+sceneGraph::Frustum sceneGraph::extractFrustum(const glm::mat4& viewProj)
+{
+    // Gribb-Hartmann: each clip plane is row 3 plus or minus row 0/1/2 (GLM is column-major).
+    glm::vec4 r0(viewProj[0][0], viewProj[1][0], viewProj[2][0], viewProj[3][0]);
+    glm::vec4 r1(viewProj[0][1], viewProj[1][1], viewProj[2][1], viewProj[3][1]);
+    glm::vec4 r2(viewProj[0][2], viewProj[1][2], viewProj[2][2], viewProj[3][2]);
+    glm::vec4 r3(viewProj[0][3], viewProj[1][3], viewProj[2][3], viewProj[3][3]);
+
+    Frustum f;
+    f.planes[0] = r3 + r0;
+    f.planes[1] = r3 - r0;
+    f.planes[2] = r3 + r1;
+    f.planes[3] = r3 - r1;
+    f.planes[4] = r3 + r2;
+    f.planes[5] = r3 - r2;
+
+    return f;
+}
+
+void sceneGraph::transformBounds(const glm::mat4& m, const glm::vec3& localMin, const glm::vec3& localMax, glm::vec3& outMin, glm::vec3& outMax)
+{
+    // Arvo: per axis, add the smaller / larger of each column's contribution to the translation.
+    glm::vec3 lo(m[3]);
+    glm::vec3 hi(m[3]);
+
+    for (int c = 0; c < 3; ++c)
+    {
+        glm::vec3 a = glm::vec3(m[c]) * localMin[c];
+        glm::vec3 b = glm::vec3(m[c]) * localMax[c];
+
+        lo += glm::min(a, b);
+        hi += glm::max(a, b);
+    }
+
+    outMin = lo;
+    outMax = hi;
+}
+
+bool sceneGraph::isBoxOutside(const Frustum& frustum, const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+{
+    for (int p = 0; p < 6; ++p)
+    {
+        const glm::vec4& plane = frustum.planes[p];
+
+        // Corner furthest along the plane normal; if even that is behind, the whole box is.
+        glm::vec3 corner(plane.x >= 0.0f ? boundsMax.x : boundsMin.x, plane.y >= 0.0f ? boundsMax.y : boundsMin.y, plane.z >= 0.0f ? boundsMax.z : boundsMin.z);
+
+        if (glm::dot(glm::vec3(plane), corner) + plane.w < 0.0f)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+float sceneGraph::computePixelsPerUnit(const LodView& view, const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+{
+    const glm::mat4& m = view.viewProj;
+
+    // Row 3 gives clip w (view depth), row 1's length the projection's y scale.
+    glm::vec3 depthRow(m[0][3], m[1][3], m[2][3]);
+    glm::vec3 yRow(m[0][1], m[1][1], m[2][1]);
+
+    glm::vec3 centre = (boundsMin + boundsMax) * 0.5f;
+    float radius = glm::length(boundsMax - boundsMin) * 0.5f;
+
+    float nearest = glm::dot(depthRow, centre) + m[3][3] - radius * glm::length(depthRow);
+
+    if (nearest <= 1e-4f)
+    {
+        return std::numeric_limits<float>::max();
+    }
+
+    return glm::length(yRow) * 0.5f * view.viewportHeight / nearest;
+}
+
+float sceneGraph::getMaxScale(const glm::mat4& m)
+{
+    float l0 = glm::dot(glm::vec3(m[0]), glm::vec3(m[0]));
+    float l1 = glm::dot(glm::vec3(m[1]), glm::vec3(m[1]));
+    float l2 = glm::dot(glm::vec3(m[2]), glm::vec3(m[2]));
+
+    return std::sqrt(std::max(l0, std::max(l1, l2)));
+}
+
+int sceneGraph::selectLod(const float* levelErrors, int levelCount, float pixelsPerUnit, float maxPixelError, int currentLevel)
+{
+    auto coarsestWithin = [&](float limit)
+    {
+        int level = 0;
+
+        while (level + 1 < levelCount && levelErrors[level + 1] * pixelsPerUnit <= limit)
+        {
+            ++level;
+        }
+
+        return level;
+    };
+
+    int level = coarsestWithin(maxPixelError);
+
+    if (level > currentLevel)
+    {
+        level = std::max(currentLevel, coarsestWithin(maxPixelError * kLodHysteresis));
+    }
+
+    return level;
+}
+
+unsigned int sceneGraph::encodePickId(int instance, int node)
+{
+    if (node < 0 || node >= kPickMaxNodes || instance < 0 || instance > 0xFFFF)
+    {
+        return 0;
+    }
+
+    return (static_cast<unsigned int>(instance) << 16) | static_cast<unsigned int>(node + 1);
+}
+
+bool sceneGraph::decodePickId(unsigned int id, int& outInstance, int& outNode)
+{
+    if ((id & 0xFFFFu) == 0)
+    {
+        return false;
+    }
+
+    outInstance = static_cast<int>(id >> 16);
+    outNode = static_cast<int>(id & 0xFFFFu) - 1;
+
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <memory>
+#include <glm.hpp>
+
+#include "SceneTypes.h"
+
+class ThreadPool;
+
+namespace sceneGraph
+{
+    std::shared_ptr<FlatScene> flatten(const std::shared_ptr<SceneNode>& root);
+
+    // world[i] = world[parent[i]] * local[i] * nodePose[i]; nodePose may be null (no pose).
+    void computeWorldTransforms(const FlatScene& scene, const glm::mat4* nodePose, glm::mat4* outWorld);
+
+    // Recomputes only the subtree rooted at root; the parent's world transform must already be current.
+    void computeSubtreeWorldTransforms(const FlatScene& scene, const glm::mat4* nodePose, glm::mat4* outWorld, int root);
+
+    // Same result as computeWorldTransforms, with each depth level split across the pool; a null pool
+    // runs serially. Call from the pool's owning thread.
+    void computeWorldTransformsByLevel(const FlatScene& scene, const glm::mat4* nodePose, glm::mat4* outWorld, ThreadPool* pool);
+
+    // Normal matrix for a world transform; rotation + uniform scale skips the inverse (the shader renormalises).
+    glm::mat3 computeNormalMatrix(const glm::mat4& world);
+
+    // Clip planes (xyz = inward normal, w = offset; not normalised) of a view-projection matrix.
+    struct Frustum
+    {
+        glm::vec4 planes[6];
+    };
+
+    Frustum extractFrustum(const glm::mat4& viewProj);
+
+    // Box enclosing the local box [localMin, localMax] under the affine transform m.
+    void transformBounds(const glm::mat4& m, const glm::vec3& localMin, const glm::vec3& localMax, glm::vec3& outMin, glm::vec3& outMax);
+
+    // Conservative: true only when the box lies entirely behind one plane. Empty boxes (min > max) are outside.
+    bool isBoxOutside(const Frustum& frustum, const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+
+    // Screen-space LOD selection under a perspective view-projection.
+    struct LodView
+    {
+        glm::mat4 viewProj = glm::mat4(1.0f);
+        float viewportHeight = 0.0f;
+
+        // A level may be drawn while its error, projected at the object's distance, stays within this.
+        float maxPixelError = 1.0f;
+    };
+
+    // Moving to a coarser level than the current one needs this much headroom under maxPixelError,
+    // so an object resting near a threshold does not flicker between levels.
+    static constexpr float kLodHysteresis = 0.75f;
+
+    // Screen pixels per world unit at the nearest point of the box's bounding sphere; infinite when the
+    // camera is inside it.
+    float computePixelsPerUnit(const LodView& view, const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+
+    // Largest axis scale of the upper 3x3, to bring node-local lengths into world units.
+    float getMaxScale(const glm::mat4& m);
+
+    // Coarsest of levelCount levels whose error (world units, non-decreasing with level) projects within
+    // maxPixelError, with kLodHysteresis applied when coarsening from currentLevel.
+    int selectLod(const float* levelErrors, int levelCount, float pixelsPerUnit, float maxPixelError, int currentLevel);
+
+    // ID written to the scene pass's pick attachment: 0 = background, otherwise (instance << 16) | (node + 1).
+    // Nodes past the 16-bit range encode as 0 (not pickable).
+    static constexpr int kPickMaxNodes = 0xFFFF;
+
+    unsigned int encodePickId(int instance, int node);
+    bool decodePickId(unsigned int id, int& outInstance, int& outNode);
+}
\ No newline at end of file
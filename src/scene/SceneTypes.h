@@ -6,8 +6,26 @@
 #include <glad/glad.h>
 #include <glm.hpp>
 
+class MeshBvh;
+
+// A simplified version of a mesh: another index range over the mesh's own vertices, stored after its
+// full-detail indices.
+struct GpuMeshLod
+{
+    GLsizei indexCount = 0;
+
+    // In indices, relative to GpuMesh::indexOffset.
+    GLsizei firstIndex = 0;
+
+    // Largest simplification error, in mesh-local units; never smaller than the previous level's.
+    float error = 0.0f;
+};
+
 struct GpuMesh
 {
+    // Level 0 plus up to kMaxLods - 1 simplified levels.
+    static constexpr int kMaxLods = 4;
+
     GLuint vao = 0;
     GLuint vboPos = 0;
     GLuint vboNor = 0;
@@ -16,6 +34,46 @@ struct GpuMesh
 
     GLsizei indexCount = 0;
     GLuint textureId = 0;
+
+    // Draw parameters for glDrawElementsBaseVertex. Arena meshes share the arena's VAO and buffers.
+    GLenum indexType = GL_UNSIGNED_INT;
+    size_t indexOffset = 0;
+    GLint baseVertex = 0;
+    bool inArena = false;
+
+    // Mesh-local AABB of the vertex positions, computed at load.
+    glm::vec3 boundsMin = glm::vec3(0.0f);
+    glm::vec3 boundsMax = glm::vec3(0.0f);
+
+    // Level 0 is the full mesh (indexCount at indexOffset); level L > 0 is lods[L - 1].
+    int lodCount = 1;
+    GpuMeshLod lods[kMaxLods - 1];
+
+    GLsizei getLodIndexCount(int level) const
+    {
+        return level <= 0 ? indexCount : lods[level - 1].indexCount;
+    }
+
+    size_t getLodIndexOffset(int level) const
+    {
+        return level <= 0 ? indexOffset : indexOffset + static_cast<size_t>(lods[level - 1].firstIndex) * (indexType == GL_UNSIGNED_SHORT ? 2 : 4);
+    }
+
+    float getLodError(int level) const
+    {
+        return level <= 0 ? 0.0f : lods[level - 1].error;
+    }
+};
+
+// One interleaved vertex buffer + one index buffer holding every primitive of a model.
+struct GpuMeshArena
+{
+    GLuint vao = 0;
+    GLuint vbo = 0;
+    GLuint ebo = 0;
+
+    size_t vertexCount = 0;
+    size_t indexBytes = 0;
 };
 
 struct SceneNode
@@ -24,5 +82,50 @@ struct SceneNode
     glm::mat4 localTransform = glm::mat4(1.0f);
 
     std::vector<GpuMesh> meshes;
+
+    // CPU triangles for ray picking, parallel to meshes; empty when the loader was asked not to keep them.
+    std::vector<std::shared_ptr<const MeshBvh>> meshBvhs;
+
     std::vector<std::shared_ptr<SceneNode>> children;
+};
+
+struct MeshRange
+{
+    int first = 0;
+    int count = 0;
+};
+
+// Flattened copy of a SceneNode tree in depth-first pre-order, so every parent sits before its children
+// and a node's subtree is the contiguous range [i, subtreeEnds[i]).
+struct FlatScene
+{
+    std::vector<std::string> names;
+    std::vector<glm::mat4> localTransforms;
+    std::vector<int> parentIndices;
+    std::vector<int> subtreeEnds;
+    std::vector<MeshRange> meshRanges;
+    std::vector<GpuMesh> meshes;
+    GpuMeshArena arena;
+
+    // Textures created for this model (meshes reference them by id); deleted with the arena.
+    std::vector<GLuint> textures;
+
+    // Parallel to meshes when the model kept CPU triangles (null entries otherwise).
+    std::vector<std::shared_ptr<const MeshBvh>> meshBvhs;
+
+    // Node-local union of each node's mesh bounds; min > max for nodes without meshes.
+    std::vector<glm::vec3> nodeBoundsMin;
+    std::vector<glm::vec3> nodeBoundsMax;
+
+    // Per node and LOD level (node-major, GpuMesh::kMaxLods each): the largest error of the node's
+    // meshes at that level, node-local units. Meshes with fewer levels stay at their coarsest one.
+    std::vector<float> nodeLodErrors;
+    std::vector<int> nodeLodCounts;
+
+    // Node indices grouped by depth: level L is levelNodes[levelOffsets[L] .. levelOffsets[L + 1]).
+    std::vector<int> levelNodes;
+    std::vector<int> levelOffsets;
+
+    int getNodeCount() const { return static_cast<int>(names.size()); }
+    int getLevelCount() const { return levelOffsets.empty() ? 0 : static_cast<int>(levelOffsets.size()) - 1; }
 };
\ No newline at end of file
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstdint>
+
+// Counts calls to the global operator new so --check-allocations can verify that a steady-state frame
+// does not touch the C++ heap. Driver and C allocations are not seen. The operators are only replaced
+// in builds with HM_COUNT_ALLOCATIONS defined (msbuild /p:CountAllocations=true); elsewhere the count
+// stays at zero.
+namespace allocationCounter
+{
+    bool isEnabled();
+    uint64_t getCount();
+}
\ No newline at end of file
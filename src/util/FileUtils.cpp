@@ -36,4 +36,18 @@ bool fileUtils::readFileToBytes(const std::string& path, std::vector<unsigned ch
     in.read(reinterpret_cast<char*>(outBytes.data()), size);
 
     return true;
+}
+
+bool fileUtils::writeBytesToFile(const std::string& path, const std::vector<unsigned char>& bytes)
+{
+    std::ofstream out(path, std::ios::out | std::ios::binary | std::ios::trunc);
+
+    if (!out.is_open())
+    {
+        return false;
+    }
+
+    out.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+
+    return out.good();
 }
\ No newline at end of file
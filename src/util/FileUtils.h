@@ -7,4 +7,7 @@ namespace fileUtils
 {
     bool readFileToString(const std::string& path, std::string& outText);
     bool readFileToBytes(const std::string& path, std::vector<unsigned char>& outBytes);
+
+    // Creates or truncates path; false when it cannot be opened or the write fails.
+    bool writeBytesToFile(const std::string& path, const std::vector<unsigned char>& bytes);
 }
\ No newline at end of file
@@ -0,0 +1,64 @@
+#include "FrameArena.h"
+
+#include <algorithm>
+#include <cstdint>
+
+static size_t alignUp(size_t value, size_t alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+FrameArena::FrameArena(size_t initialBytes)
+{
+    capacity = initialBytes;
+    block = std::make_unique<unsigned char[]>(capacity);
+    overflow.reserve(16);
+}
+
+void FrameArena::reset()
+{
+    if (!overflow.empty())
+    {
+        // Last frame did not fit: grow once so the same workload fits next time.
+        capacity = alignUp(frameBytes + frameBytes / 4, 4096);
+        block = std::make_unique<unsigned char[]>(capacity);
+
+        overflow.clear();
+    }
+
+    offset = 0;
+    frameBytes = 0;
+}
+
+void* FrameArena::allocateBytes(size_t bytes, size_t alignment)
+{
+    uintptr_t base = reinterpret_cast<uintptr_t>(block.get());
+    size_t start = alignUp(base + offset, alignment) - base;
+
+    if (start + bytes <= capacity)
+    {
+        frameBytes += (start - offset) + bytes;
+        offset = start + bytes;
+        peakBytes = std::max(peakBytes, frameBytes);
+
+        return block.get() + start;
+    }
+
+    overflow.push_back(std::make_unique<unsigned char[]>(bytes + alignment));
+    frameBytes += bytes + alignment;
+    peakBytes = std::max(peakBytes, frameBytes);
+
+    uintptr_t spill = reinterpret_cast<uintptr_t>(overflow.back().get());
+
+    return reinterpret_cast<void*>(alignUp(spill, alignment));
+}
+
+size_t FrameArena::getCapacity() const
+{
+    return capacity;
+}
+
+size_t FrameArena::getPeakBytes() const
+{
+    return peakBytes;
+}
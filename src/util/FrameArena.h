@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+// Linear allocator for data that lives for one frame. reset() at the start of a frame rewinds it;
+// if the previous frame spilled into overflow blocks, the main block is regrown to that peak so a
+// steady-state frame allocates nothing.
+class FrameArena
+{
+public:
+    explicit FrameArena(size_t initialBytes = 1 << 20);
+
+    void reset();
+
+    // Uninitialised storage for count objects; only for trivially destructible types.
+    template <typename T>
+    T* allocate(size_t count)
+    {
+        static_assert(std::is_trivially_destructible<T>::value, "FrameArena never runs destructors");
+
+        return static_cast<T*>(allocateBytes(count * sizeof(T), alignof(T)));
+    }
+
+    size_t getCapacity() const;
+    size_t getPeakBytes() const;
+
+private:
+    void* allocateBytes(size_t bytes, size_t alignment);
+
+private:
+    std::unique_ptr<unsigned char[]> block;
+    size_t capacity = 0;
+    size_t offset = 0;
+
+    // Spill blocks for the current frame; released on reset once the main block has grown.
+    std::vector<std::unique_ptr<unsigned char[]>> overflow;
+
+    size_t frameBytes = 0;
+    size_t peakBytes = 0;
+};
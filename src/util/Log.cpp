@@ -0,0 +1,37 @@
+#include "Log.h"
+
+#include <cstdarg>
+#include <cstdio>
+#include <iostream>
+#include <vector>
+
+void logging::print(const char* format, ...)
+{
+    char line[512];
+
+    va_list args;
+    va_start(args, format);
+    int length = std::vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+
+    if (length < 0)
+    {
+        return;
+    }
+
+    if (static_cast<size_t>(length) < sizeof(line))
+    {
+        std::cout << line;
+
+        return;
+    }
+
+    // Rare long lines (paths) are formatted again into a buffer of the right size.
+    std::vector<char> longLine(static_cast<size_t>(length) + 1);
+
+    va_start(args, format);
+    std::vsnprintf(longLine.data(), longLine.size(), format, args);
+    va_end(args);
+
+    std::cout << longLine.data();
+}
\ No newline at end of file
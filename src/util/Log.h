@@ -0,0 +1,7 @@
+#pragma once
+
+// Console output for the app and its tools. Messages are printf-style and go to stdout.
+namespace logging
+{
+    void print(const char* format, ...);
+}
\ No newline at end of file
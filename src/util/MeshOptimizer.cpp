@@ -0,0 +1,676 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+#include <glm.hpp>
+
+// Forsyth's "Linear-Speed Vertex Cache Optimisation": LRU cache model and scoring constants.
+static constexpr int kForsythCacheSize = 32;
+static constexpr int kForsythMaxValence = 32;
+static constexpr float kCacheDecayPower = 1.5f;
+static constexpr float kLastTriangleScore = 0.75f;
+static constexpr float kValenceBoostScale = 2.0f;
+static constexpr float kValenceBoostPower = 0.5f;
+
+// Overdraw clusters are only reordered when the cache cost stays within this factor of the Forsyth order.
+static constexpr double kOverdrawAcmrThreshold = 1.05;
+
+// Resolution of each axis view in the overdraw measurement.
+static constexpr int kOverdrawGrid = 256;
+
+void meshOptimizer::Stats::add(const Stats& other)
+{
+    verticesBefore += other.verticesBefore;
+    verticesAfter += other.verticesAfter;
+    trianglesBefore += other.trianglesBefore;
+    trianglesAfter += other.trianglesAfter;
+    transformsBefore += other.transformsBefore;
+    transformsAfter += other.transformsAfter;
+    shadedBefore += other.shadedBefore;
+    shadedAfter += other.shadedAfter;
+    coveredBefore += other.coveredBefore;
+    coveredAfter += other.coveredAfter;
+}
+
+static double ratio(uint64_t a, uint64_t b)
+{
+    return b > 0 ? static_cast<double>(a) / static_cast<double>(b) : 0.0;
+}
+
+double meshOptimizer::Stats::getAcmrBefore() const { return ratio(transformsBefore, trianglesBefore); }
+double meshOptimizer::Stats::getAcmrAfter() const { return ratio(transformsAfter, trianglesAfter); }
+double meshOptimizer::Stats::getOverdrawBefore() const { return ratio(shadedBefore, coveredBefore); }
+double meshOptimizer::Stats::getOverdrawAfter() const { return ratio(shadedAfter, coveredAfter); }
+
+uint64_t meshOptimizer::simulateFifoCache(const unsigned int* indices, size_t indexCount, size_t vertexCount, int cacheSize)
+{
+    // A vertex is in the cache while fewer than cacheSize misses happened since it was loaded.
+    std::vector<uint64_t> loadedAt(vertexCount, 0);
+    uint64_t misses = 0;
+
+    for (size_t i = 0; i < indexCount; ++i)
+    {
+        unsigned int v = indices[i];
+
+        if (loadedAt[v] == 0 || misses - (loadedAt[v] - 1) >= static_cast<uint64_t>(cacheSize))
+        {
+            ++misses;
+            loadedAt[v] = misses;
+        }
+    }
+
+    return misses;
+}
+
+// Orthographic views down +-x, +-y, +-z of the mesh's bounding box; counts fragments that pass a
+// less-than depth test and the pixels left covered.
+void meshOptimizer::measureOverdraw(const float* positions, size_t vertexCount, const unsigned int* indices, size_t indexCount, uint64_t& outShaded, uint64_t& outCovered)
+{
+    outShaded = 0;
+    outCovered = 0;
+
+    if (vertexCount == 0 || indexCount < 3)
+    {
+        return;
+    }
+
+    glm::vec3 boundsMin(positions[0], positions[1], positions[2]);
+    glm::vec3 boundsMax = boundsMin;
+
+    for (size_t v = 1; v < vertexCount; ++v)
+    {
+        glm::vec3 p(positions[v * 3 + 0], positions[v * 3 + 1], positions[v * 3 + 2]);
+        boundsMin = glm::min(boundsMin, p);
+        boundsMax = glm::max(boundsMax, p);
+    }
+
+    glm::vec3 extent = boundsMax - boundsMin;
+    float scale = static_cast<float>(kOverdrawGrid) / std::max(std::max(extent.x, extent.y), std::max(extent.z, 1e-6f));
+
+    std::vector<float> depth(static_cast<size_t>(kOverdrawGrid) * kOverdrawGrid);
+
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        // (u, v, axis) is right-handed, so a counter-clockwise face seen from +axis has positive area.
+        int u = (axis + 1) % 3;
+        int w = (axis + 2) % 3;
+
+        for (int side = -1; side <= 1; side += 2)
+        {
+            std::fill(depth.begin(), depth.end(), std::numeric_limits<float>::max());
+
+            for (size_t t = 0; t + 2 < indexCount; t += 3)
+            {
+                glm::vec3 s[3];
+
+                for (int k = 0; k < 3; ++k)
+                {
+                    const float* p = positions + static_cast<size_t>(indices[t + k]) * 3;
+                    s[k] = glm::vec3((p[u] - boundsMin[u]) * scale, (p[w] - boundsMin[w]) * scale, -side * p[axis]);
+                }
+
+                float area = (s[1].x - s[0].x) * (s[2].y - s[0].y) - (s[1].y - s[0].y) * (s[2].x - s[0].x);
+
+                if (area * side <= 0.0f)
+                {
+                    continue;
+                }
+
+                if (area < 0.0f)
+                {
+                    std::swap(s[1], s[2]);
+                    area = -area;
+                }
+
+                int x0 = std::max(0, static_cast<int>(std::floor(std::min(s[0].x, std::min(s[1].x, s[2].x)))));
+                int x1 = std::min(kOverdrawGrid - 1, static_cast<int>(std::ceil(std::max(s[0].x, std::max(s[1].x, s[2].x)))));
+                int y0 = std::max(0, static_cast<int>(std::floor(std::min(s[0].y, std::min(s[1].y, s[2].y)))));
+                int y1 = std::min(kOverdrawGrid - 1, static_cast<int>(std::ceil(std::max(s[0].y, std::max(s[1].y, s[2].y)))));
+
+                float invArea = 1.0f / area;
+
+                for (int y = y0; y <= y1; ++y)
+                {
+                    for (int x = x0; x <= x1; ++x)
+                    {
+                        float px = x + 0.5f;
+                        float py = y + 0.5f;
+
+                        float b0 = (s[2].x - s[1].x) * (py - s[1].y) - (s[2].y - s[1].y) * (px - s[1].x);
+                        float b1 = (s[0].x - s[2].x) * (py - s[2].y) - (s[0].y - s[2].y) * (px - s[2].x);
+                        float b2 = (s[1].x - s[0].x) * (py - s[0].y) - (s[1].y - s[0].y) * (px - s[0].x);
+
+                        if (b0 < 0.0f || b1 < 0.0f || b2 < 0.0f)
+                        {
+                            continue;
+                        }
+
+                        float z = (b0 * s[0].z + b1 * s[1].z + b2 * s[2].z) * invArea;
+                        float& stored = depth[static_cast<size_t>(y) * kOverdrawGrid + x];
+
+                        if (z < stored)
+                        {
+                            stored = z;
+                            ++outShaded;
+                        }
+                    }
+                }
+            }
+
+            for (float z : depth)
+            {
+                outCovered += (z != std::numeric_limits<float>::max()) ? 1 : 0;
+            }
+        }
+    }
+}
+
+// Bit-exact vertex key over all attributes.
+struct VertexKey
+{
+    float values[8];
+
+    bool operator==(const VertexKey& other) const
+    {
+        return std::memcmp(values, other.values, sizeof(values)) == 0;
+    }
+};
+
+struct VertexKeyHash
+{
+    size_t operator()(const VertexKey& key) const
+    {
+        uint32_t words[8];
+        std::memcpy(words, key.values, sizeof(words));
+
+        uint64_t h = 0xCBF29CE484222325ull;
+
+        for (uint32_t word : words)
+        {
+            h = (h ^ word) * 0x100000001B3ull;
+        }
+
+        return static_cast<size_t>(h ^ (h >> 32));
+    }
+};
+
+// Returns the welded vertex count; remap[old] is the new index.
+static size_t weldVertices(const std::vector<float>& positions, const std::vector<float>& normals, const std::vector<float>& uvs, std::vector<unsigned int>& remap)
+{
+    size_t vertexCount = positions.size() / 3;
+
+    std::unordered_map<VertexKey, unsigned int, VertexKeyHash> unique;
+    unique.reserve(vertexCount);
+
+    remap.resize(vertexCount);
+
+    for (size_t v = 0; v < vertexCount; ++v)
+    {
+        VertexKey key;
+        std::memcpy(key.values + 0, &positions[v * 3], 3 * sizeof(float));
+        std::memcpy(key.values + 3, &normals[v * 3], 3 * sizeof(float));
+        std::memcpy(key.values + 6, &uvs[v * 2], 2 * sizeof(float));
+
+        auto it = unique.emplace(key, static_cast<unsigned int>(unique.size())).first;
+        remap[v] = it->second;
+    }
+
+    return unique.size();
+}
+
+static float forsythVertexScore(int cachePosition, int valence)
+{
+    if (valence == 0)
+    {
+        return -1.0f;
+    }
+
+    float score = 0.0f;
+
+    if (cachePosition >= 0)
+    {
+        // The last triangle's vertices get a fixed score so the next one does not simply reuse them all.
+        if (cachePosition < 3)
+        {
+            score = kLastTriangleScore;
+        }
+        else
+        {
+            float scaler = 1.0f / (kForsythCacheSize - 3);
+            score = std::pow(1.0f - (cachePosition - 3) * scaler, kCacheDecayPower);
+        }
+    }
+
+    // Favour vertices with few triangles left, so they get finished and leave the cache.
+    score += kValenceBoostScale * std::pow(static_cast<float>(valence), -kValenceBoostPower);
+
+    return score;
+}
+
+void meshOptimizer::optimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount)
+{
+    size_t triangleCount = indices.size() / 3;
+
+    if (triangleCount == 0)
+    {
+        return;
+    }
+
+    static const struct ScoreTable
+    {
+        float scores[kForsythCacheSize + 1][kForsythMaxValence + 1];
+
+        ScoreTable()
+        {
+            for (int c = 0; c <= kForsythCacheSize; ++c)
+            {
+                for (int v = 0; v <= kForsythMaxValence; ++v)
+                {
+                    scores[c][v] = forsythVertexScore(c == kForsythCacheSize ? -1 : c, v);
+                }
+            }
+        }
+    } table;
+
+    auto score = [](int cachePosition, int valence)
+    {
+        return table.scores[cachePosition < 0 ? kForsythCacheSize : cachePosition][std::min(valence, kForsythMaxValence)];
+    };
+
+    // Vertex -> triangle adjacency; a vertex's live triangles are the first valence[v] entries.
+    std::vector<int> valence(vertexCount, 0);
+
+    for (unsigned int v : indices)
+    {
+        ++valence[v];
+    }
+
+    std::vector<size_t> adjacencyOffsets(vertexCount + 1, 0);
+
+    for (size_t v = 0; v < vertexCount; ++v)
+    {
+        adjacencyOffsets[v + 1] = adjacencyOffsets[v] + valence[v];
+    }
+
+    std::vector<unsigned int> adjacency(indices.size());
+    std::vector<size_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+
+    for (size_t t = 0; t < triangleCount; ++t)
+    {
+        for (int k = 0; k < 3; ++k)
+        {
+            adjacency[fill[indices[t * 3 + k]]++] = static_cast<unsigned int>(t);
+        }
+    }
+
+    std::vector<int> cachePosition(vertexCount, -1);
+    std::vector<float> vertexScore(vertexCount);
+
+    for (size_t v = 0; v < vertexCount; ++v)
+    {
+        vertexScore[v] = score(-1, valence[v]);
+    }
+
+    std::vector<unsigned char> emitted(triangleCount, 0);
+
+    std::vector<unsigned int> output;
+    output.reserve(indices.size());
+
+    unsigned int cache[kForsythCacheSize + 3];
+    int cacheCount = 0;
+
+    size_t scanCursor = 0;
+    int64_t best = -1;
+
+    for (size_t emittedCount = 0; emittedCount < triangleCount; ++emittedCount)
+    {
+        if (best < 0)
+        {
+            // Nothing useful in the cache: continue with the next triangle in input order.
+            while (emitted[scanCursor])
+            {
+                ++scanCursor;
+            }
+
+            best = static_cast<int64_t>(scanCursor);
+        }
+
+        size_t t = static_cast<size_t>(best);
+        emitted[t] = 1;
+
+        unsigned int tri[3] = { indices[t * 3], indices[t * 3 + 1], indices[t * 3 + 2] };
+
+        output.insert(output.end(), tri, tri + 3);
+
+        // Retire the triangle from its vertices' live lists.
+        for (unsigned int v : tri)
+        {
+            unsigned int* begin = adjacency.data() + adjacencyOffsets[v];
+            unsigned int* end = begin + valence[v];
+            unsigned int* it = std::find(begin, end, static_cast<unsigned int>(t));
+
+            if (it != end)
+            {
+                std::swap(*it, *(end - 1));
+                --valence[v];
+            }
+        }
+
+        // New LRU order: the triangle's vertices first, then the old entries that are not among them.
+        unsigned int next[kForsythCacheSize + 3];
+        int nextCount = 0;
+
+        for (unsigned int v : tri)
+        {
+            next[nextCount++] = v;
+        }
+
+        for (int c = 0; c < cacheCount; ++c)
+        {
+            unsigned int v = cache[c];
+
+            if (v != tri[0] && v != tri[1] && v != tri[2])
+            {
+                next[nextCount++] = v;
+            }
+        }
+
+        for (int c = 0; c < nextCount; ++c)
+        {
+            unsigned int v = next[c];
+            cachePosition[v] = (c < kForsythCacheSize) ? c : -1;
+            vertexScore[v] = score(cachePosition[v], valence[v]);
+        }
+
+        cacheCount = std::min(nextCount, kForsythCacheSize);
+
+        for (int c = 0; c < cacheCount; ++c)
+        {
+            cache[c] = next[c];
+        }
+
+        // Rescore the live triangles of every vertex whose score moved and pick the best of them.
+        best = -1;
+        float bestScore = -std::numeric_limits<float>::max();
+
+        for (int c = 0; c < nextCount; ++c)
+        {
+            unsigned int v = next[c];
+
+            for (int a = 0; a < valence[v]; ++a)
+            {
+                unsigned int u = adjacency[adjacencyOffsets[v] + a];
+                float s = vertexScore[indices[u * 3]] + vertexScore[indices[u * 3 + 1]] + vertexScore[indices[u * 3 + 2]];
+
+                if (s > bestScore)
+                {
+                    bestScore = s;
+                    best = u;
+                }
+            }
+        }
+    }
+
+    indices.swap(output);
+}
+
+// Splits the cache-ordered list into clusters where a triangle misses on all three vertices, then puts
+// clusters facing away from the mesh centre first, since they tend to occlude the rest (after Sander,
+// Nehab and Barczak, "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw").
+static void optimizeOverdraw(std::vector<unsigned int>& indices, const std::vector<float>& positions, size_t vertexCount)
+{
+    size_t triangleCount = indices.size() / 3;
+
+    if (triangleCount < 2)
+    {
+        return;
+    }
+
+    std::vector<size_t> clusterStarts;
+    std::vector<uint64_t> loadedAt(vertexCount, 0);
+    uint64_t misses = 0;
+
+    for (size_t t = 0; t < triangleCount; ++t)
+    {
+        int triangleMisses = 0;
+
+        for (int k = 0; k < 3; ++k)
+        {
+            unsigned int v = indices[t * 3 + k];
+
+            if (loadedAt[v] == 0 || misses - (loadedAt[v] - 1) >= static_cast<uint64_t>(meshOptimizer::kAcmrCacheSize))
+            {
+                ++misses;
+                loadedAt[v] = misses;
+                ++triangleMisses;
+            }
+        }
+
+        if (t == 0 || triangleMisses == 3)
+        {
+            clusterStarts.push_back(t);
+        }
+    }
+
+    if (clusterStarts.size() < 2)
+    {
+        return;
+    }
+
+    clusterStarts.push_back(triangleCount);
+
+    auto position = [&](unsigned int v)
+    {
+        return glm::vec3(positions[v * 3 + 0], positions[v * 3 + 1], positions[v * 3 + 2]);
+    };
+
+    glm::dvec3 meshCentroid(0.0);
+    double meshArea = 0.0;
+
+    size_t clusterCount = clusterStarts.size() - 1;
+    std::vector<glm::vec3> clusterCentroid(clusterCount);
+    std::vector<glm::vec3> clusterNormal(clusterCount);
+
+    for (size_t c = 0; c < clusterCount; ++c)
+    {
+        glm::dvec3 centroid(0.0);
+        glm::dvec3 normal(0.0);
+        double area = 0.0;
+
+        for (size_t t = clusterStarts[c]; t < clusterStarts[c + 1]; ++t)
+        {
+            glm::vec3 a = position(indices[t * 3]);
+            glm::vec3 b = position(indices[t * 3 + 1]);
+            glm::vec3 d = position(indices[t * 3 + 2]);
+
+            glm::vec3 n = glm::cross(b - a, d - a);
+            double triArea = glm::length(n) * 0.5;
+
+            centroid += glm::dvec3((a + b + d) / 3.0f) * triArea;
+            normal += glm::dvec3(n);
+            area += triArea;
+        }
+
+        clusterCentroid[c] = glm::vec3(area > 0.0 ? centroid / area : centroid);
+        clusterNormal[c] = glm::length(normal) > 0.0 ? glm::vec3(glm::normalize(normal)) : glm::vec3(0.0f);
+
+        meshCentroid += centroid;
+        meshArea += area;
+    }
+
+    glm::vec3 centre = glm::vec3(meshArea > 0.0 ? meshCentroid / meshArea : meshCentroid);
+
+    std::vector<float> sortKey(clusterCount);
+
+    for (size_t c = 0; c < clusterCount; ++c)
+    {
+        sortKey[c] = glm::dot(clusterCentroid[c] - centre, clusterNormal[c]);
+    }
+
+    std::vector<size_t> order(clusterCount);
+
+    for (size_t c = 0; c < clusterCount; ++c)
+    {
+        order[c] = c;
+    }
+
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b)
+    {
+        return sortKey[a] > sortKey[b];
+    });
+
+    std::vector<unsigned int> sorted;
+    sorted.reserve(indices.size());
+
+    for (size_t c : order)
+    {
+        sorted.insert(sorted.end(), indices.begin() + clusterStarts[c] * 3, indices.begin() + clusterStarts[c + 1] * 3);
+    }
+
+    uint64_t before = meshOptimizer::simulateFifoCache(indices.data(), indices.size(), vertexCount, meshOptimizer::kAcmrCacheSize);
+    uint64_t after = meshOptimizer::simulateFifoCache(sorted.data(), sorted.size(), vertexCount, meshOptimizer::kAcmrCacheSize);
+
+    if (static_cast<double>(after) <= static_cast<double>(before) * kOverdrawAcmrThreshold)
+    {
+        indices.swap(sorted);
+    }
+}
+
+template <int Components>
+static void remapAttribute(std::vector<float>& values, const std::vector<unsigned int>& remap, size_t newCount)
+{
+    std::vector<float> out(newCount * Components);
+
+    for (size_t v = 0; v < remap.size(); ++v)
+    {
+        if (remap[v] != ~0u)
+        {
+            std::memcpy(&out[static_cast<size_t>(remap[v]) * Components], &values[v * Components], Components * sizeof(float));
+        }
+    }
+
+    values.swap(out);
+}
+
+void meshOptimizer::optimize(std::vector<float>& positions, std::vector<float>& normals, std::vector<float>& uvs, std::vector<unsigned int>& indices, Stats* outStats)
+{
+    size_t vertexCount = positions.size() / 3;
+
+    if (normals.size() != vertexCount * 3 || uvs.size() != vertexCount * 2)
+    {
+        return;
+    }
+
+    for (unsigned int index : indices)
+    {
+        if (index >= vertexCount)
+        {
+            return;
+        }
+    }
+
+    indices.resize(indices.size() / 3 * 3);
+
+    // The cache simulation and six-view rasterisation cost more than the optimisation itself, so they
+    // only run when the caller asked for stats.
+    Stats stats;
+
+    if (outStats)
+    {
+        stats.verticesBefore = vertexCount;
+        stats.trianglesBefore = indices.size() / 3;
+        stats.transformsBefore = simulateFifoCache(indices.data(), indices.size(), vertexCount, kAcmrCacheSize);
+        measureOverdraw(positions.data(), vertexCount, indices.data(), indices.size(), stats.shadedBefore, stats.coveredBefore);
+    }
+
+    // Weld, then compact the attributes to the welded set.
+    std::vector<unsigned int> remap;
+    size_t weldedCount = weldVertices(positions, normals, uvs, remap);
+
+    std::vector<unsigned int> firstOf(weldedCount, ~0u);
+
+    for (size_t v = 0; v < vertexCount; ++v)
+    {
+        if (firstOf[remap[v]] == ~0u)
+        {
+            firstOf[remap[v]] = static_cast<unsigned int>(v);
+        }
+    }
+
+    std::vector<unsigned int> keep(vertexCount, ~0u);
+
+    for (size_t w = 0; w < weldedCount; ++w)
+    {
+        keep[firstOf[w]] = static_cast<unsigned int>(w);
+    }
+
+    remapAttribute<3>(positions, keep, weldedCount);
+    remapAttribute<3>(normals, keep, weldedCount);
+    remapAttribute<2>(uvs, keep, weldedCount);
+
+    // Drop triangles that share an index after welding or have zero area.
+    size_t write = 0;
+
+    for (size_t t = 0; t + 2 < indices.size(); t += 3)
+    {
+        unsigned int a = remap[indices[t]];
+        unsigned int b = remap[indices[t + 1]];
+        unsigned int c = remap[indices[t + 2]];
+
+        if (a == b || b == c || a == c)
+        {
+            continue;
+        }
+
+        glm::vec3 pa(positions[a * 3 + 0], positions[a * 3 + 1], positions[a * 3 + 2]);
+        glm::vec3 pb(positions[b * 3 + 0], positions[b * 3 + 1], positions[b * 3 + 2]);
+        glm::vec3 pc(positions[c * 3 + 0], positions[c * 3 + 1], positions[c * 3 + 2]);
+
+        glm::vec3 n = glm::cross(pb - pa, pc - pa);
+
+        if (n.x == 0.0f && n.y == 0.0f && n.z == 0.0f)
+        {
+            continue;
+        }
+
+        indices[write++] = a;
+        indices[write++] = b;
+        indices[write++] = c;
+    }
+
+    indices.resize(write);
+
+    optimizeVertexCache(indices, weldedCount);
+    optimizeOverdraw(indices, positions, weldedCount);
+
+    // Fetch order: renumber vertices by first use; vertices no triangle references are dropped.
+    std::vector<unsigned int> fetchRemap(weldedCount, ~0u);
+    unsigned int nextVertex = 0;
+
+    for (unsigned int& index : indices)
+    {
+        if (fetchRemap[index] == ~0u)
+        {
+            fetchRemap[index] = nextVertex++;
+        }
+
+        index = fetchRemap[index];
+    }
+
+    remapAttribute<3>(positions, fetchRemap, nextVertex);
+    remapAttribute<3>(normals, fetchRemap, nextVertex);
+    remapAttribute<2>(uvs, fetchRemap, nextVertex);
+
+    if (outStats)
+    {
+        stats.verticesAfter = nextVertex;
+        stats.trianglesAfter = indices.size() / 3;
+        stats.transformsAfter = simulateFifoCache(indices.data(), indices.size(), nextVertex, kAcmrCacheSize);
+        measureOverdraw(positions.data(), nextVertex, indices.data(), indices.size(), stats.shadedAfter, stats.coveredAfter);
+
+        *outStats = stats;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Load-time index and vertex reordering for indexed triangle lists. Thread-safe (no shared state), so
+// the loader runs it per primitive on the pool.
+namespace meshOptimizer
+{
+    // Raw counts, so stats of several meshes add up before the ratios are taken.
+    struct Stats
+    {
+        uint64_t verticesBefore = 0;
+        uint64_t verticesAfter = 0;
+        uint64_t trianglesBefore = 0;
+        uint64_t trianglesAfter = 0;
+
+        // Vertex shader invocations under a simulated kAcmrCacheSize-entry FIFO post-transform cache.
+        uint64_t transformsBefore = 0;
+        uint64_t transformsAfter = 0;
+
+        // Fragments passing the depth test vs. pixels covered, summed over the six axis views.
+        uint64_t shadedBefore = 0;
+        uint64_t shadedAfter = 0;
+        uint64_t coveredBefore = 0;
+        uint64_t coveredAfter = 0;
+
+        void add(const Stats& other);
+
+        // Average cache miss ratio: transformed vertices per triangle (0.5 is ideal for a regular grid, 3 is worst).
+        double getAcmrBefore() const;
+        double getAcmrAfter() const;
+
+        // Shaded fragments per covered pixel (1 is ideal).
+        double getOverdrawBefore() const;
+        double getOverdrawAfter() const;
+    };
+
+    constexpr int kAcmrCacheSize = 16;
+
+    // Welds bit-identical vertices, drops degenerate triangles, orders triangles for the post-transform
+    // cache (Forsyth) and then by cluster for overdraw, and finally renumbers vertices in first-use order
+    // for fetch locality. positions / normals are xyz and uvs uv per vertex; all arrays are rewritten.
+    // Before/after stats are only measured when outStats is set.
+    void optimize(std::vector<float>& positions, std::vector<float>& normals, std::vector<float>& uvs, std::vector<unsigned int>& indices, Stats* outStats = nullptr);
+
+    // Forsyth's triangle order on its own, for index lists over an already optimised vertex buffer (LODs).
+    void optimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount);
+
+    // Vertex shader invocations for the index order under a FIFO cache of cacheSize entries.
+    uint64_t simulateFifoCache(const unsigned int* indices, size_t indexCount, size_t vertexCount, int cacheSize);
+
+    // Software-rasterises front faces from the six axis directions with a depth test.
+    void measureOverdraw(const float* positions, size_t vertexCount, const unsigned int* indices, size_t indexCount, uint64_t& outShaded, uint64_t& outCovered);
+}
\ No newline at end of file
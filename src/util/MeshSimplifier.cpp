@@ -0,0 +1,389 @@
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include <glm.hpp>
+
+// Symmetric 4x4 error quadric, stored as its 10 unique terms plus the summed plane weight (area).
+struct Quadric
+{
+    double a00 = 0.0, a01 = 0.0, a02 = 0.0, a11 = 0.0, a12 = 0.0, a22 = 0.0;
+    double b0 = 0.0, b1 = 0.0, b2 = 0.0;
+    double c = 0.0;
+    double weight = 0.0;
+
+    void addPlane(const glm::dvec3& n, double d, double w)
+    {
+        a00 += w * n.x * n.x;
+        a01 += w * n.x * n.y;
+        a02 += w * n.x * n.z;
+        a11 += w * n.y * n.y;
+        a12 += w * n.y * n.z;
+        a22 += w * n.z * n.z;
+        b0 += w * n.x * d;
+        b1 += w * n.y * d;
+        b2 += w * n.z * d;
+        c += w * d * d;
+        weight += w;
+    }
+
+    void add(const Quadric& q)
+    {
+        a00 += q.a00;
+        a01 += q.a01;
+        a02 += q.a02;
+        a11 += q.a11;
+        a12 += q.a12;
+        a22 += q.a22;
+        b0 += q.b0;
+        b1 += q.b1;
+        b2 += q.b2;
+        c += q.c;
+        weight += q.weight;
+    }
+
+    // Area-weighted mean squared distance of p to the accumulated planes.
+    double evaluate(const glm::dvec3& p) const
+    {
+        double e = a00 * p.x * p.x + a11 * p.y * p.y + a22 * p.z * p.z
+            + 2.0 * (a01 * p.x * p.y + a02 * p.x * p.z + a12 * p.y * p.z)
+            + 2.0 * (b0 * p.x + b1 * p.y + b2 * p.z)
+            + c;
+
+        return weight > 0.0 ? std::max(e, 0.0) / weight : 0.0;
+    }
+};
+
+struct Collapse
+{
+    unsigned int from;
+    unsigned int to;
+    double cost;
+};
+
+struct PositionKey
+{
+    float xyz[3];
+
+    bool operator==(const PositionKey& other) const
+    {
+        return std::memcmp(xyz, other.xyz, sizeof(xyz)) == 0;
+    }
+};
+
+struct PositionKeyHash
+{
+    size_t operator()(const PositionKey& key) const
+    {
+        uint32_t words[3];
+        std::memcpy(words, key.xyz, sizeof(words));
+
+        uint64_t h = 0xCBF29CE484222325ull;
+
+        for (uint32_t word : words)
+        {
+            h = (h ^ word) * 0x100000001B3ull;
+        }
+
+        return static_cast<size_t>(h ^ (h >> 32));
+    }
+};
+
+static glm::dvec3 getPosition(const float* positions, unsigned int v)
+{
+    return glm::dvec3(positions[v * 3 + 0], positions[v * 3 + 1], positions[v * 3 + 2]);
+}
+
+// Vertices that must not move: attribute seams (another vertex shares the position) and the ends of
+// border or non-manifold edges. Edges are compared by position, so a seam does not count as a border.
+static std::vector<unsigned char> findLockedVertices(const float* positions, size_t vertexCount, const std::vector<unsigned int>& indices)
+{
+    std::unordered_map<PositionKey, unsigned int, PositionKeyHash> unique;
+    unique.reserve(vertexCount);
+
+    std::vector<unsigned int> positionId(vertexCount);
+    std::vector<unsigned int> wedgeCount;
+
+    for (size_t v = 0; v < vertexCount; ++v)
+    {
+        PositionKey key;
+        std::memcpy(key.xyz, positions + v * 3, sizeof(key.xyz));
+
+        auto it = unique.emplace(key, static_cast<unsigned int>(unique.size())).first;
+        positionId[v] = it->second;
+
+        if (it->second >= wedgeCount.size())
+        {
+            wedgeCount.push_back(0);
+        }
+
+        ++wedgeCount[it->second];
+    }
+
+    std::vector<unsigned char> locked(vertexCount, 0);
+
+    for (size_t v = 0; v < vertexCount; ++v)
+    {
+        locked[v] = wedgeCount[positionId[v]] > 1 ? 1 : 0;
+    }
+
+    std::unordered_map<uint64_t, unsigned int> edgeUses;
+    edgeUses.reserve(indices.size());
+
+    auto edgeKey = [&](unsigned int a, unsigned int b)
+    {
+        uint64_t pa = positionId[a];
+        uint64_t pb = positionId[b];
+
+        return pa < pb ? (pa << 32) | pb : (pb << 32) | pa;
+    };
+
+    for (size_t i = 0; i < indices.size(); i += 3)
+    {
+        for (int k = 0; k < 3; ++k)
+        {
+            ++edgeUses[edgeKey(indices[i + k], indices[i + (k + 1) % 3])];
+        }
+    }
+
+    for (size_t i = 0; i < indices.size(); i += 3)
+    {
+        for (int k = 0; k < 3; ++k)
+        {
+            unsigned int a = indices[i + k];
+            unsigned int b = indices[i + (k + 1) % 3];
+
+            if (edgeUses[edgeKey(a, b)] != 2)
+            {
+                locked[a] = 1;
+                locked[b] = 1;
+            }
+        }
+    }
+
+    return locked;
+}
+
+std::vector<unsigned int> meshSimplifier::simplify(const float* positions, size_t vertexCount, const std::vector<unsigned int>& indices, size_t targetIndexCount, float maxError, float* outError)
+{
+    std::vector<unsigned int> result(indices.begin(), indices.begin() + indices.size() / 3 * 3);
+    double resultError = 0.0;
+
+    if (outError)
+    {
+        *outError = 0.0f;
+    }
+
+    for (unsigned int index : result)
+    {
+        if (index >= vertexCount)
+        {
+            return result;
+        }
+    }
+
+    if (result.size() <= targetIndexCount)
+    {
+        return result;
+    }
+
+    std::vector<unsigned char> locked = findLockedVertices(positions, vertexCount, result);
+
+    std::vector<Quadric> quadrics(vertexCount);
+
+    for (size_t i = 0; i < result.size(); i += 3)
+    {
+        glm::dvec3 p0 = getPosition(positions, result[i]);
+        glm::dvec3 p1 = getPosition(positions, result[i + 1]);
+        glm::dvec3 p2 = getPosition(positions, result[i + 2]);
+
+        glm::dvec3 n = glm::cross(p1 - p0, p2 - p0);
+        double length = glm::length(n);
+
+        if (length == 0.0)
+        {
+            continue;
+        }
+
+        n /= length;
+
+        for (int k = 0; k < 3; ++k)
+        {
+            quadrics[result[i + k]].addPlane(n, -glm::dot(n, p0), length * 0.5);
+        }
+    }
+
+    double maxCost = static_cast<double>(maxError) * static_cast<double>(maxError);
+
+    // remap[v] is where v went this pass; one level only, since both ends of a collapse are then frozen.
+    std::vector<unsigned int> remap(vertexCount);
+
+    for (size_t v = 0; v < vertexCount; ++v)
+    {
+        remap[v] = static_cast<unsigned int>(v);
+    }
+
+    std::vector<size_t> adjacencyOffsets(vertexCount + 1);
+    std::vector<unsigned int> adjacency;
+    std::vector<Collapse> candidates;
+    std::vector<unsigned char> touched(vertexCount);
+
+    while (result.size() > targetIndexCount)
+    {
+        size_t triangleCount = result.size() / 3;
+
+        // Vertex -> triangle adjacency of the current list.
+        std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+
+        for (unsigned int v : result)
+        {
+            ++adjacencyOffsets[v + 1];
+        }
+
+        for (size_t v = 0; v < vertexCount; ++v)
+        {
+            adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+        }
+
+        adjacency.resize(result.size());
+        std::vector<size_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+
+        for (size_t i = 0; i < result.size(); ++i)
+        {
+            adjacency[fill[result[i]]++] = static_cast<unsigned int>(i / 3);
+        }
+
+        // Every half-edge offers both directions; a collapse keeps the target's position.
+        candidates.clear();
+
+        for (size_t i = 0; i < result.size(); i += 3)
+        {
+            for (int k = 0; k < 3; ++k)
+            {
+                unsigned int a = result[i + k];
+                unsigned int b = result[i + (k + 1) % 3];
+
+                for (int dir = 0; dir < 2; ++dir)
+                {
+                    unsigned int from = dir == 0 ? a : b;
+                    unsigned int to = dir == 0 ? b : a;
+
+                    if (locked[from])
+                    {
+                        continue;
+                    }
+
+                    Quadric q = quadrics[from];
+                    q.add(quadrics[to]);
+
+                    candidates.push_back({ from, to, q.evaluate(getPosition(positions, to)) });
+                }
+            }
+        }
+
+        std::sort(candidates.begin(), candidates.end(), [](const Collapse& a, const Collapse& b)
+        {
+            return a.cost < b.cost;
+        });
+
+        std::fill(touched.begin(), touched.end(), 0);
+
+        size_t removeGoal = triangleCount - targetIndexCount / 3;
+        size_t removed = 0;
+        size_t collapsed = 0;
+
+        for (const Collapse& c : candidates)
+        {
+            if (c.cost > maxCost || removed >= removeGoal)
+            {
+                break;
+            }
+
+            if (touched[c.from] || touched[c.to])
+            {
+                continue;
+            }
+
+            glm::dvec3 target = getPosition(positions, c.to);
+
+            size_t shared = 0;
+            bool flips = false;
+
+            for (size_t a = adjacencyOffsets[c.from]; a < adjacencyOffsets[c.from + 1] && !flips; ++a)
+            {
+                const unsigned int* tri = result.data() + static_cast<size_t>(adjacency[a]) * 3;
+                unsigned int v[3] = { remap[tri[0]], remap[tri[1]], remap[tri[2]] };
+
+                if (v[0] == c.to || v[1] == c.to || v[2] == c.to)
+                {
+                    ++shared;
+                    continue;
+                }
+
+                glm::dvec3 p[3] = { getPosition(positions, v[0]), getPosition(positions, v[1]), getPosition(positions, v[2]) };
+                glm::dvec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+
+                for (int k = 0; k < 3; ++k)
+                {
+                    if (v[k] == c.from)
+                    {
+                        p[k] = target;
+                    }
+                }
+
+                glm::dvec3 after = glm::cross(p[1] - p[0], p[2] - p[0]);
+
+                flips = glm::dot(before, after) <= 0.0;
+            }
+
+            if (flips)
+            {
+                continue;
+            }
+
+            remap[c.from] = c.to;
+            quadrics[c.to].add(quadrics[c.from]);
+            touched[c.from] = 1;
+            touched[c.to] = 1;
+
+            removed += shared;
+            resultError = std::max(resultError, c.cost);
+            ++collapsed;
+        }
+
+        if (collapsed == 0)
+        {
+            break;
+        }
+
+        size_t write = 0;
+
+        for (size_t i = 0; i < result.size(); i += 3)
+        {
+            unsigned int a = remap[result[i]];
+            unsigned int b = remap[result[i + 1]];
+            unsigned int c = remap[result[i + 2]];
+
+            if (a == b || b == c || a == c)
+            {
+                continue;
+            }
+
+            result[write++] = a;
+            result[write++] = b;
+            result[write++] = c;
+        }
+
+        result.resize(write);
+    }
+
+    if (outError)
+    {
+        *outError = static_cast<float>(std::sqrt(resultError));
+    }
+
+    return result;
+}
\ No newline at end of file
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// Quadric-error edge-collapse simplification (Garland and Heckbert, "Surface Simplification Using
+// Quadric Error Metrics"). Vertices only ever collapse onto existing vertices, so the result indexes the
+// same vertex buffer and a LOD is nothing more than another index range. Thread-safe (no shared state).
+namespace meshSimplifier
+{
+    // Collapses edges of the triangle list in order of increasing error until at most targetIndexCount
+    // indices remain, no collapse is cheaper than maxError, or every remaining edge is locked. Mesh
+    // borders, attribute seams (several vertices at one position) and collapses that would flip a
+    // triangle are left alone, so the outline and UV layout survive. Returns the new triangle list;
+    // outError receives the largest error taken, in the units of positions (xyz per vertex).
+    std::vector<unsigned int> simplify(const float* positions, size_t vertexCount, const std::vector<unsigned int>& indices, size_t targetIndexCount, float maxError, float* outError = nullptr);
+}
\ No newline at end of file
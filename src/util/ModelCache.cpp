@@ -0,0 +1,486 @@
+#include "ModelCache.h"
+#include "ModelCacheFormat.h"
+#include "TextureLoader.h"
+#include "../scene/MeshBvh.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+using namespace modelCacheFormat;
+
+static_assert(kMaxExtraLods + 1 == GpuMesh::kMaxLods, "MeshEntry holds every simplified level of a GpuMesh");
+
+static uint64_t alignSection(uint64_t offset)
+{
+    return (offset + kSectionAlignment - 1) & ~static_cast<uint64_t>(kSectionAlignment - 1);
+}
+
+static uint64_t mix64(uint64_t h)
+{
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ull;
+    h ^= h >> 33;
+
+    return h;
+}
+
+uint64_t modelCache::hashBytes(const unsigned char* data, size_t size)
+{
+    static constexpr uint64_t kPrime = 0x100000001B3ull;
+
+    // Four independent FNV-style lanes over 8-byte words, folded down after every multiply so high
+    // input bits reach the low ones; then the tail bytes, then an avalanche.
+    uint64_t lanes[4] = { 0xCBF29CE484222325ull, 0x84222325CBF29CE4ull, 0x9E3779B97F4A7C15ull, 0xC2B2AE3D27D4EB4Full };
+    size_t i = 0;
+
+    for (; i + 32 <= size; i += 32)
+    {
+        for (int l = 0; l < 4; ++l)
+        {
+            uint64_t word;
+            std::memcpy(&word, data + i + l * 8, 8);
+
+            lanes[l] = (lanes[l] ^ word) * kPrime;
+            lanes[l] ^= lanes[l] >> 32;
+        }
+    }
+
+    uint64_t h = mix64(lanes[0]) ^ (mix64(lanes[1]) * 3) ^ (mix64(lanes[2]) * 5) ^ (mix64(lanes[3]) * 7);
+
+    for (; i < size; ++i)
+    {
+        h = (h ^ data[i]) * kPrime;
+    }
+
+    return mix64(h ^ static_cast<uint64_t>(size));
+}
+
+std::string modelCache::getCachePath(const std::string& cacheDir, const std::string& sourcePath, uint64_t sourceHash)
+{
+    char hex[17];
+    std::snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(sourceHash));
+
+    std::string fileName = std::filesystem::path(sourcePath).stem().string() + "-" + hex + ".hmmodel";
+
+    return (std::filesystem::path(cacheDir) / fileName).string();
+}
+
+static uint64_t getBvhBytes(const MeshBvh& bvh)
+{
+    return static_cast<uint64_t>(bvh.getNodeCount()) * MeshBvh::kNodeBytes + static_cast<uint64_t>(bvh.getTriangleCount()) * 3 * sizeof(glm::vec3);
+}
+
+// Streams sections in file order, zero-padding up to each section's offset.
+class SectionWriter
+{
+public:
+    explicit SectionWriter(std::ofstream& inOut)
+        : out(inOut)
+    {
+    }
+
+    void at(uint64_t offset)
+    {
+        static const char kZeros[kSectionAlignment] = {};
+
+        while (position < offset)
+        {
+            size_t pad = static_cast<size_t>(std::min<uint64_t>(offset - position, kSectionAlignment));
+            out.write(kZeros, static_cast<std::streamsize>(pad));
+            position += pad;
+        }
+    }
+
+    void bytes(const void* data, uint64_t size)
+    {
+        if (size > 0)
+        {
+            out.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+            position += size;
+        }
+    }
+
+private:
+    std::ofstream& out;
+    uint64_t position = 0;
+};
+
+bool modelCache::write(const std::string& path, const Contents& contents)
+{
+    Header header;
+    std::memset(&header, 0, sizeof(header));
+
+    header.magic = kMagic;
+    header.version = kVersion;
+    header.sourceHash = contents.sourceHash;
+    header.sourceSize = contents.sourceSize;
+    header.flags = (contents.hasPickBvh ? kFlagPickBvh : 0) | (contents.optimizedMeshes ? kFlagOptimizedMeshes : 0) | (contents.meshLods ? kFlagMeshLods : 0);
+    header.vertexStride = static_cast<uint32_t>(contents.vertexStride);
+    header.nodeCount = static_cast<uint32_t>(contents.nodes.size());
+    header.meshCount = static_cast<uint32_t>(contents.meshes.size());
+    header.textureCount = static_cast<uint32_t>(contents.textures.size());
+
+    std::vector<NodeEntry> nodes(contents.nodes.size());
+    std::string strings;
+
+    for (size_t i = 0; i < contents.nodes.size(); ++i)
+    {
+        const NodeRecord& record = contents.nodes[i];
+        NodeEntry& e = nodes[i];
+
+        std::memcpy(e.localTransform, &record.localTransform[0][0], sizeof(e.localTransform));
+        e.nameOffset = static_cast<uint32_t>(strings.size());
+        e.nameLength = static_cast<uint32_t>(record.name.size());
+        e.parent = record.parent;
+        e.meshCount = static_cast<uint32_t>(record.meshCount);
+
+        strings += record.name;
+    }
+
+    header.stringBytes = static_cast<uint32_t>(strings.size());
+
+    // Lay out header, tables, strings, vertex and index blobs, then texture and BVH payloads.
+    uint64_t offset = sizeof(Header);
+
+    header.nodesOffset = offset = alignSection(offset);
+    offset += nodes.size() * sizeof(NodeEntry);
+
+    header.meshesOffset = offset = alignSection(offset);
+    offset += contents.meshes.size() * sizeof(MeshEntry);
+
+    header.texturesOffset = offset = alignSection(offset);
+    offset += contents.textures.size() * sizeof(TextureEntry);
+
+    header.stringsOffset = offset = alignSection(offset);
+    offset += strings.size();
+
+    header.vertexOffset = offset = alignSection(offset);
+    header.vertexCount = contents.vertexCount;
+    offset += static_cast<uint64_t>(contents.vertexCount) * contents.vertexStride;
+
+    header.indexOffset = offset = alignSection(offset);
+    header.indexByteCount = contents.indexByteCount;
+    offset += contents.indexByteCount;
+
+    std::vector<TextureEntry> textures(contents.textures.size());
+
+    for (size_t i = 0; i < contents.textures.size(); ++i)
+    {
+        const TextureRecord& record = contents.textures[i];
+        TextureEntry& e = textures[i];
+
+        std::memset(&e, 0, sizeof(e));
+        e.width = static_cast<uint32_t>(record.width);
+        e.height = static_cast<uint32_t>(record.height);
+        e.levelCount = static_cast<uint32_t>(record.levelCount);
+        e.contentHash = record.contentHash;
+        e.pixelsOffset = offset = alignSection(offset);
+        e.pixelBytes = record.pixelBytes;
+
+        offset += record.pixelBytes;
+    }
+
+    std::vector<MeshEntry> meshes(contents.meshes.size());
+
+    for (size_t i = 0; i < contents.meshes.size(); ++i)
+    {
+        const MeshRecord& record = contents.meshes[i];
+        MeshEntry& e = meshes[i];
+
+        std::memset(&e, 0, sizeof(e));
+        e.indexCount = static_cast<uint32_t>(record.mesh.indexCount);
+        e.indexType = record.mesh.indexType;
+        e.indexOffset = record.mesh.indexOffset;
+        e.baseVertex = record.mesh.baseVertex;
+        e.textureIndex = record.textureIndex;
+        std::memcpy(e.boundsMin, &record.mesh.boundsMin[0], sizeof(e.boundsMin));
+        std::memcpy(e.boundsMax, &record.mesh.boundsMax[0], sizeof(e.boundsMax));
+
+        e.lodCount = static_cast<uint32_t>(record.mesh.lodCount);
+
+        for (int l = 0; l + 1 < record.mesh.lodCount; ++l)
+        {
+            e.lodIndexCount[l] = static_cast<uint32_t>(record.mesh.lods[l].indexCount);
+            e.lodFirstIndex[l] = static_cast<uint32_t>(record.mesh.lods[l].firstIndex);
+            e.lodError[l] = record.mesh.lods[l].error;
+        }
+
+        if (contents.hasPickBvh && record.bvh)
+        {
+            e.bvhOffset = offset = alignSection(offset);
+            e.bvhNodeCount = static_cast<uint32_t>(record.bvh->getNodeCount());
+            e.bvhTriangleCount = static_cast<uint32_t>(record.bvh->getTriangleCount());
+
+            offset += getBvhBytes(*record.bvh);
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path(), ec);
+
+    std::string tempPath = path + ".tmp";
+
+    {
+        std::ofstream out(tempPath, std::ios::out | std::ios::binary | std::ios::trunc);
+
+        if (!out.is_open())
+        {
+            return false;
+        }
+
+        SectionWriter w(out);
+
+        w.bytes(&header, sizeof(header));
+
+        w.at(header.nodesOffset);
+        w.bytes(nodes.data(), nodes.size() * sizeof(NodeEntry));
+
+        w.at(header.meshesOffset);
+        w.bytes(meshes.data(), meshes.size() * sizeof(MeshEntry));
+
+        w.at(header.texturesOffset);
+        w.bytes(textures.data(), textures.size() * sizeof(TextureEntry));
+
+        w.at(header.stringsOffset);
+        w.bytes(strings.data(), strings.size());
+
+        w.at(header.vertexOffset);
+        w.bytes(contents.vertexData, static_cast<uint64_t>(contents.vertexCount) * contents.vertexStride);
+
+        w.at(header.indexOffset);
+        w.bytes(contents.indexData, contents.indexByteCount);
+
+        for (size_t i = 0; i < textures.size(); ++i)
+        {
+            w.at(textures[i].pixelsOffset);
+            w.bytes(contents.textures[i].pixels, textures[i].pixelBytes);
+        }
+
+        for (size_t i = 0; i < meshes.size(); ++i)
+        {
+            if (meshes[i].bvhNodeCount == 0)
+            {
+                continue;
+            }
+
+            const MeshBvh& bvh = *contents.meshes[i].bvh;
+
+            w.at(meshes[i].bvhOffset);
+            w.bytes(bvh.getNodeData(), bvh.getNodeCount() * MeshBvh::kNodeBytes);
+            w.bytes(bvh.getCorners(), bvh.getTriangleCount() * 3 * sizeof(glm::vec3));
+        }
+
+        if (!out.good())
+        {
+            out.close();
+            std::filesystem::remove(tempPath, ec);
+
+            return false;
+        }
+    }
+
+    // rename does not replace an existing file on every platform.
+    std::filesystem::remove(path, ec);
+    std::filesystem::rename(tempPath, path, ec);
+
+    if (ec)
+    {
+        std::filesystem::remove(tempPath, ec);
+
+        return false;
+    }
+
+    return true;
+}
+
+static bool inRange(uint64_t offset, uint64_t bytes, uint64_t size)
+{
+    return offset <= size && bytes <= size - offset;
+}
+
+bool modelCache::read(const MappedFile& file, uint64_t sourceHash, uint64_t sourceSize, size_t vertexStride, bool loadPickBvh, bool optimizedMeshes, bool meshLods, Contents& out)
+{
+    const unsigned char* data = file.getData();
+    uint64_t size = file.getSize();
+
+    out = Contents();
+
+    if (!data || size < sizeof(Header))
+    {
+        return false;
+    }
+
+    Header header;
+    std::memcpy(&header, data, sizeof(header));
+
+    if (header.magic != kMagic || header.version != kVersion || header.sourceHash != sourceHash || header.sourceSize != sourceSize || header.vertexStride != vertexStride)
+    {
+        return false;
+    }
+
+    if (loadPickBvh && (header.flags & kFlagPickBvh) == 0)
+    {
+        return false;
+    }
+
+    if (((header.flags & kFlagOptimizedMeshes) != 0) != optimizedMeshes || ((header.flags & kFlagMeshLods) != 0) != meshLods)
+    {
+        return false;
+    }
+
+    if (!inRange(header.nodesOffset, static_cast<uint64_t>(header.nodeCount) * sizeof(NodeEntry), size) ||
+        !inRange(header.meshesOffset, static_cast<uint64_t>(header.meshCount) * sizeof(MeshEntry), size) ||
+        !inRange(header.texturesOffset, static_cast<uint64_t>(header.textureCount) * sizeof(TextureEntry), size) ||
+        !inRange(header.stringsOffset, header.stringBytes, size) ||
+        header.vertexCount > size ||
+        !inRange(header.vertexOffset, header.vertexCount * vertexStride, size) ||
+        !inRange(header.indexOffset, header.indexByteCount, size) ||
+        header.nodesOffset % kSectionAlignment != 0 || header.meshesOffset % kSectionAlignment != 0 ||
+        header.texturesOffset % kSectionAlignment != 0 || header.vertexOffset % kSectionAlignment != 0)
+    {
+        return false;
+    }
+
+    const NodeEntry* nodes = reinterpret_cast<const NodeEntry*>(data + header.nodesOffset);
+    const MeshEntry* meshes = reinterpret_cast<const MeshEntry*>(data + header.meshesOffset);
+    const TextureEntry* textures = reinterpret_cast<const TextureEntry*>(data + header.texturesOffset);
+    const char* strings = reinterpret_cast<const char*>(data + header.stringsOffset);
+
+    uint64_t meshTotal = 0;
+
+    out.nodes.resize(header.nodeCount);
+
+    for (uint32_t i = 0; i < header.nodeCount; ++i)
+    {
+        const NodeEntry& e = nodes[i];
+
+        // Pre-order: every parent comes before its children, and only the first node is a root.
+        bool parentOk = (i == 0) ? e.parent == -1 : (e.parent >= 0 && static_cast<uint32_t>(e.parent) < i);
+
+        if (!parentOk || !inRange(e.nameOffset, e.nameLength, header.stringBytes))
+        {
+            return false;
+        }
+
+        NodeRecord& record = out.nodes[i];
+        record.name.assign(strings + e.nameOffset, e.nameLength);
+        std::memcpy(&record.localTransform[0][0], e.localTransform, sizeof(e.localTransform));
+        record.parent = e.parent;
+        record.meshCount = static_cast<int>(e.meshCount);
+
+        meshTotal += e.meshCount;
+    }
+
+    if (meshTotal != header.meshCount)
+    {
+        return false;
+    }
+
+    out.textures.resize(header.textureCount);
+
+    for (uint32_t i = 0; i < header.textureCount; ++i)
+    {
+        const TextureEntry& e = textures[i];
+
+        if (e.width == 0 || e.height == 0 || e.width > 65536 || e.height > 65536 || e.levelCount == 0 || e.levelCount > 17 ||
+            e.pixelBytes != textureLoader::getMipChainBytes(e.width, e.height, e.levelCount) || !inRange(e.pixelsOffset, e.pixelBytes, size))
+        {
+            return false;
+        }
+
+        TextureRecord& record = out.textures[i];
+        record.width = static_cast<int>(e.width);
+        record.height = static_cast<int>(e.height);
+        record.levelCount = static_cast<int>(e.levelCount);
+        record.contentHash = e.contentHash;
+        record.pixels = data + e.pixelsOffset;
+        record.pixelBytes = static_cast<size_t>(e.pixelBytes);
+    }
+
+    out.meshes.resize(header.meshCount);
+
+    for (uint32_t i = 0; i < header.meshCount; ++i)
+    {
+        const MeshEntry& e = meshes[i];
+
+        uint64_t indexSize = (e.indexType == GL_UNSIGNED_SHORT) ? 2 : 4;
+
+        if ((e.indexType != GL_UNSIGNED_SHORT && e.indexType != GL_UNSIGNED_INT) || e.indexOffset % indexSize != 0 ||
+            !inRange(e.indexOffset, static_cast<uint64_t>(e.indexCount) * indexSize, header.indexByteCount) ||
+            e.baseVertex < 0 || static_cast<uint64_t>(e.baseVertex) > header.vertexCount ||
+            e.textureIndex < -1 || e.textureIndex >= static_cast<int32_t>(header.textureCount) ||
+            e.lodCount == 0 || e.lodCount > kMaxExtraLods + 1)
+        {
+            return false;
+        }
+
+        for (uint32_t l = 0; l + 1 < e.lodCount; ++l)
+        {
+            if (!inRange(e.indexOffset + static_cast<uint64_t>(e.lodFirstIndex[l]) * indexSize, static_cast<uint64_t>(e.lodIndexCount[l]) * indexSize, header.indexByteCount))
+            {
+                return false;
+            }
+        }
+
+        MeshRecord& record = out.meshes[i];
+        GpuMesh& m = record.mesh;
+
+        m.indexCount = static_cast<GLsizei>(e.indexCount);
+        m.indexType = e.indexType;
+        m.indexOffset = static_cast<size_t>(e.indexOffset);
+        m.baseVertex = e.baseVertex;
+        m.inArena = true;
+        m.boundsMin = glm::vec3(e.boundsMin[0], e.boundsMin[1], e.boundsMin[2]);
+        m.boundsMax = glm::vec3(e.boundsMax[0], e.boundsMax[1], e.boundsMax[2]);
+        m.lodCount = static_cast<int>(e.lodCount);
+
+        for (uint32_t l = 0; l + 1 < e.lodCount; ++l)
+        {
+            m.lods[l].indexCount = static_cast<GLsizei>(e.lodIndexCount[l]);
+            m.lods[l].firstIndex = static_cast<GLsizei>(e.lodFirstIndex[l]);
+            m.lods[l].error = e.lodError[l];
+        }
+
+        record.textureIndex = e.textureIndex;
+
+        if (!loadPickBvh || e.bvhNodeCount == 0)
+        {
+            continue;
+        }
+
+        uint64_t nodeBytes = static_cast<uint64_t>(e.bvhNodeCount) * MeshBvh::kNodeBytes;
+        uint64_t cornerBytes = static_cast<uint64_t>(e.bvhTriangleCount) * 3 * sizeof(glm::vec3);
+
+        if (e.bvhOffset % 4 != 0 || !inRange(e.bvhOffset, nodeBytes + cornerBytes, size))
+        {
+            return false;
+        }
+
+        std::shared_ptr<MeshBvh> bvh = std::make_shared<MeshBvh>();
+
+        if (!bvh->assign(data + e.bvhOffset, e.bvhNodeCount, reinterpret_cast<const glm::vec3*>(data + e.bvhOffset + nodeBytes), e.bvhTriangleCount))
+        {
+            return false;
+        }
+
+        record.bvh = bvh;
+    }
+
+    out.sourceHash = header.sourceHash;
+    out.sourceSize = header.sourceSize;
+    out.vertexData = data + header.vertexOffset;
+    out.vertexCount = static_cast<size_t>(header.vertexCount);
+    out.vertexStride = vertexStride;
+    out.indexData = data + header.indexOffset;
+    out.indexByteCount = static_cast<size_t>(header.indexByteCount);
+    out.hasPickBvh = (header.flags & kFlagPickBvh) != 0;
+    out.optimizedMeshes = optimizedMeshes;
+    out.meshLods = meshLods;
+
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <glm.hpp>
+
+#include "../scene/SceneTypes.h"
+#include "MappedFile.h"
+
+// Reads and writes the GPU-ready model cache (see ModelCacheFormat.h). The loader owns what goes in
+// it; this only lays the sections out and checks them on the way back.
+namespace modelCache
+{
+    // Pre-order; parent is -1 for the root only.
+    struct NodeRecord
+    {
+        std::string name;
+        glm::mat4 localTransform = glm::mat4(1.0f);
+        int parent = -1;
+        int meshCount = 0;
+    };
+
+    // Draw parameters and bounds only; GL names are not cached.
+    struct MeshRecord
+    {
+        GpuMesh mesh;
+        int textureIndex = -1;
+        std::shared_ptr<const MeshBvh> bvh;
+    };
+
+    struct TextureRecord
+    {
+        int width = 0;
+        int height = 0;
+        int levelCount = 0;
+        uint64_t contentHash = 0;
+        const unsigned char* pixels = nullptr;
+        size_t pixelBytes = 0;
+    };
+
+    // Blob and pixel pointers reference the caller's memory when writing and the mapped file when reading.
+    struct Contents
+    {
+        uint64_t sourceHash = 0;
+        uint64_t sourceSize = 0;
+
+        std::vector<NodeRecord> nodes;
+        std::vector<MeshRecord> meshes;
+        std::vector<TextureRecord> textures;
+
+        const unsigned char* vertexData = nullptr;
+        size_t vertexCount = 0;
+        size_t vertexStride = 0;
+
+        const unsigned char* indexData = nullptr;
+        size_t indexByteCount = 0;
+
+        bool hasPickBvh = false;
+        bool optimizedMeshes = false;
+        bool meshLods = false;
+    };
+
+    // Fast non-cryptographic 64-bit hash; good for cache keys, not for anything adversarial.
+    uint64_t hashBytes(const unsigned char* data, size_t size);
+
+    // <cacheDir>/<source stem>-<hash>.hmmodel
+    std::string getCachePath(const std::string& cacheDir, const std::string& sourcePath, uint64_t sourceHash);
+
+    // Writes to a temporary file and renames it into place, so a reader never sees a partial cache.
+    bool write(const std::string& path, const Contents& contents);
+
+    // Fails on any mismatch (source, vertex layout, mesh optimisation or LODs, missing pick BVHs when asked
+    // for) or out-of-range section; the caller then falls back to the source file.
+    bool read(const MappedFile& file, uint64_t sourceHash, uint64_t sourceSize, size_t vertexStride, bool loadPickBvh, bool optimizedMeshes, bool meshLods, Contents& out);
+}
\ No newline at end of file
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstdint>
+
+// GPU-ready model cache (".hmmodel"), little-endian, read in place from a memory-mapped file. Written
+// after a .glb is first loaded and named after the source file's content hash, so an edited source
+// simply misses. Every section starts on a kSectionAlignment boundary.
+//
+//   Header
+//   NodeEntry[nodeCount]          pre-order, node 0 is the synthetic root; names in the string blob
+//   MeshEntry[meshCount]          pre-order, a node's meshes are the next NodeEntry::meshCount entries
+//                                 (LOD index ranges follow each mesh's own indices in the index blob)
+//   TextureEntry[textureCount]    one per distinct image content
+//   string blob                   node names, not terminated
+//   vertex blob                   vertexCount x vertexStride bytes, arena layout
+//   index blob                    indexByteCount bytes, arena layout (16/32-bit per mesh)
+//   per texture                   full mip chain, RGBA8, level 0 first, levels tightly packed
+//   per mesh with a pick BVH      nodes (bvhNodeCount x kBvhNodeBytes), then corners (3 x vec3 per triangle)
+namespace modelCacheFormat
+{
+    constexpr uint32_t kMagic = 0x4C444D48; // "HMDL"
+    constexpr uint32_t kVersion = 2;
+    constexpr uint32_t kSectionAlignment = 16;
+
+    constexpr uint32_t kFlagPickBvh = 1u << 0;
+    constexpr uint32_t kFlagOptimizedMeshes = 1u << 1;
+    constexpr uint32_t kFlagMeshLods = 1u << 2;
+
+    // Simplified levels per mesh after the full one (GpuMesh::kMaxLods - 1).
+    constexpr uint32_t kMaxExtraLods = 3;
+
+    struct Header
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t sourceHash;
+        uint64_t sourceSize;
+        uint32_t flags;
+        uint32_t vertexStride;
+
+        uint32_t nodeCount;
+        uint32_t meshCount;
+        uint32_t textureCount;
+        uint32_t stringBytes;
+
+        uint64_t nodesOffset;
+        uint64_t meshesOffset;
+        uint64_t texturesOffset;
+        uint64_t stringsOffset;
+
+        uint64_t vertexOffset;
+        uint64_t vertexCount;
+        uint64_t indexOffset;
+        uint64_t indexByteCount;
+    };
+
+    struct NodeEntry
+    {
+        float localTransform[16];
+        uint32_t nameOffset;
+        uint32_t nameLength;
+        int32_t parent;
+        uint32_t meshCount;
+    };
+
+    struct MeshEntry
+    {
+        uint32_t indexCount;
+        uint32_t indexType;
+        uint64_t indexOffset;
+        int32_t baseVertex;
+        int32_t textureIndex;
+        float boundsMin[3];
+        float boundsMax[3];
+
+        uint64_t bvhOffset;
+        uint32_t bvhNodeCount;
+        uint32_t bvhTriangleCount;
+
+        // Levels 1 .. lodCount - 1; firstIndex is relative to indexOffset, in indices.
+        uint32_t lodCount;
+        uint32_t lodIndexCount[kMaxExtraLods];
+        uint32_t lodFirstIndex[kMaxExtraLods];
+        float lodError[kMaxExtraLods];
+    };
+
+    struct TextureEntry
+    {
+        uint32_t width;
+        uint32_t height;
+        uint32_t levelCount;
+        uint32_t reserved;
+        uint64_t contentHash;
+        uint64_t pixelsOffset;
+        uint64_t pixelBytes;
+    };
+
+    static_assert(sizeof(Header) == 112, "Header layout is part of the file format");
+    static_assert(sizeof(NodeEntry) == 80, "NodeEntry layout is part of the file format");
+    static_assert(sizeof(MeshEntry) == 104, "MeshEntry layout is part of the file format");
+    static_assert(sizeof(TextureEntry) == 40, "TextureEntry layout is part of the file format");
+}
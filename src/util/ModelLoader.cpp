@@ -1,8 +1,21 @@
 #include "ModelLoader.h"
 #include "TextureLoader.h"
+#include "MeshSimplifier.h"
+#include "ModelCache.h"
+#include "MappedFile.h"
+#include "Log.h"
+#include "../scene/SceneGraph.h"
+#include "../scene/MeshBvh.h"
 
 #include <unordered_map>
-#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <chrono>
+#include <filesystem>
 
 #define TINYGLTF_NO_EXTERNAL_IMAGE
 #define TINYGLTF_IMPLEMENTATION
@@ -12,7 +25,10 @@
 #include "tiny_gltf.h"
 #include "stb_image.h"
 
-static bool loadImageDataWithStb(
+// Encoded image bytes by glTF image index, captured during the parse and decoded afterwards on the pool.
+using EncodedImages = std::vector<std::vector<unsigned char>>;
+
+static bool captureEncodedImage(
     tinygltf::Image* image,
     const int imageIndex,
     std::string* err,
@@ -23,36 +39,81 @@ static bool loadImageDataWithStb(
     int size,
     void* userData)
 {
-    (void)imageIndex;
+    (void)image;
+    (void)err;
     (void)warn;
     (void)reqWidth;
     (void)reqHeight;
-    (void)userData;
+
+    EncodedImages& encoded = *static_cast<EncodedImages*>(userData);
+
+    if (imageIndex >= static_cast<int>(encoded.size()))
+    {
+        encoded.resize(static_cast<size_t>(imageIndex) + 1);
+    }
+
+    encoded[imageIndex].assign(bytes, bytes + size);
+
+    return true;
+}
+
+static bool decodeImage(const std::vector<unsigned char>& encoded, tinygltf::Image& image)
+{
+    // glTF images are top-down. stb's per-thread flag outranks its global one once set, so every decode
+    // in the app sets its own on the decoding thread (textureLoader flips).
+    stbi_set_flip_vertically_on_load_thread(0);
 
     int w = 0;
     int h = 0;
     int comp = 0;
 
-    unsigned char* decoded = stbi_load_from_memory(bytes, size, &w, &h, &comp, 4);
+    unsigned char* decoded = stbi_load_from_memory(encoded.data(), static_cast<int>(encoded.size()), &w, &h, &comp, 4);
 
     if (!decoded)
     {
-        if (err) *err = "stb_image failed to decode image bytes.";
         return false;
     }
 
-    image->width = w;
-    image->height = h;
-    image->component = 4;
-    image->bits = 8;
-    image->pixel_type = TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE;
+    image.width = w;
+    image.height = h;
+    image.component = 4;
+    image.bits = 8;
+    image.pixel_type = TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE;
 
-    image->image.assign(decoded, decoded + (w * h * 4));
+    image.image.assign(decoded, decoded + (static_cast<size_t>(w) * h * 4));
     stbi_image_free(decoded);
 
     return true;
 }
 
+// Runs body(i) for every i in [0, count): one item per task on the pool, or inline without one.
+template <typename Body>
+static void forEachItem(ThreadPool* pool, int count, const Body& body)
+{
+    if (!pool)
+    {
+        for (int i = 0; i < count; ++i)
+        {
+            body(i);
+        }
+
+        return;
+    }
+
+    pool->parallelFor(count, 1, [&body](int begin, int end)
+    {
+        for (int i = begin; i < end; ++i)
+        {
+            body(i);
+        }
+    });
+}
+
+static double millisecondsSince(std::chrono::high_resolution_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
 static glm::mat4 toGlmMat4(const double* m16)
 {
     glm::mat4 m(1.0f);
@@ -125,7 +186,29 @@ static const unsigned char* getBufferPtr(const tinygltf::Model& model, const tin
     return b.data.data() + start;
 }
 
-static void uploadPrimitive(const tinygltf::Model& model, const tinygltf::Primitive& prim, GLuint textureId, std::vector<GpuMesh>& outMeshes)
+struct PrimitiveData
+{
+    std::vector<float> positions;
+    std::vector<float> normals;
+    std::vector<float> uvs;
+    std::vector<unsigned int> indices;
+};
+
+// Interleaved arena vertex: position, normal packed as signed 10:10:10:2, uv.
+struct PackedVertex
+{
+    float position[3];
+    uint32_t normal;
+    float uv[2];
+};
+
+struct MeshArenaBuilder
+{
+    std::vector<PackedVertex> vertices;
+    std::vector<unsigned char> indexBytes;
+};
+
+static bool readPrimitive(const tinygltf::Model& model, const tinygltf::Primitive& prim, PrimitiveData& out)
 {
     auto itPos = prim.attributes.find("POSITION");
     auto itNor = prim.attributes.find("NORMAL");
@@ -133,7 +216,7 @@ static void uploadPrimitive(const tinygltf::Model& model, const tinygltf::Primit
 
     if (itPos == prim.attributes.end() || prim.indices < 0)
     {
-        return;
+        return false;
     }
 
     const tinygltf::Accessor& accPos = model.accessors[itPos->second];
@@ -158,9 +241,9 @@ static void uploadPrimitive(const tinygltf::Model& model, const tinygltf::Primit
     int countIdx = 0;
     const unsigned char* ptrIdx = getBufferPtr(model, accIdx, strideIdx, countIdx);
 
-    std::vector<float> positions;
-    std::vector<float> normals;
-    std::vector<float> uvs;
+    std::vector<float>& positions = out.positions;
+    std::vector<float>& normals = out.normals;
+    std::vector<float>& uvs = out.uvs;
 
     positions.resize(static_cast<size_t>(countPos) * 3);
 
@@ -209,7 +292,7 @@ static void uploadPrimitive(const tinygltf::Model& model, const tinygltf::Primit
         }
     }
 
-    std::vector<unsigned int> indices;
+    std::vector<unsigned int>& indices = out.indices;
     indices.resize(static_cast<size_t>(countIdx));
 
     for (int i = 0; i < countIdx; ++i)
@@ -235,7 +318,16 @@ static void uploadPrimitive(const tinygltf::Model& model, const tinygltf::Primit
         indices[static_cast<size_t>(i)] = idx;
     }
 
-    GpuMesh m;
+    return true;
+}
+
+// Creates the per-primitive buffers for the non-arena path; m already carries the draw parameters.
+static void uploadPrimitive(const PrimitiveData& data, GpuMesh& m)
+{
+    const std::vector<float>& positions = data.positions;
+    const std::vector<float>& normals = data.normals;
+    const std::vector<float>& uvs = data.uvs;
+    const std::vector<unsigned int>& indices = data.indices;
 
     glGenVertexArrays(1, &m.vao);
     glBindVertexArray(m.vao);
@@ -263,82 +355,728 @@ static void uploadPrimitive(const tinygltf::Model& model, const tinygltf::Primit
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
 
     glBindVertexArray(0);
+}
+
+static uint32_t packSnorm1010102(const float* v)
+{
+    auto q = [](float x)
+        {
+            x = std::max(-1.0f, std::min(1.0f, x));
+            return static_cast<uint32_t>(static_cast<int32_t>(std::lround(x * 511.0f))) & 0x3FFu;
+        };
+
+    return q(v[0]) | (q(v[1]) << 10) | (q(v[2]) << 20);
+}
+
+// Arena-ready copy of one primitive, built on a worker: interleaved vertices and indices already
+// narrowed to the type it will be drawn with.
+struct PackedPrimitive
+{
+    std::vector<PackedVertex> vertices;
+    std::vector<unsigned char> indexBytes;
+    GLenum indexType = GL_UNSIGNED_INT;
+};
+
+static void packPrimitive(const PrimitiveData& data, PackedPrimitive& out)
+{
+    size_t vertexCount = data.positions.size() / 3;
+
+    out.vertices.resize(vertexCount);
+
+    for (size_t i = 0; i < vertexCount; ++i)
+    {
+        PackedVertex& v = out.vertices[i];
+        v.position[0] = data.positions[i * 3 + 0];
+        v.position[1] = data.positions[i * 3 + 1];
+        v.position[2] = data.positions[i * 3 + 2];
+        v.normal = packSnorm1010102(&data.normals[i * 3]);
+        v.uv[0] = data.uvs[i * 2 + 0];
+        v.uv[1] = data.uvs[i * 2 + 1];
+    }
+
+    // Indices are relative to baseVertex, so 16 bits suffice whenever the primitive itself is small enough.
+    bool use16 = vertexCount <= 65536;
+    size_t indexSize = use16 ? sizeof(uint16_t) : sizeof(uint32_t);
+
+    out.indexBytes.resize(data.indices.size() * indexSize);
+
+    unsigned char* dst = out.indexBytes.data();
+
+    for (size_t i = 0; i < data.indices.size(); ++i)
+    {
+        if (use16)
+        {
+            uint16_t idx = static_cast<uint16_t>(data.indices[i]);
+            std::memcpy(dst + i * indexSize, &idx, indexSize);
+        }
+        else
+        {
+            uint32_t idx = data.indices[i];
+            std::memcpy(dst + i * indexSize, &idx, indexSize);
+        }
+    }
+
+    out.indexType = use16 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+}
+
+// Local AABB for culling over float xyz positions every stride bytes; stays at the origin for a
+// primitive with no vertices.
+static void computeBounds(const unsigned char* positions, size_t stride, size_t vertexCount, glm::vec3& outMin, glm::vec3& outMax)
+{
+    outMin = glm::vec3(0.0f);
+    outMax = glm::vec3(0.0f);
+
+    for (size_t i = 0; i < vertexCount; ++i)
+    {
+        glm::vec3 p;
+        std::memcpy(&p[0], positions + i * stride, sizeof(p));
+
+        outMin = (i == 0) ? p : glm::min(outMin, p);
+        outMax = (i == 0) ? p : glm::max(outMax, p);
+    }
+}
+
+// An accessor read in place from its glTF buffer: elements of elementBytes every stride bytes.
+struct AccessorSpan
+{
+    const unsigned char* data = nullptr;
+    size_t stride = 0;
+    size_t count = 0;
+    size_t bytes = 0;
+    int bufferView = -1;
+};
+
+// Accepts only what GL can consume as-is: not sparse, in range, and with the offset and stride
+// aligned to the component size.
+static bool describeAccessor(const tinygltf::Model& model, int accessorIndex, int componentType, int type, AccessorSpan& out)
+{
+    if (accessorIndex < 0 || accessorIndex >= static_cast<int>(model.accessors.size()))
+    {
+        return false;
+    }
+
+    const tinygltf::Accessor& acc = model.accessors[accessorIndex];
+
+    if (acc.sparse.isSparse || acc.componentType != componentType || acc.type != type || acc.count == 0 ||
+        acc.bufferView < 0 || acc.bufferView >= static_cast<int>(model.bufferViews.size()))
+    {
+        return false;
+    }
+
+    const tinygltf::BufferView& bv = model.bufferViews[acc.bufferView];
+
+    if (bv.buffer < 0 || bv.buffer >= static_cast<int>(model.buffers.size()))
+    {
+        return false;
+    }
+
+    const tinygltf::Buffer& b = model.buffers[bv.buffer];
+
+    size_t componentSize = static_cast<size_t>(tinygltf::GetComponentSizeInBytes(componentType));
+    size_t elementBytes = componentSize * static_cast<size_t>(tinygltf::GetNumComponentsInType(type));
+    size_t stride = (bv.byteStride > 0) ? bv.byteStride : elementBytes;
+    size_t start = bv.byteOffset + acc.byteOffset;
+    size_t bytes = (acc.count - 1) * stride + elementBytes;
+
+    if (stride < elementBytes || start % componentSize != 0 || stride % componentSize != 0 ||
+        acc.byteOffset + bytes > bv.byteLength || bv.byteOffset + bv.byteLength > b.data.size())
+    {
+        return false;
+    }
+
+    out.data = b.data.data() + start;
+    out.stride = stride;
+    out.count = acc.count;
+    out.bytes = bytes;
+    out.bufferView = acc.bufferView;
+
+    return true;
+}
+
+// A primitive whose buffers go to GL straight from the glTF buffers: float POSITION, NORMAL and
+// TEXCOORD_0 at any uniform stride, and tightly packed 16- or 32-bit indices in their native type.
+struct DirectPrimitive
+{
+    static constexpr int kAttributeCount = 3;
+
+    AccessorSpan attributes[kAttributeCount];
+    AccessorSpan indices;
+    GLenum indexType = GL_UNSIGNED_INT;
+};
+
+static bool describeDirectPrimitive(const tinygltf::Model& model, const tinygltf::Primitive& prim, DirectPrimitive& out)
+{
+    static const char* const kNames[DirectPrimitive::kAttributeCount] = { "POSITION", "NORMAL", "TEXCOORD_0" };
+    static const int kTypes[DirectPrimitive::kAttributeCount] = { TINYGLTF_TYPE_VEC3, TINYGLTF_TYPE_VEC3, TINYGLTF_TYPE_VEC2 };
+
+    // Missing normals or uvs would need a generic attribute value, which is context rather than VAO
+    // state; such primitives take the converting path, which fills in defaults.
+    for (int a = 0; a < DirectPrimitive::kAttributeCount; ++a)
+    {
+        auto it = prim.attributes.find(kNames[a]);
+
+        if (it == prim.attributes.end() || !describeAccessor(model, it->second, TINYGLTF_COMPONENT_TYPE_FLOAT, kTypes[a], out.attributes[a]))
+        {
+            return false;
+        }
+
+        if (out.attributes[a].count != out.attributes[0].count)
+        {
+            return false;
+        }
+    }
+
+    // 8-bit indices are legal in GL but slow on much hardware; the converting path widens them.
+    if (describeAccessor(model, prim.indices, TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT, TINYGLTF_TYPE_SCALAR, out.indices))
+    {
+        out.indexType = GL_UNSIGNED_SHORT;
+    }
+    else if (describeAccessor(model, prim.indices, TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT, TINYGLTF_TYPE_SCALAR, out.indices))
+    {
+        out.indexType = GL_UNSIGNED_INT;
+    }
+    else
+    {
+        return false;
+    }
+
+    size_t indexSize = (out.indexType == GL_UNSIGNED_SHORT) ? sizeof(uint16_t) : sizeof(uint32_t);
+
+    return out.indices.stride == indexSize;
+}
+
+// Attributes interleaved in one buffer view share a single buffer holding the span they cover, so an
+// interleaved view is uploaded once rather than once per attribute.
+static void uploadDirectPrimitive(const DirectPrimitive& p, GpuMesh& m)
+{
+    static const GLint kComponents[DirectPrimitive::kAttributeCount] = { 3, 3, 2 };
+
+    GLuint* vbos[DirectPrimitive::kAttributeCount] = { &m.vboPos, &m.vboNor, &m.vboUv };
+    GLuint buffers[DirectPrimitive::kAttributeCount] = {};
+    const unsigned char* bases[DirectPrimitive::kAttributeCount] = {};
+
+    glGenVertexArrays(1, &m.vao);
+    glBindVertexArray(m.vao);
+
+    for (int a = 0; a < DirectPrimitive::kAttributeCount; ++a)
+    {
+        const AccessorSpan& span = p.attributes[a];
+
+        int owner = a;
+
+        for (int b = 0; b < a; ++b)
+        {
+            if (p.attributes[b].bufferView == span.bufferView)
+            {
+                owner = b;
+                break;
+            }
+        }
+
+        if (owner == a)
+        {
+            const unsigned char* begin = span.data;
+            const unsigned char* end = span.data + span.bytes;
+
+            for (int b = a + 1; b < DirectPrimitive::kAttributeCount; ++b)
+            {
+                if (p.attributes[b].bufferView == span.bufferView)
+                {
+                    begin = std::min(begin, p.attributes[b].data);
+                    end = std::max(end, p.attributes[b].data + p.attributes[b].bytes);
+                }
+            }
+
+            glGenBuffers(1, vbos[a]);
+            glBindBuffer(GL_ARRAY_BUFFER, *vbos[a]);
+            glBufferData(GL_ARRAY_BUFFER, end - begin, begin, GL_STATIC_DRAW);
+
+            buffers[a] = *vbos[a];
+            bases[a] = begin;
+        }
+        else
+        {
+            buffers[a] = buffers[owner];
+            bases[a] = bases[owner];
+
+            glBindBuffer(GL_ARRAY_BUFFER, buffers[a]);
+        }
+
+        glVertexAttribPointer(a, kComponents[a], GL_FLOAT, GL_FALSE, static_cast<GLsizei>(span.stride), reinterpret_cast<const void*>(span.data - bases[a]));
+        glEnableVertexAttribArray(a);
+    }
+
+    glGenBuffers(1, &m.ebo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m.ebo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, p.indices.bytes, p.indices.data, GL_STATIC_DRAW);
 
-    m.indexCount = static_cast<GLsizei>(indices.size());
-    m.textureId = textureId;
+    m.indexType = p.indexType;
+    m.indexOffset = 0;
 
-    outMeshes.push_back(m);
+    glBindVertexArray(0);
 }
 
-static GLuint resolveBaseColorTexture(const tinygltf::Model& model, const std::unordered_map<int, GLuint>& imageIndexToGlTex, int materialIndex)
+static int resolveBaseColorImage(const tinygltf::Model& model, int materialIndex)
 {
     if (materialIndex < 0 || materialIndex >= static_cast<int>(model.materials.size()))
     {
-        return 0;
+        return -1;
     }
 
     const tinygltf::Material& mat = model.materials[materialIndex];
 
     if (mat.pbrMetallicRoughness.baseColorTexture.index < 0)
     {
-        return 0;
+        return -1;
     }
 
     int texIndex = mat.pbrMetallicRoughness.baseColorTexture.index;
 
     if (texIndex < 0 || texIndex >= static_cast<int>(model.textures.size()))
     {
-        return 0;
+        return -1;
+    }
+
+    return model.textures[texIndex].source;
+}
+
+// Everything the GL thread needs for one primitive, produced off it.
+struct PrimitiveJob
+{
+    const tinygltf::Primitive* primitive = nullptr;
+
+    bool ok = false;
+    int imageIndex = -1;
+    int textureIndex = -1;
+
+    // Draw parameters and bounds; the GL names are filled in during upload.
+    GpuMesh mesh;
+
+    // Per-buffer path keeps either the in-place description (direct) or the converted arrays until
+    // upload; the arena path keeps the packed copy until layoutArena moves it into the shared builder.
+    bool direct = false;
+    DirectPrimitive directData;
+    PrimitiveData data;
+    PackedPrimitive packed;
+
+    std::shared_ptr<const MeshBvh> bvh;
+
+    meshOptimizer::Stats optimizeStats;
+};
+
+// Each level is simplified from the previous one; a level that barely shrinks (everything left is
+// locked) ends the chain.
+static constexpr size_t kLodMinTriangles = 64;
+static constexpr double kLodMinReduction = 0.85;
+
+// Appends the simplified levels' indices after the full ones and records their ranges in mesh.
+static void generateLods(PrimitiveData& data, GpuMesh& mesh)
+{
+    size_t vertexCount = data.positions.size() / 3;
+    std::vector<unsigned int> previous = data.indices;
+    float error = 0.0f;
+
+    mesh.lodCount = 1;
+
+    for (int level = 1; level < GpuMesh::kMaxLods; ++level)
+    {
+        if (previous.size() / 3 < kLodMinTriangles)
+        {
+            break;
+        }
+
+        float levelError = 0.0f;
+        std::vector<unsigned int> lod = meshSimplifier::simplify(data.positions.data(), vertexCount, previous, previous.size() / 6 * 3, std::numeric_limits<float>::max(), &levelError);
+
+        if (static_cast<double>(lod.size()) > static_cast<double>(previous.size()) * kLodMinReduction)
+        {
+            break;
+        }
+
+        meshOptimizer::optimizeVertexCache(lod, vertexCount);
+
+        // Errors of successive simplifications add up at worst.
+        error += levelError;
+
+        GpuMeshLod& out = mesh.lods[level - 1];
+        out.indexCount = static_cast<GLsizei>(lod.size());
+        out.firstIndex = static_cast<GLsizei>(data.indices.size());
+        out.error = error;
+
+        data.indices.insert(data.indices.end(), lod.begin(), lod.end());
+        mesh.lodCount = level + 1;
+
+        previous.swap(lod);
+    }
+}
+
+static void convertPrimitive(const tinygltf::Model& model, const ModelLoader::LoadOptions& options, PrimitiveJob& job)
+{
+    bool packArena = options.packMeshArena;
+    bool buildPickBvh = options.buildPickBvh;
+
+    // Per-buffer meshes read GL-ready accessors in place: no float copies and no index widening.
+    if (!packArena && !options.optimizeMeshes && !options.generateLods && describeDirectPrimitive(model, *job.primitive, job.directData))
+    {
+        const AccessorSpan& positions = job.directData.attributes[0];
+        const AccessorSpan& indices = job.directData.indices;
+
+        job.ok = true;
+        job.direct = true;
+        job.imageIndex = resolveBaseColorImage(model, job.primitive->material);
+        job.mesh.indexCount = static_cast<GLsizei>(indices.count);
+        computeBounds(positions.data, positions.stride, positions.count, job.mesh.boundsMin, job.mesh.boundsMax);
+
+        if (buildPickBvh)
+        {
+            std::shared_ptr<MeshBvh> bvh = std::make_shared<MeshBvh>();
+            bvh->build(positions.data, positions.stride, positions.count, indices.data, indices.stride, indices.count);
+            job.bvh = bvh;
+        }
+
+        return;
+    }
+
+    job.ok = readPrimitive(model, *job.primitive, job.data);
+
+    if (!job.ok)
+    {
+        return;
+    }
+
+    job.imageIndex = resolveBaseColorImage(model, job.primitive->material);
+
+    // Before bounds and BVH, so both see the final vertex and triangle order.
+    if (options.optimizeMeshes)
+    {
+        meshOptimizer::optimize(job.data.positions, job.data.normals, job.data.uvs, job.data.indices, options.measureMeshStats ? &job.optimizeStats : nullptr);
+    }
+
+    job.mesh.indexCount = static_cast<GLsizei>(job.data.indices.size());
+    computeBounds(reinterpret_cast<const unsigned char*>(job.data.positions.data()), 3 * sizeof(float), job.data.positions.size() / 3, job.mesh.boundsMin, job.mesh.boundsMax);
+
+    if (buildPickBvh)
+    {
+        std::shared_ptr<MeshBvh> bvh = std::make_shared<MeshBvh>();
+        bvh->build(job.data.positions.data(), job.data.positions.size() / 3, job.data.indices.data(), job.data.indices.size());
+        job.bvh = bvh;
     }
 
-    int imgIndex = model.textures[texIndex].source;
-    auto it = imageIndexToGlTex.find(imgIndex);
+    // After the BVH, which only covers the full-detail triangles.
+    if (options.generateLods)
+    {
+        generateLods(job.data, job.mesh);
+    }
 
-    if (it == imageIndexToGlTex.end())
+    if (packArena)
     {
-        return 0;
+        packPrimitive(job.data, job.packed);
+        job.data = PrimitiveData();
     }
+}
+
+// Packs every primitive back to back; serial, since each offset depends on all earlier primitives.
+static void layoutArena(std::vector<PrimitiveJob>& jobs, MeshArenaBuilder& arena)
+{
+    for (PrimitiveJob& job : jobs)
+    {
+        GpuMesh& m = job.mesh;
+        m.inArena = true;
+        m.baseVertex = static_cast<GLint>(arena.vertices.size());
+
+        arena.vertices.insert(arena.vertices.end(), job.packed.vertices.begin(), job.packed.vertices.end());
+
+        size_t indexSize = (job.packed.indexType == GL_UNSIGNED_SHORT) ? sizeof(uint16_t) : sizeof(uint32_t);
+        size_t offset = (arena.indexBytes.size() + indexSize - 1) / indexSize * indexSize;
+
+        arena.indexBytes.resize(offset);
+        arena.indexBytes.insert(arena.indexBytes.end(), job.packed.indexBytes.begin(), job.packed.indexBytes.end());
+
+        m.indexType = job.packed.indexType;
+        m.indexOffset = offset;
+
+        job.packed = PackedPrimitive();
+    }
+}
+
+// Creates the arena VAO and sizes its buffers; the contents follow in chunks.
+static GpuMeshArena createArena(size_t vertexCount, size_t indexBytes)
+{
+    GpuMeshArena arena;
+    arena.vertexCount = vertexCount;
+    arena.indexBytes = indexBytes;
 
-    return it->second;
+    glGenVertexArrays(1, &arena.vao);
+    glBindVertexArray(arena.vao);
+
+    glGenBuffers(1, &arena.vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, arena.vbo);
+    glBufferData(GL_ARRAY_BUFFER, vertexCount * sizeof(PackedVertex), nullptr, GL_STATIC_DRAW);
+
+    GLsizei stride = static_cast<GLsizei>(sizeof(PackedVertex));
+
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<const void*>(offsetof(PackedVertex, position)));
+    glEnableVertexAttribArray(0);
+
+    glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride, reinterpret_cast<const void*>(offsetof(PackedVertex, normal)));
+    glEnableVertexAttribArray(1);
+
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<const void*>(offsetof(PackedVertex, uv)));
+    glEnableVertexAttribArray(2);
+
+    glGenBuffers(1, &arena.ebo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, arena.ebo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexBytes, nullptr, GL_STATIC_DRAW);
+
+    glBindVertexArray(0);
+
+    return arena;
 }
 
-static std::shared_ptr<SceneNode> buildNodeRecursive(
-    const tinygltf::Model& model,
-    const std::unordered_map<int, GLuint>& imageIndexToGlTex,
-    int nodeIndex)
+// Pre-order, primitives of a node before its children: the order finishPreparedModel consumes them in.
+static void collectNodesRecursive(const tinygltf::Model& model, int nodeIndex, int parent, std::vector<modelCache::NodeRecord>& outNodes, std::vector<PrimitiveJob>& outJobs)
 {
     const tinygltf::Node& n = model.nodes[nodeIndex];
 
-    std::shared_ptr<SceneNode> out = std::make_shared<SceneNode>();
-    out->name = n.name;
-    out->localTransform = nodeLocalTransform(n);
+    int index = static_cast<int>(outNodes.size());
+
+    outNodes.emplace_back();
+    outNodes.back().name = n.name;
+    outNodes.back().localTransform = nodeLocalTransform(n);
+    outNodes.back().parent = parent;
 
     if (n.mesh >= 0 && n.mesh < static_cast<int>(model.meshes.size()))
     {
-        const tinygltf::Mesh& mesh = model.meshes[n.mesh];
-
-        for (int p = 0; p < static_cast<int>(mesh.primitives.size()); ++p)
+        for (const tinygltf::Primitive& prim : model.meshes[n.mesh].primitives)
         {
-            const tinygltf::Primitive& prim = mesh.primitives[p];
+            outJobs.emplace_back();
+            outJobs.back().primitive = &prim;
+            ++outNodes.back().meshCount;
+        }
+    }
+
+    for (int childIndex : n.children)
+    {
+        collectNodesRecursive(model, childIndex, index, outNodes, outJobs);
+    }
+}
+
+// Drops primitives that failed to convert, so every remaining job becomes a mesh.
+static void removeFailedPrimitives(std::vector<modelCache::NodeRecord>& nodes, std::vector<PrimitiveJob>& jobs)
+{
+    size_t read = 0;
+    size_t write = 0;
 
-            GLuint texId = resolveBaseColorTexture(model, imageIndexToGlTex, prim.material);
-            uploadPrimitive(model, prim, texId, out->meshes);
+    for (modelCache::NodeRecord& node : nodes)
+    {
+        int kept = 0;
+
+        for (int p = 0; p < node.meshCount; ++p, ++read)
+        {
+            if (jobs[read].ok)
+            {
+                if (write != read)
+                {
+                    jobs[write] = std::move(jobs[read]);
+                }
+
+                ++write;
+                ++kept;
+            }
         }
+
+        node.meshCount = kept;
+    }
+
+    jobs.resize(write);
+}
+
+// One GL texture's worth of pixels: a decoded glTF image (level 0 only, mipmaps generated on the GPU)
+// or a full precomputed chain, owned here or pointing into the mapped cache.
+struct PendingTexture
+{
+    modelCache::TextureRecord record;
+    std::vector<unsigned char> pixels;
+};
+
+// Arena bytes copied per upload step, so one large model cannot blow a frame's budget in a single call.
+static constexpr size_t kArenaUploadChunkBytes = size_t(4) << 20;
+
+static bool isGlbPath(const std::string& path)
+{
+    return path.size() >= 4 && path.substr(path.size() - 4) == ".glb";
+}
+
+struct ModelLoader::PendingModel
+{
+    enum class Stage
+    {
+        Textures,
+        Primitives,
+        ArenaVertices,
+        ArenaIndices,
+        Done
+    };
+
+    bool packMeshArena = true;
+
+    // Pre-order; node i owns the next nodes[i].meshCount jobs.
+    std::vector<modelCache::NodeRecord> nodes;
+    std::vector<PrimitiveJob> jobs;
+    std::vector<PendingTexture> textures;
+
+    // glTF buffers that direct primitives upload from; released once the primitives are on the GPU.
+    std::vector<tinygltf::Buffer> sourceBuffers;
+
+    // Arena contents, in arenaBuilder or in cacheFile.
+    MeshArenaBuilder arenaBuilder;
+    MappedFile cacheFile;
+    const unsigned char* vertexBytes = nullptr;
+    size_t vertexCount = 0;
+    const unsigned char* indexBytes = nullptr;
+    size_t indexByteCount = 0;
+
+    // GL objects created so far, owned here until finishPreparedModel hands them to the scene.
+    GpuMeshArena arena;
+    std::vector<GLuint> textureIds;
+
+    Stage stage = Stage::Textures;
+    size_t cursor = 0;
+
+    LoadStats stats;
+};
+
+// Warm path: everything comes out of the mapped cache file, ready to upload.
+static bool readModelCache(ModelLoader::PendingModel& pending, const std::string& cachePath, uint64_t sourceHash, uint64_t sourceSize, bool buildPickBvh, bool optimizeMeshes, bool generateLods)
+{
+    if (!pending.cacheFile.open(cachePath))
+    {
+        return false;
+    }
+
+    modelCache::Contents contents;
+
+    if (!modelCache::read(pending.cacheFile, sourceHash, sourceSize, sizeof(PackedVertex), buildPickBvh, optimizeMeshes, generateLods, contents))
+    {
+        pending.cacheFile.close();
+
+        logging::print("Ignoring stale or damaged model cache: %s\n", cachePath.c_str());
+
+        return false;
+    }
+
+    pending.nodes = std::move(contents.nodes);
+
+    pending.jobs.resize(contents.meshes.size());
+
+    for (size_t i = 0; i < contents.meshes.size(); ++i)
+    {
+        PrimitiveJob& job = pending.jobs[i];
+        job.ok = true;
+        job.mesh = contents.meshes[i].mesh;
+        job.textureIndex = contents.meshes[i].textureIndex;
+        job.bvh = contents.meshes[i].bvh;
+    }
+
+    pending.textures.resize(contents.textures.size());
+
+    for (size_t i = 0; i < contents.textures.size(); ++i)
+    {
+        pending.textures[i].record = contents.textures[i];
+    }
+
+    pending.vertexBytes = contents.vertexData;
+    pending.vertexCount = contents.vertexCount;
+    pending.indexBytes = contents.indexData;
+    pending.indexByteCount = contents.indexByteCount;
+
+    return true;
+}
+
+static bool writeModelCache(const ModelLoader::PendingModel& pending, const std::string& cachePath, uint64_t sourceHash, uint64_t sourceSize, bool hasPickBvh, bool optimizedMeshes, bool meshLods)
+{
+    modelCache::Contents contents;
+    contents.sourceHash = sourceHash;
+    contents.sourceSize = sourceSize;
+    contents.nodes = pending.nodes;
+    contents.vertexData = pending.vertexBytes;
+    contents.vertexCount = pending.vertexCount;
+    contents.vertexStride = sizeof(PackedVertex);
+    contents.indexData = pending.indexBytes;
+    contents.indexByteCount = pending.indexByteCount;
+    contents.hasPickBvh = hasPickBvh;
+    contents.optimizedMeshes = optimizedMeshes;
+    contents.meshLods = meshLods;
+
+    contents.meshes.resize(pending.jobs.size());
+
+    for (size_t i = 0; i < pending.jobs.size(); ++i)
+    {
+        contents.meshes[i].mesh = pending.jobs[i].mesh;
+        contents.meshes[i].textureIndex = pending.jobs[i].textureIndex;
+        contents.meshes[i].bvh = pending.jobs[i].bvh;
     }
 
-    for (int i = 0; i < static_cast<int>(n.children.size()); ++i)
+    for (const PendingTexture& texture : pending.textures)
     {
-        int childIndex = n.children[i];
-        out->children.push_back(buildNodeRecursive(model, imageIndexToGlTex, childIndex));
+        contents.textures.push_back(texture.record);
     }
 
-    return out;
+    return modelCache::write(cachePath, contents);
 }
 
-std::shared_ptr<SceneNode> ModelLoader::loadGlbOrGltf(const std::string& path)
+static void countLodTriangles(const std::vector<PrimitiveJob>& jobs, ModelLoader::LoadStats& stats)
 {
+    for (const PrimitiveJob& job : jobs)
+    {
+        for (int level = 0; level < GpuMesh::kMaxLods; ++level)
+        {
+            stats.lodTriangles[level] += static_cast<uint64_t>(job.mesh.getLodIndexCount(std::min(level, job.mesh.lodCount - 1)) / 3);
+        }
+    }
+}
+
+std::shared_ptr<ModelLoader::PendingModel> ModelLoader::prepareModel(const std::string& path, const LoadOptions& options)
+{
+    std::shared_ptr<PendingModel> pending = std::make_shared<PendingModel>();
+    pending->packMeshArena = options.packMeshArena;
+
+    LoadStats& stats = pending->stats;
+    stats.threadCount = options.pool ? options.pool->getThreadCount() : 1;
+
+    auto stageStart = std::chrono::high_resolution_clock::now();
+
+    // A .glb is self-contained, so its bytes alone key the cache; .gltf files with external buffers
+    // and images always load from source.
+    MappedFile source;
+    bool useCache = !options.cacheDir.empty() && options.packMeshArena && isGlbPath(path) && source.open(path);
+
+    uint64_t sourceHash = 0;
+    std::string cachePath;
+
+    if (useCache)
+    {
+        sourceHash = modelCache::hashBytes(source.getData(), source.getSize());
+        cachePath = modelCache::getCachePath(options.cacheDir, path, sourceHash);
+
+        if (readModelCache(*pending, cachePath, sourceHash, source.getSize(), options.buildPickBvh, options.optimizeMeshes, options.generateLods))
+        {
+            stats.cacheHit = true;
+            stats.imageCount = static_cast<int>(pending->textures.size());
+            stats.primitiveCount = static_cast<int>(pending->jobs.size());
+            stats.parseMs = millisecondsSince(stageStart);
+            countLodTriangles(pending->jobs, stats);
+            pending->textureIds.assign(pending->textures.size(), 0);
+
+            return pending;
+        }
+    }
+
+    // Parse, keeping images encoded.
+    EncodedImages encodedImages;
+
     tinygltf::TinyGLTF loader;
-    loader.SetImageLoader(loadImageDataWithStb, nullptr);
+    loader.SetImageLoader(captureEncodedImage, &encodedImages);
 
     tinygltf::Model model;
     std::string err;
@@ -346,7 +1084,13 @@ std::shared_ptr<SceneNode> ModelLoader::loadGlbOrGltf(const std::string& path)
 
     bool ok = false;
 
-    if (path.size() >= 4 && path.substr(path.size() - 4) == ".glb")
+    if (useCache)
+    {
+        // Already mapped for the hash; parse from there instead of reading the file again.
+        std::string baseDir = std::filesystem::path(path).parent_path().string();
+        ok = loader.LoadBinaryFromMemory(&model, &err, &warn, source.getData(), static_cast<unsigned int>(source.getSize()), baseDir);
+    }
+    else if (isGlbPath(path))
     {
         ok = loader.LoadBinaryFromFile(&model, &err, &warn, path);
     }
@@ -357,33 +1101,111 @@ std::shared_ptr<SceneNode> ModelLoader::loadGlbOrGltf(const std::string& path)
 
     if (!warn.empty())
     {
-        std::cout << "tinygltf warn: " << warn << "\n";
+        logging::print("tinygltf warn: %s\n", warn.c_str());
     }
 
     if (!ok)
     {
-        std::cout << "tinygltf error: " << err << "\n";
+        logging::print("tinygltf error: %s\n", err.c_str());
+        return nullptr;
+    }
+
+    if (model.scenes.empty())
+    {
         return nullptr;
     }
 
-    std::unordered_map<int, GLuint> imageIndexToGlTex;
+    stats.parseMs = millisecondsSince(stageStart);
+
+    // Decode every image and hash its pixels; with the cache on, also build the mip chains it stores.
+    stageStart = std::chrono::high_resolution_clock::now();
+
+    encodedImages.resize(model.images.size());
+
+    std::vector<unsigned char> decodeOk(model.images.size(), 1);
+    std::vector<uint64_t> imageHashes(model.images.size(), 0);
 
-    for (int i = 0; i < static_cast<int>(model.images.size()); ++i)
+    forEachItem(options.pool, static_cast<int>(model.images.size()), [&](int i)
     {
+        if (!encodedImages[i].empty())
+        {
+            decodeOk[i] = decodeImage(encodedImages[i], model.images[i]) ? 1 : 0;
+            encodedImages[i] = std::vector<unsigned char>();
+        }
+
         const tinygltf::Image& img = model.images[i];
+
+        if (decodeOk[i] && !img.image.empty())
+        {
+            uint64_t dims = (static_cast<uint64_t>(img.width) << 32) | static_cast<uint32_t>(img.height);
+            imageHashes[i] = modelCache::hashBytes(img.image.data(), img.image.size()) ^ (dims * 0x9E3779B97F4A7C15ull);
+        }
+    });
+
+    for (size_t i = 0; i < decodeOk.size(); ++i)
+    {
+        if (!decodeOk[i])
+        {
+            logging::print("tinygltf error: stb_image failed to decode image[%zu]\n", i);
+            return nullptr;
+        }
+    }
+
+    // Identical images (same size and pixels) share one texture.
+    std::vector<int> textureOfImage(model.images.size(), -1);
+    std::unordered_map<uint64_t, int> textureOfHash;
+
+    for (size_t i = 0; i < model.images.size(); ++i)
+    {
+        tinygltf::Image& img = model.images[i];
+
         if (img.image.empty() || img.width <= 0 || img.height <= 0)
         {
             continue;
         }
 
-        GLuint tex = textureLoader::createTextureFromRgba8(img.width, img.height, img.image.data(), true);
-        imageIndexToGlTex[i] = tex;
+        auto it = textureOfHash.find(imageHashes[i]);
+
+        if (it != textureOfHash.end())
+        {
+            textureOfImage[i] = it->second;
+            continue;
+        }
+
+        int t = static_cast<int>(pending->textures.size());
+        textureOfHash.emplace(imageHashes[i], t);
+        textureOfImage[i] = t;
+
+        pending->textures.emplace_back();
+
+        PendingTexture& texture = pending->textures.back();
+        texture.record.width = img.width;
+        texture.record.height = img.height;
+        texture.record.levelCount = 1;
+        texture.record.contentHash = imageHashes[i];
+        texture.pixels = std::move(img.image);
     }
 
-    if (model.scenes.empty())
+    forEachItem(options.pool, static_cast<int>(pending->textures.size()), [&](int t)
     {
-        return nullptr;
-    }
+        PendingTexture& texture = pending->textures[t];
+
+        if (useCache)
+        {
+            std::vector<unsigned char> levels;
+            texture.record.levelCount = textureLoader::buildMipChain(texture.record.width, texture.record.height, texture.pixels.data(), levels);
+            texture.pixels = std::move(levels);
+        }
+
+        texture.record.pixels = texture.pixels.data();
+        texture.record.pixelBytes = texture.pixels.size();
+    });
+
+    stats.imageCount = static_cast<int>(pending->textures.size());
+    stats.decodeMs = millisecondsSince(stageStart);
+
+    // Convert accessors into vertex / index arrays, bounds, arena layout and pick BVHs.
+    stageStart = std::chrono::high_resolution_clock::now();
 
     int sceneIndex = (model.defaultScene >= 0) ? model.defaultScene : 0;
 
@@ -394,20 +1216,287 @@ std::shared_ptr<SceneNode> ModelLoader::loadGlbOrGltf(const std::string& path)
 
     const tinygltf::Scene& scene = model.scenes[sceneIndex];
 
-    std::shared_ptr<SceneNode> root = std::make_shared<SceneNode>();
-    root->name = "root";
-    root->localTransform = glm::mat4(1.0f);
+    modelCache::NodeRecord root;
+    root.name = "root";
+    pending->nodes.push_back(root);
 
     for (int i = 0; i < static_cast<int>(scene.nodes.size()); ++i)
     {
-        root->children.push_back(buildNodeRecursive(model, imageIndexToGlTex, scene.nodes[i]));
+        collectNodesRecursive(model, scene.nodes[i], 0, pending->nodes, pending->jobs);
+    }
+
+    std::vector<PrimitiveJob>& jobs = pending->jobs;
+
+    forEachItem(options.pool, static_cast<int>(jobs.size()), [&](int i)
+    {
+        convertPrimitive(model, options, jobs[i]);
+    });
+
+    removeFailedPrimitives(pending->nodes, jobs);
+
+    for (PrimitiveJob& job : jobs)
+    {
+        job.textureIndex = (job.imageIndex >= 0 && job.imageIndex < static_cast<int>(textureOfImage.size())) ? textureOfImage[job.imageIndex] : -1;
+        job.primitive = nullptr;
+    }
+
+    if (options.packMeshArena)
+    {
+        layoutArena(jobs, pending->arenaBuilder);
+
+        pending->vertexBytes = reinterpret_cast<const unsigned char*>(pending->arenaBuilder.vertices.data());
+        pending->vertexCount = pending->arenaBuilder.vertices.size();
+        pending->indexBytes = pending->arenaBuilder.indexBytes.data();
+        pending->indexByteCount = pending->arenaBuilder.indexBytes.size();
+    }
+
+    stats.primitiveCount = static_cast<int>(jobs.size());
+    countLodTriangles(jobs, stats);
+
+    for (const PrimitiveJob& job : jobs)
+    {
+        stats.zeroCopyPrimitiveCount += job.direct ? 1 : 0;
+        stats.meshStats.add(job.optimizeStats);
+    }
+
+    // Direct primitives point into the buffers' heap storage, which the move leaves in place.
+    if (stats.zeroCopyPrimitiveCount > 0)
+    {
+        pending->sourceBuffers = std::move(model.buffers);
+    }
+
+    stats.convertMs = millisecondsSince(stageStart);
+
+    if (useCache)
+    {
+        stageStart = std::chrono::high_resolution_clock::now();
+
+        if (!writeModelCache(*pending, cachePath, sourceHash, source.getSize(), options.buildPickBvh, options.optimizeMeshes, options.generateLods))
+        {
+            logging::print("Failed to write model cache: %s\n", cachePath.c_str());
+        }
+
+        stats.cacheWriteMs = millisecondsSince(stageStart);
+    }
+
+    pending->textureIds.assign(pending->textures.size(), 0);
+
+    return pending;
+}
+
+bool ModelLoader::uploadPreparedModel(PendingModel& pending, double budgetMs)
+{
+    using Stage = PendingModel::Stage;
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    // At least one item per call, so any budget makes progress.
+    do
+    {
+        switch (pending.stage)
+        {
+        case Stage::Textures:
+        {
+            if (pending.cursor >= pending.textures.size())
+            {
+                pending.stage = pending.packMeshArena ? Stage::ArenaVertices : Stage::Primitives;
+                pending.cursor = 0;
+                break;
+            }
+
+            PendingTexture& texture = pending.textures[pending.cursor];
+            const modelCache::TextureRecord& r = texture.record;
+
+            if (r.levelCount > 1)
+            {
+                pending.textureIds[pending.cursor] = textureLoader::createTextureFromRgba8Levels(r.width, r.height, r.levelCount, r.pixels);
+            }
+            else
+            {
+                pending.textureIds[pending.cursor] = textureLoader::createTextureFromRgba8(r.width, r.height, r.pixels, true);
+            }
+
+            texture.pixels = std::vector<unsigned char>();
+            texture.record.pixels = nullptr;
+
+            ++pending.cursor;
+            break;
+        }
+        case Stage::Primitives:
+        {
+            if (pending.cursor >= pending.jobs.size())
+            {
+                pending.sourceBuffers.clear();
+                pending.stage = Stage::Done;
+                break;
+            }
+
+            PrimitiveJob& job = pending.jobs[pending.cursor++];
+
+            if (job.direct)
+            {
+                uploadDirectPrimitive(job.directData, job.mesh);
+            }
+            else
+            {
+                uploadPrimitive(job.data, job.mesh);
+                job.data = PrimitiveData();
+            }
+
+            break;
+        }
+        case Stage::ArenaVertices:
+        case Stage::ArenaIndices:
+        {
+            bool vertices = pending.stage == Stage::ArenaVertices;
+
+            if (vertices && pending.arena.vao == 0)
+            {
+                pending.arena = createArena(pending.vertexCount, pending.indexByteCount);
+            }
+
+            const unsigned char* source = vertices ? pending.vertexBytes : pending.indexBytes;
+            size_t total = vertices ? pending.vertexCount * sizeof(PackedVertex) : pending.indexByteCount;
+            size_t bytes = std::min(kArenaUploadChunkBytes, total - pending.cursor);
+
+            if (bytes > 0)
+            {
+                // Indices go through the copy target so no VAO's element binding is disturbed.
+                GLenum target = vertices ? GL_ARRAY_BUFFER : GL_COPY_WRITE_BUFFER;
+
+                glBindBuffer(target, vertices ? pending.arena.vbo : pending.arena.ebo);
+                glBufferSubData(target, static_cast<GLintptr>(pending.cursor), static_cast<GLsizeiptr>(bytes), source + pending.cursor);
+                glBindBuffer(target, 0);
+
+                pending.cursor += bytes;
+            }
+
+            if (pending.cursor >= total)
+            {
+                pending.stage = vertices ? Stage::ArenaIndices : Stage::Done;
+                pending.cursor = 0;
+            }
+
+            break;
+        }
+        case Stage::Done:
+            break;
+        }
+    }
+    while (pending.stage != PendingModel::Stage::Done && millisecondsSince(start) < budgetMs);
+
+    pending.stats.uploadMs += millisecondsSince(start);
+    ++pending.stats.uploadSteps;
+
+    return pending.stage == PendingModel::Stage::Done;
+}
+
+std::shared_ptr<SceneNode> ModelLoader::finishPreparedModel(PendingModel& pending, std::shared_ptr<FlatScene>& outFlatScene, LoadStats* outStats)
+{
+    outFlatScene.reset();
+
+    if (pending.stage != PendingModel::Stage::Done || pending.nodes.empty())
+    {
+        return nullptr;
+    }
+
+    // Parents precede children, so each node can be attached as soon as it is built.
+    std::vector<std::shared_ptr<SceneNode>> built(pending.nodes.size());
+    size_t nextJob = 0;
+
+    for (size_t i = 0; i < pending.nodes.size(); ++i)
+    {
+        const modelCache::NodeRecord& record = pending.nodes[i];
+
+        std::shared_ptr<SceneNode> node = std::make_shared<SceneNode>();
+        node->name = record.name;
+        node->localTransform = record.localTransform;
+
+        for (int p = 0; p < record.meshCount; ++p)
+        {
+            const PrimitiveJob& job = pending.jobs[nextJob++];
+
+            GpuMesh mesh = job.mesh;
+            mesh.textureId = (job.textureIndex >= 0) ? pending.textureIds[job.textureIndex] : 0;
+
+            if (mesh.inArena)
+            {
+                mesh.vao = pending.arena.vao;
+            }
+
+            node->meshes.push_back(mesh);
+
+            if (job.bvh)
+            {
+                node->meshBvhs.push_back(job.bvh);
+            }
+        }
+
+        if (record.parent >= 0)
+        {
+            built[record.parent]->children.push_back(node);
+        }
+
+        built[i] = node;
+    }
+
+    std::shared_ptr<SceneNode> root = built[0];
+
+    outFlatScene = sceneGraph::flatten(root);
+    outFlatScene->arena = pending.arena;
+
+    for (GLuint tex : pending.textureIds)
+    {
+        if (tex != 0)
+        {
+            outFlatScene->textures.push_back(tex);
+        }
+    }
+
+    // Ownership has moved to the scene.
+    pending.arena = GpuMeshArena();
+    pending.textureIds.clear();
+    pending.jobs.clear();
+    pending.sourceBuffers.clear();
+    pending.cacheFile.close();
+
+    LoadStats& stats = pending.stats;
+    stats.totalMs = stats.parseMs + stats.decodeMs + stats.convertMs + stats.cacheWriteMs + stats.uploadMs;
+
+    if (outStats)
+    {
+        *outStats = stats;
     }
 
     return root;
 }
 
+std::shared_ptr<SceneNode> ModelLoader::loadGlbOrGltf(const std::string& path, std::shared_ptr<FlatScene>& outFlatScene, const LoadOptions& options, LoadStats* outStats)
+{
+    outFlatScene.reset();
+
+    std::shared_ptr<PendingModel> pending = prepareModel(path, options);
+
+    if (!pending)
+    {
+        return nullptr;
+    }
+
+    uploadPreparedModel(*pending, std::numeric_limits<double>::infinity());
+
+    return finishPreparedModel(*pending, outFlatScene, outStats);
+}
+
 static void destroyMesh(GpuMesh& m)
 {
+    if (m.inArena)
+    {
+        m.vao = 0;
+        m.indexCount = 0;
+
+        return;
+    }
+
     if (m.ebo != 0) glDeleteBuffers(1, &m.ebo);
     if (m.vboUv != 0) glDeleteBuffers(1, &m.vboUv);
     if (m.vboNor != 0) glDeleteBuffers(1, &m.vboNor);
@@ -440,4 +1529,59 @@ void ModelLoader::destroyNodeGpu(std::shared_ptr<SceneNode>& node)
     }
 
     node.reset();
+}
+
+void ModelLoader::destroyFlatSceneGpu(std::shared_ptr<FlatScene>& flat)
+{
+    if (!flat)
+    {
+        return;
+    }
+
+    GpuMeshArena& arena = flat->arena;
+
+    if (arena.ebo != 0) glDeleteBuffers(1, &arena.ebo);
+    if (arena.vbo != 0) glDeleteBuffers(1, &arena.vbo);
+    if (arena.vao != 0) glDeleteVertexArrays(1, &arena.vao);
+
+    arena = GpuMeshArena();
+
+    if (!flat->textures.empty())
+    {
+        glDeleteTextures(static_cast<GLsizei>(flat->textures.size()), flat->textures.data());
+    }
+
+    flat->textures.clear();
+
+    flat.reset();
+}
+
+void ModelLoader::discardPreparedModel(PendingModel& pending)
+{
+    for (PrimitiveJob& job : pending.jobs)
+    {
+        destroyMesh(job.mesh);
+    }
+
+    GpuMeshArena& arena = pending.arena;
+
+    if (arena.ebo != 0) glDeleteBuffers(1, &arena.ebo);
+    if (arena.vbo != 0) glDeleteBuffers(1, &arena.vbo);
+    if (arena.vao != 0) glDeleteVertexArrays(1, &arena.vao);
+
+    arena = GpuMeshArena();
+
+    for (GLuint tex : pending.textureIds)
+    {
+        if (tex != 0)
+        {
+            glDeleteTextures(1, &tex);
+        }
+    }
+
+    pending.textureIds.clear();
+    pending.jobs.clear();
+    pending.sourceBuffers.clear();
+    pending.cacheFile.close();
+    pending.stage = PendingModel::Stage::Done;
 }
\ No newline at end of file
@@ -4,6 +4,8 @@
 #include <memory>
 
 #include "../scene/SceneTypes.h"
+#include "MeshOptimizer.h"
+#include "ThreadPool.h"
 
 #define GLM_ENABLE_EXPERIMENTAL
 #include <gtc/matrix_transform.hpp>
@@ -12,6 +14,85 @@
 
 namespace ModelLoader
 {
-    std::shared_ptr<SceneNode> loadGlbOrGltf(const std::string& path);
+    struct LoadOptions
+    {
+        // Pack every primitive into one interleaved vertex buffer + one index buffer (GpuMeshArena).
+        bool packMeshArena = true;
+
+        // Keep a BVH over each primitive's triangles for CPU ray picking (SceneNode::meshBvhs).
+        bool buildPickBvh = true;
+
+        // Weld, drop degenerate triangles and reorder for the vertex cache, overdraw and vertex fetch
+        // (see MeshOptimizer.h). Primitives are then always converted, never uploaded in place.
+        bool optimizeMeshes = false;
+
+        // Measure ACMR and overdraw before and after optimisation into LoadStats::meshStats. Diagnostic
+        // only: it rasterises every primitive from six views twice.
+        bool measureMeshStats = false;
+
+        // Quadric-simplified LODs per primitive, each at about half the previous level's triangles,
+        // stored after its full indices (GpuMesh::lods). Also forces conversion.
+        bool generateLods = false;
+
+        // Image decode and vertex conversion run here when set; GL objects are always created on the
+        // calling thread, which must own the context and be the pool's owning thread.
+        ThreadPool* pool = nullptr;
+
+        // GPU-ready cache for packed-arena .glb loads (see ModelCacheFormat.h); empty disables it.
+        // A miss loads from source and writes the cache for next time.
+        std::string cacheDir;
+    };
+
+    // Wall time per load stage.
+    struct LoadStats
+    {
+        double parseMs = 0.0;
+        double decodeMs = 0.0;
+        double convertMs = 0.0;
+        double uploadMs = 0.0;
+        double totalMs = 0.0;
+
+        // Calls to uploadPreparedModel it took; 1 for a blocking load.
+        int uploadSteps = 0;
+
+        // A hit skips parse, decode and convert (parseMs then covers hashing and opening the cache).
+        bool cacheHit = false;
+        double cacheWriteMs = 0.0;
+
+        int imageCount = 0;
+        int primitiveCount = 0;
+
+        // Per-buffer primitives uploaded straight from the glTF buffers, without conversion.
+        int zeroCopyPrimitiveCount = 0;
+
+        // Summed over all primitives when LoadOptions::optimizeMeshes and measureMeshStats are set and the
+        // model came from source.
+        meshOptimizer::Stats meshStats;
+
+        // Triangles per LOD level summed over all primitives; a primitive with fewer levels adds its coarsest.
+        uint64_t lodTriangles[GpuMesh::kMaxLods] = {};
+        int threadCount = 1;
+    };
+
+    // A model parsed, decoded and converted off the GL thread, waiting for its GPU upload.
+    struct PendingModel;
+
+    // CPU stages only, no GL calls: safe on a background thread, which must then be options.pool's
+    // owning thread. Returns null on failure.
+    std::shared_ptr<PendingModel> prepareModel(const std::string& path, const LoadOptions& options = LoadOptions());
+
+    // Creates GL objects for the pending model until budgetMs has elapsed (at least one texture or
+    // buffer chunk per call). Returns true once everything is on the GPU.
+    bool uploadPreparedModel(PendingModel& pending, double budgetMs);
+
+    // Builds the scene from a fully uploaded model; the GL objects move to it.
+    std::shared_ptr<SceneNode> finishPreparedModel(PendingModel& pending, std::shared_ptr<FlatScene>& outFlatScene, LoadStats* outStats = nullptr);
+
+    // Deletes whatever GL objects a pending model created so far, for a load abandoned midway.
+    void discardPreparedModel(PendingModel& pending);
+
+    // Blocking load: prepare, upload in one go, finish.
+    std::shared_ptr<SceneNode> loadGlbOrGltf(const std::string& path, std::shared_ptr<FlatScene>& outFlatScene, const LoadOptions& options = LoadOptions(), LoadStats* outStats = nullptr);
     void destroyNodeGpu(std::shared_ptr<SceneNode>& node);
+    void destroyFlatSceneGpu(std::shared_ptr<FlatScene>& flat);
 }
\ No newline at end of file
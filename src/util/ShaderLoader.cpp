@@ -3,6 +3,7 @@
 
 #include <vector>
 #include <iostream>
+#include <algorithm>
 
 GLuint ShaderProgram::compileStage(GLenum stageType, const std::string& source)
 {
@@ -59,9 +60,49 @@ bool ShaderProgram::linkProgram(GLuint vs, GLuint fs)
         return false;
     }
 
+    reflectUniforms();
+
     return true;
 }
 
+void ShaderProgram::reflectUniforms()
+{
+    uniformLocations.clear();
+
+    GLint count = 0;
+    glGetProgramiv(programId, GL_ACTIVE_UNIFORMS, &count);
+
+    GLint maxLen = 0;
+    glGetProgramiv(programId, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLen);
+
+    std::vector<char> nameBuf(static_cast<size_t>(std::max(maxLen, 1)));
+
+    for (GLint i = 0; i < count; ++i)
+    {
+        GLsizei len = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(programId, static_cast<GLuint>(i), maxLen, &len, &size, &type, nameBuf.data());
+
+        std::string name(nameBuf.data(), static_cast<size_t>(len));
+        GLint loc = glGetUniformLocation(programId, name.c_str());
+
+        if (loc < 0)
+        {
+            continue;
+        }
+
+        uniformLocations[name] = loc;
+
+        // Arrays are reported as "name[0]"; also accept the bare name.
+        size_t bracket = name.find('[');
+        if (bracket != std::string::npos)
+        {
+            uniformLocations[name.substr(0, bracket)] = loc;
+        }
+    }
+}
+
 bool ShaderProgram::loadFromFiles(const std::string& vertexPath, const std::string& fragmentPath)
 {
     destroy();
@@ -107,6 +148,8 @@ void ShaderProgram::destroy()
         glDeleteProgram(programId);
         programId = 0;
     }
+
+    uniformLocations.clear();
 }
 
 void ShaderProgram::bind() const
@@ -119,32 +162,128 @@ GLuint ShaderProgram::getId() const
     return programId;
 }
 
-void ShaderProgram::setMat4(const char* name, const glm::mat4& m) const
+GLint ShaderProgram::getUniformLocation(const char* name) const
 {
-    GLint loc = glGetUniformLocation(programId, name);
+    auto it = uniformLocations.find(name);
+
+    return (it != uniformLocations.end()) ? it->second : -1;
+}
 
-    if (loc >= 0)
+void ShaderProgram::set(UniformHandle<glm::mat4> h, const glm::mat4& m) const
+{
+    if (h.location >= 0)
     {
-        glUniformMatrix4fv(loc, 1, GL_FALSE, &m[0][0]);
+        glUniformMatrix4fv(h.location, 1, GL_FALSE, &m[0][0]);
     }
 }
 
-void ShaderProgram::setVec3(const char* name, const glm::vec3& v) const
+void ShaderProgram::set(UniformHandle<glm::mat3> h, const glm::mat3& m) const
+{
+    if (h.location >= 0)
+    {
+        glUniformMatrix3fv(h.location, 1, GL_FALSE, &m[0][0]);
+    }
+}
+
+void ShaderProgram::set(UniformHandle<glm::vec3> h, const glm::vec3& v) const
+{
+    if (h.location >= 0)
+    {
+        glUniform3fv(h.location, 1, &v.x);
+    }
+}
+
+void ShaderProgram::set(UniformHandle<glm::vec2> h, const glm::vec2& v) const
+{
+    if (h.location >= 0)
+    {
+        glUniform2fv(h.location, 1, &v.x);
+    }
+}
+
+void ShaderProgram::set(UniformHandle<int> h, int v) const
 {
-    GLint loc = glGetUniformLocation(programId, name);
+    if (h.location >= 0)
+    {
+        glUniform1i(h.location, v);
+    }
+}
 
-    if (loc >= 0)
+void ShaderProgram::set(UniformHandle<GLuint> h, GLuint v) const
+{
+    if (h.location >= 0)
     {
-        glUniform3fv(loc, 1, &v.x);
+        glUniform1ui(h.location, v);
     }
 }
 
+void ShaderProgram::setMat4(const char* name, const glm::mat4& m) const
+{
+    set(getUniform<glm::mat4>(name), m);
+}
+
+void ShaderProgram::setVec3(const char* name, const glm::vec3& v) const
+{
+    set(getUniform<glm::vec3>(name), v);
+}
+
+void ShaderProgram::setVec2(const char* name, const glm::vec2& v) const
+{
+    set(getUniform<glm::vec2>(name), v);
+}
+
 void ShaderProgram::setInt(const char* name, int v) const
 {
-    GLint loc = glGetUniformLocation(programId, name);
+    set(getUniform<int>(name), v);
+}
 
-    if (loc >= 0)
+bool ShaderProgram::bindUniformBlock(const char* blockName, GLuint bindingPoint) const
+{
+    GLuint index = glGetUniformBlockIndex(programId, blockName);
+
+    if (index == GL_INVALID_INDEX)
     {
-        glUniform1i(loc, v);
+        return false;
     }
+
+    glUniformBlockBinding(programId, index, bindingPoint);
+
+    return true;
+}
+
+bool UniformBuffer::create(GLsizeiptr size, GLuint bindingPoint)
+{
+    destroy();
+
+    glGenBuffers(1, &bufferId);
+    glBindBuffer(GL_UNIFORM_BUFFER, bufferId);
+    glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    glBindBufferBase(GL_UNIFORM_BUFFER, bindingPoint, bufferId);
+    bufferSize = size;
+
+    return bufferId != 0;
+}
+
+void UniformBuffer::destroy()
+{
+    if (bufferId != 0)
+    {
+        glDeleteBuffers(1, &bufferId);
+        bufferId = 0;
+        bufferSize = 0;
+    }
+}
+
+void UniformBuffer::update(const void* data, GLsizeiptr size) const
+{
+    glBindBuffer(GL_UNIFORM_BUFFER, bufferId);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, std::min(size, bufferSize), data);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+GLuint UniformBuffer::getId() const
+{
+    return bufferId;
 }
\ No newline at end of file
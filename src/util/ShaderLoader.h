@@ -1,9 +1,17 @@
 #pragma once
 
 #include <string>
+#include <unordered_map>
 #include <glad/glad.h>
 #include <glm.hpp>
 
+// Typed uniform location resolved once from the program's reflection data.
+template <typename T>
+struct UniformHandle
+{
+    GLint location = -1;
+};
+
 class ShaderProgram
 {
 public:
@@ -15,13 +23,55 @@ public:
 
     GLuint getId() const;
 
+    GLint getUniformLocation(const char* name) const;
+
+    template <typename T>
+    UniformHandle<T> getUniform(const char* name) const
+    {
+        UniformHandle<T> h;
+        h.location = getUniformLocation(name);
+
+        return h;
+    }
+
+    void set(UniformHandle<glm::mat4> h, const glm::mat4& m) const;
+    void set(UniformHandle<glm::mat3> h, const glm::mat3& m) const;
+    void set(UniformHandle<glm::vec3> h, const glm::vec3& v) const;
+    void set(UniformHandle<glm::vec2> h, const glm::vec2& v) const;
+    void set(UniformHandle<int> h, int v) const;
+    void set(UniformHandle<GLuint> h, GLuint v) const;
+
     void setMat4(const char* name, const glm::mat4& m) const;
     void setVec3(const char* name, const glm::vec3& v) const;
+    void setVec2(const char* name, const glm::vec2& v) const;
     void setInt(const char* name, int v) const;
 
+    bool bindUniformBlock(const char* blockName, GLuint bindingPoint) const;
+
 private:
     GLuint programId = 0;
 
+    // Active uniform name -> location, filled at link time (uniform block members are not listed).
+    std::unordered_map<std::string, GLint> uniformLocations;
+
+    void reflectUniforms();
+
     GLuint compileStage(GLenum stageType, const std::string& source);
     bool linkProgram(GLuint vs, GLuint fs);
+};
+
+// Uniform buffer object bound to a fixed binding point (std140 data provided by the caller).
+class UniformBuffer
+{
+public:
+    bool create(GLsizeiptr size, GLuint bindingPoint);
+    void destroy();
+
+    void update(const void* data, GLsizeiptr size) const;
+
+    GLuint getId() const;
+
+private:
+    GLuint bufferId = 0;
+    GLsizeiptr bufferSize = 0;
 };
\ No newline at end of file
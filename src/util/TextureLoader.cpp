@@ -1,5 +1,8 @@
 #include "TextureLoader.h"
 
+#include <algorithm>
+#include <cstring>
+
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
@@ -31,13 +34,103 @@ GLuint textureLoader::createTextureFromRgba8(int width, int height, const unsign
     return tex;
 }
 
+GLuint textureLoader::createTextureFromRgba8Levels(int width, int height, int levelCount, const unsigned char* levelPixels)
+{
+    GLuint tex = 0;
+    glGenTextures(1, &tex);
+    glBindTexture(GL_TEXTURE_2D, tex);
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    for (int level = 0; level < levelCount; ++level)
+    {
+        int w = std::max(1, width >> level);
+        int h = std::max(1, height >> level);
+
+        glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, levelPixels);
+        levelPixels += static_cast<size_t>(w) * h * 4;
+    }
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, levelCount > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return tex;
+}
+
+size_t textureLoader::getMipChainBytes(int width, int height, int levelCount)
+{
+    size_t bytes = 0;
+
+    for (int level = 0; level < levelCount; ++level)
+    {
+        bytes += static_cast<size_t>(std::max(1, width >> level)) * std::max(1, height >> level) * 4;
+    }
+
+    return bytes;
+}
+
+int textureLoader::buildMipChain(int width, int height, const unsigned char* rgbaPixels, std::vector<unsigned char>& outLevels)
+{
+    int levelCount = 1;
+
+    while ((width >> levelCount) > 0 || (height >> levelCount) > 0)
+    {
+        ++levelCount;
+    }
+
+    outLevels.resize(getMipChainBytes(width, height, levelCount));
+    std::memcpy(outLevels.data(), rgbaPixels, static_cast<size_t>(width) * height * 4);
+
+    const unsigned char* src = outLevels.data();
+    unsigned char* dst = outLevels.data() + static_cast<size_t>(width) * height * 4;
+
+    for (int level = 1; level < levelCount; ++level)
+    {
+        int srcW = std::max(1, width >> (level - 1));
+        int srcH = std::max(1, height >> (level - 1));
+        int w = std::max(1, width >> level);
+        int h = std::max(1, height >> level);
+
+        // 2x2 box; a 1-texel-wide source axis averages the same texel twice.
+        for (int y = 0; y < h; ++y)
+        {
+            const unsigned char* row0 = src + static_cast<size_t>(std::min(y * 2, srcH - 1)) * srcW * 4;
+            const unsigned char* row1 = src + static_cast<size_t>(std::min(y * 2 + 1, srcH - 1)) * srcW * 4;
+
+            for (int x = 0; x < w; ++x)
+            {
+                int x0 = std::min(x * 2, srcW - 1) * 4;
+                int x1 = std::min(x * 2 + 1, srcW - 1) * 4;
+
+                for (int c = 0; c < 4; ++c)
+                {
+                    int sum = row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c];
+                    dst[(static_cast<size_t>(y) * w + x) * 4 + c] = static_cast<unsigned char>((sum + 2) >> 2);
+                }
+            }
+        }
+
+        src = dst;
+        dst += static_cast<size_t>(w) * h * 4;
+    }
+
+    return levelCount;
+}
+
 GLuint textureLoader::loadTextureFromFile(const std::string& path, bool generateMipmaps)
 {
     int w = 0;
     int h = 0;
     int comp = 0;
 
-    stbi_set_flip_vertically_on_load(1);
+    // GL wants the bottom row first. Set per thread: the model loader decodes unflipped on this thread
+    // too, and its per-thread flag would mask the global one.
+    stbi_set_flip_vertically_on_load_thread(1);
     unsigned char* pixels = stbi_load(path.c_str(), &w, &h, &comp, 4);
 
     if (!pixels)
@@ -7,5 +7,12 @@
 namespace textureLoader
 {
     GLuint createTextureFromRgba8(int width, int height, const unsigned char* rgbaPixels, bool generateMipmaps);
+
+    // Uploads a precomputed chain as built by buildMipChain: levelCount levels, level 0 first, tightly packed.
+    GLuint createTextureFromRgba8Levels(int width, int height, int levelCount, const unsigned char* levelPixels);
+
+    // Box-filtered RGBA8 mip chain down to 1x1, level 0 included. Returns the level count. Thread-safe.
+    int buildMipChain(int width, int height, const unsigned char* rgbaPixels, std::vector<unsigned char>& outLevels);
+    size_t getMipChainBytes(int width, int height, int levelCount);
     GLuint loadTextureFromFile(const std::string& path, bool generateMipmaps);
 }
\ No newline at end of file
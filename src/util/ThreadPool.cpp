@@ -0,0 +1,240 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(int threadCount)
+{
+    threadCount = std::max(1, threadCount);
+
+    for (int i = 0; i < threadCount; ++i)
+    {
+        queues.push_back(std::make_unique<WorkQueue>());
+    }
+
+    for (int i = 1; i < threadCount; ++i)
+    {
+        workers.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        stopping = true;
+    }
+
+    wakeCondition.notify_all();
+
+    for (size_t i = 0; i < workers.size(); ++i)
+    {
+        workers[i].join();
+    }
+}
+
+int ThreadPool::getThreadCount() const
+{
+    return static_cast<int>(queues.size());
+}
+
+bool ThreadPool::popLocal(int queue, Task& outTask)
+{
+    WorkQueue& q = *queues[queue];
+    std::lock_guard<std::mutex> lock(q.mutex);
+
+    if (q.head == q.tasks.size())
+    {
+        return false;
+    }
+
+    outTask = q.tasks.back();
+    q.tasks.pop_back();
+
+    if (q.head == q.tasks.size())
+    {
+        q.tasks.clear();
+        q.head = 0;
+    }
+
+    return true;
+}
+
+bool ThreadPool::steal(int thief, Task& outTask)
+{
+    int count = getThreadCount();
+
+    for (int k = 1; k < count; ++k)
+    {
+        WorkQueue& q = *queues[(thief + k) % count];
+        std::lock_guard<std::mutex> lock(q.mutex);
+
+        if (q.head < q.tasks.size())
+        {
+            outTask = q.tasks[q.head++];
+
+            if (q.head == q.tasks.size())
+            {
+                q.tasks.clear();
+                q.head = 0;
+            }
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool ThreadPool::findTask(int queue, Task& outTask)
+{
+    if (popLocal(queue, outTask) || steal(queue, outTask))
+    {
+        queuedTasks.fetch_sub(1, std::memory_order_relaxed);
+
+        return true;
+    }
+
+    return false;
+}
+
+void ThreadPool::runTask(const Task& task)
+{
+    task.function(task.context, task.begin, task.end);
+    task.remaining->fetch_sub(1, std::memory_order_release);
+}
+
+void ThreadPool::workerLoop(int queue)
+{
+    for (;;)
+    {
+        Task task;
+
+        if (findTask(queue, task))
+        {
+            runTask(task);
+
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(wakeMutex);
+        wakeCondition.wait(lock, [this]()
+        {
+            return stopping || queuedTasks.load(std::memory_order_relaxed) > 0;
+        });
+
+        if (stopping)
+        {
+            return;
+        }
+    }
+}
+
+void ThreadPool::parallelForRange(int count, int grainSize, RangeFunction function, const void* context)
+{
+    if (count <= 0)
+    {
+        return;
+    }
+
+    grainSize = std::max(1, grainSize);
+
+    int taskCount = (count + grainSize - 1) / grainSize;
+
+    if (taskCount == 1 || getThreadCount() == 1)
+    {
+        function(context, 0, count);
+
+        return;
+    }
+
+    std::atomic<int> remaining{ taskCount };
+
+    // Deal chunks round-robin so every participant starts with local work; stealing evens out the rest.
+    for (int t = 0; t < taskCount; ++t)
+    {
+        Task task;
+        task.function = function;
+        task.context = context;
+        task.begin = t * grainSize;
+        task.end = std::min(count, task.begin + grainSize);
+        task.remaining = &remaining;
+
+        WorkQueue& q = *queues[t % getThreadCount()];
+        std::lock_guard<std::mutex> lock(q.mutex);
+        q.tasks.push_back(task);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        queuedTasks.fetch_add(taskCount, std::memory_order_relaxed);
+    }
+
+    wakeCondition.notify_all();
+
+    while (remaining.load(std::memory_order_acquire) > 0)
+    {
+        Task task;
+
+        if (findTask(0, task))
+        {
+            runTask(task);
+        }
+        else
+        {
+            // Remaining chunks are running on workers.
+            std::this_thread::yield();
+        }
+    }
+}
+
+void ThreadPool::submitTask(TaskGroup& group, RangeFunction function, const void* context)
+{
+    if (getThreadCount() == 1)
+    {
+        function(context, 0, 1);
+
+        return;
+    }
+
+    group.pending.fetch_add(1, std::memory_order_relaxed);
+
+    Task task;
+    task.function = function;
+    task.context = context;
+    task.begin = 0;
+    task.end = 1;
+    task.remaining = &group.pending;
+
+    // Start on a worker queue; queue 0 is drained first by parallelFor callers.
+    nextSubmitQueue = nextSubmitQueue % (getThreadCount() - 1) + 1;
+
+    {
+        WorkQueue& q = *queues[nextSubmitQueue];
+        std::lock_guard<std::mutex> lock(q.mutex);
+        q.tasks.push_back(task);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        queuedTasks.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    wakeCondition.notify_one();
+}
+
+void ThreadPool::wait(TaskGroup& group)
+{
+    while (group.pending.load(std::memory_order_acquire) > 0)
+    {
+        Task task;
+
+        if (findTask(0, task))
+        {
+            runTask(task);
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed-size work-stealing pool. Each participant owns a task deque: it pops its own tasks from the
+// back and, when empty, steals from the front of the others. The thread calling parallelFor is
+// participant 0 and works alongside the pool until its job is done. submit() queues fire-and-forget
+// work on the workers instead, tracked by a TaskGroup.
+class ThreadPool
+{
+public:
+    // threadCount includes the calling thread; 1 runs everything inline.
+    explicit ThreadPool(int threadCount);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    int getThreadCount() const;
+
+    // Calls body(begin, end) over [0, count) in chunks of at most grainSize and returns when all are done.
+    // The body is passed by reference (no std::function), so dispatch does not touch the heap.
+    template <typename Body>
+    void parallelFor(int count, int grainSize, const Body& body)
+    {
+        parallelForRange(count, grainSize, &invokeRange<Body>, &body);
+    }
+
+    // Pending count of submitted tasks; must outlive them.
+    struct TaskGroup
+    {
+        std::atomic<int> pending{ 0 };
+    };
+
+    // Queues body() on a worker and returns immediately; body is referenced, not copied, so it must
+    // stay alive until wait(group) and may keep its results in itself. Runs inline when the pool has no
+    // workers. Call from the owning thread.
+    template <typename Body>
+    void submit(TaskGroup& group, Body& body)
+    {
+        submitTask(group, &invokeSingle<Body>, &body);
+    }
+
+    // Helps run queued tasks until every task submitted to group has finished.
+    void wait(TaskGroup& group);
+
+private:
+    using RangeFunction = void (*)(const void* context, int begin, int end);
+
+    template <typename Body>
+    static void invokeRange(const void* context, int begin, int end)
+    {
+        (*static_cast<const Body*>(context))(begin, end);
+    }
+
+    template <typename Body>
+    static void invokeSingle(const void* context, int, int)
+    {
+        // submit() took body by non-const reference; the task only carries it as const void*.
+        (*static_cast<Body*>(const_cast<void*>(context)))();
+    }
+
+    void parallelForRange(int count, int grainSize, RangeFunction function, const void* context);
+    void submitTask(TaskGroup& group, RangeFunction function, const void* context);
+
+    struct Task
+    {
+        RangeFunction function = nullptr;
+        const void* context = nullptr;
+        int begin = 0;
+        int end = 0;
+        std::atomic<int>* remaining = nullptr;
+    };
+
+    // Owner pops from the back, thieves take from head; storage is reused once the queue drains.
+    struct WorkQueue
+    {
+        std::mutex mutex;
+        std::vector<Task> tasks;
+        size_t head = 0;
+    };
+
+    bool popLocal(int queue, Task& outTask);
+    bool steal(int thief, Task& outTask);
+    bool findTask(int queue, Task& outTask);
+    void runTask(const Task& task);
+
+    void workerLoop(int queue);
+
+private:
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+    std::vector<std::thread> workers;
+
+    std::mutex wakeMutex;
+    std::condition_variable wakeCondition;
+    std::atomic<int> queuedTasks{ 0 };
+    bool stopping = false;
+
+    // Round-robin over the worker queues for submitted tasks.
+    int nextSubmitQueue = 0;
+};